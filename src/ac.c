@@ -0,0 +1,525 @@
+/***********************************************************************
+ *
+ * Associative-commutative operators.
+ *
+ * An infix operator defined with the keyword "ac" (see op_define in
+ * prep.c) is associative and commutative; one defined with the
+ * keyword "commutative" is only commutative.  Terms of such an
+ * operator f are kept in a canonical form.  An ac term is a chain
+ *
+ *	a1 f (a2 f ( ... f an))
+ *
+ * nested to the right, in which no argument is itself an unlabeled
+ * f term (the term is flattened), and the arguments are sorted by
+ * ac_compare.  A commutative term just has its two arguments sorted.
+ * The subject is put into canonical form before rewriting starts
+ * (ac_normal), and walk() keeps it there after each rewrite.
+ *
+ * A rule head whose operator is f matches modulo AC: each argument
+ * of the head (flattened the same way) must match a different
+ * argument of the subject term, in any order.  At the root of a head
+ * the subject may have more arguments than the head: the rule then
+ * rewrites just the arguments it matched, and its result is put back
+ * in among the others (ac_extend), so that "0 + b { b }" takes a 0
+ * out of a sum of any length.  Inside a head, the arguments left over
+ * are taken by the last parameter of the head that accepts an f term,
+ * as a new f term.
+ *
+ * The search for a match backtracks over which argument of the
+ * subject each argument of the head matches, but once an argument
+ * has matched, other ways in which it could match (modulo AC inside
+ * it) are not tried.
+ *
+ ***********************************************************************/
+
+#include "def.h"
+
+#define CHAIN	32		/* arguments kept on the C stack */
+
+/* a growing array of nodes */
+typedef struct vec {
+	int n;			/* nodes in it */
+	int size;		/* room for */
+	NODE **at;		/* the nodes */
+	NODE *buf[CHAIN];	/* until there are more than CHAIN */
+	} VEC;
+
+static void
+vec_init(v)
+VEC *v;
+{
+v->n = 0;
+v->size = CHAIN;
+v->at = v->buf;
+}
+
+static void
+vec_add(v, x)
+register VEC *v;
+NODE *x;
+{
+void *malloc();
+void free();
+NODE **at;
+
+if (v->n == v->size) {
+    at = (NODE **) malloc(2 * v->size * sizeof(NODE *));
+    if (!at) error("out of memory for ac term");
+    memcpy((char *) at, (char *) v->at, v->n * sizeof(NODE *));
+    if (v->at != v->buf) free((char *) v->at);
+    v->at = at;
+    v->size *= 2;
+    }
+v->at[v->n++] = x;
+}
+
+static void
+vec_done(v)
+VEC *v;
+{
+void free();
+
+if (v->at != v->buf) free((char *) v->at);
+}
+
+/***********************************************************************
+ *
+ * The order of the arguments of ac terms: terms, then names, then
+ * strings, then numbers.  Names are compared by their qualified
+ * names, terms by operator and then by their arguments.  Different
+ * names with the same qualified name compare equal, and the sort
+ * keeps them in the order they were in.
+ *
+ ***********************************************************************/
+static int
+rank(n)
+NODE *n;
+{
+if (n->op->arity & OP_TERM) return 0;
+if (n->op->arity & OP_NAME) return 1;
+if (n->op->arity & OP_STR) return 2;
+return 3;
+}
+
+static int
+name_order(a, b)
+register NAME_NODE *a, *b;
+{
+register int c;
+
+for (; a && b; a = a->parent, b = b->parent) {
+    if (a == b) return 0;
+    c = strcmp(a->pval ? a->pval : "", b->pval ? b->pval : "");
+    if (c) return c;
+    }
+return (a != NULL) - (b != NULL);
+}
+
+int
+ac_compare(a, b)
+register NODE *a, *b;
+{
+register int c;
+NODE *l, *r;
+
+while (a != b) {
+    if ((c = rank(a) - rank(b))) return c;
+    if (a->op->arity & OP_NUM) {
+	if (((NUM_NODE *) a)->value < ((NUM_NODE *) b)->value) return -1;
+	return ((NUM_NODE *) a)->value > ((NUM_NODE *) b)->value;
+	}
+    if (a->op->arity & OP_STR)
+	return strcmp(((STR_NODE *) a)->value, ((STR_NODE *) b)->value);
+    if (a->op->arity & OP_NAME)
+	return name_order((NAME_NODE *) a, (NAME_NODE *) b);
+    if (a->op != b->op) {
+	if ((c = strcmp(a->op->pname, b->op->pname))) return c;
+	return a->op->arity - b->op->arity;
+	}
+    l = ((TERM_NODE *) a)->left;
+    r = ((TERM_NODE *) b)->left;
+    if (l && r && (c = ac_compare(l, r))) return c;
+    a = ((TERM_NODE *) a)->right;
+    b = ((TERM_NODE *) b)->right;
+    if (!a || !b) return (a != NULL) - (b != NULL);
+    }
+return 0;
+}
+
+/* stable merge sort of n nodes, using tmp */
+static void
+msort(a, tmp, n)
+NODE **a, **tmp;
+int n;
+{
+register int i, j, k;
+int h = n / 2;
+
+if (n < 2) return;
+msort(a, tmp, h);
+msort(a + h, tmp, n - h);
+if (ac_compare(a[h - 1], a[h]) <= 0) return;	/* already in order */
+for (i = 0, j = h, k = 0; i < h && j < n; )
+    tmp[k++] = (ac_compare(a[j], a[i]) < 0) ? a[j++] : a[i++];
+while (i < h) tmp[k++] = a[i++];
+memcpy((char *) a, (char *) tmp, j * sizeof(NODE *));
+}
+
+static void
+sort(v)
+VEC *v;
+{
+void *malloc();
+void free();
+NODE *buf[CHAIN], **tmp;
+
+tmp = (v->n <= CHAIN) ? buf : (NODE **) malloc(v->n * sizeof(NODE *));
+if (!tmp) error("out of memory for ac term");
+msort(v->at, tmp, v->n);
+if (tmp != buf) free((char *) tmp);
+}
+
+/***********************************************************************
+ *
+ * Take an ac or commutative term r apart: its arguments, in order,
+ * and the f nodes that hold them together (r first).
+ *
+ ***********************************************************************/
+static void
+collect(args, spine, x, f)
+VEC *args, *spine;
+register NODE *x;
+OP *f;
+{
+while (x->op == f && !((TERM_NODE *) x)->label) {
+    vec_add(spine, x);
+    collect(args, spine, ((TERM_NODE *) x)->left, f);
+    x = ((TERM_NODE *) x)->right;
+    }
+vec_add(args, x);
+}
+
+static void
+chain_get(r, args, spine)
+NODE *r;
+VEC *args, *spine;
+{
+vec_init(args);
+vec_init(spine);
+vec_add(spine, r);
+if (r->op->ac & AC_ASSOC) {
+    collect(args, spine, ((TERM_NODE *) r)->left, r->op);
+    collect(args, spine, ((TERM_NODE *) r)->right, r->op);
+    }
+else {
+    vec_add(args, ((TERM_NODE *) r)->left);
+    vec_add(args, ((TERM_NODE *) r)->right);
+    }
+}
+
+/* put the arguments back together, nested to the right */
+static void
+chain_set(args, spine)
+VEC *args, *spine;		/* spine has args->n - 1 nodes */
+{
+register int i;
+register TERM_NODE *s;
+
+for (i = 0; i < args->n - 1; i++) {
+    s = (TERM_NODE *) spine->at[i];
+    s->left = args->at[i];
+    s->right = (i < args->n - 2) ? spine->at[i + 1] : args->at[i + 1];
+    }
+}
+
+/***********************************************************************
+ *
+ * Put one ac or commutative term into canonical form, assuming that
+ * its arguments already are.  The root node stays the root.
+ *
+ ***********************************************************************/
+void
+ac_sort(r)
+NODE *r;
+{
+VEC args, spine;
+
+chain_get(r, &args, &spine);
+sort(&args);
+chain_set(&args, &spine);
+vec_done(&args);
+vec_done(&spine);
+}
+
+/***********************************************************************
+ *
+ * Put every ac or commutative term of an expression into canonical
+ * form.  The root node stays the root.
+ *
+ ***********************************************************************/
+void
+ac_normal(x)
+register NODE *x;
+{
+VEC args, spine;
+register int i;
+
+while (x && (x->op->arity & OP_TERM)) {
+    if (x->op->ac) {
+	chain_get(x, &args, &spine);
+	for (i = 0; i < args.n; i++) ac_normal(args.at[i]);
+	sort(&args);
+	chain_set(&args, &spine);
+	vec_done(&args);
+	vec_done(&spine);
+	return;
+	}
+    if (((TERM_NODE *) x)->left && ((TERM_NODE *) x)->right)
+	ac_normal(((TERM_NODE *) x)->left);
+    x = ((TERM_NODE *) x)->right ?
+	((TERM_NODE *) x)->right : ((TERM_NODE *) x)->left;
+    }
+}
+
+/***********************************************************************
+ *
+ * After a rewrite, put the ac terms above it (on the walk stack)
+ * back into canonical form.
+ *
+ * returns:	TRUE if there were any
+ *
+ ***********************************************************************/
+int
+ac_up()
+{
+register SNODE *stn;
+register NODE *x;
+int found = FALSE;
+
+for (stn = bert_ctx->stack; stn; stn = stn->next) {
+    x = stn->node;
+    if (!x->op->ac) continue;
+    /* only the root of a chain */
+    if ((x->op->ac & AC_ASSOC) && stn->next &&
+      stn->next->node->op == x->op && !((TERM_NODE *) x)->label) continue;
+    ac_sort(x);
+    found = TRUE;
+    }
+return found;
+}
+
+/***********************************************************************
+ *
+ * Nodes made while matching, to hold arguments left over or to pass
+ * the matched arguments to a primitive, are freed after the match.
+ *
+ ***********************************************************************/
+static NODE *
+temp_term(f, left, right)
+OP *f;
+NODE *left, *right;
+{
+void *malloc();
+void *realloc();
+NODE *node_new();		/* from expr.c */
+register BERT_CTX *ctx = bert_ctx;
+register TERM_NODE *t = (TERM_NODE *) node_new();
+
+if (ctx->ac_ntemps == ctx->ac_tempsize) {
+    ctx->ac_tempsize = ctx->ac_tempsize ? 2 * ctx->ac_tempsize : CHAIN;
+    ctx->ac_temps = (NODE **) (ctx->ac_temps ?
+	realloc((char *) ctx->ac_temps, ctx->ac_tempsize * sizeof(NODE *)) :
+	malloc(ctx->ac_tempsize * sizeof(NODE *)));
+    if (!ctx->ac_temps) error("out of memory for ac match");
+    }
+ctx->ac_temps[ctx->ac_ntemps++] = (NODE *) t;
+t->op = f;
+t->label = (NAME_NODE *) NULL;
+t->left = left;
+t->right = right;
+return (NODE *) t;
+}
+
+/* a temporary term of the arguments at[0..n-1], nested to the right */
+static NODE *
+temp_chain(f, at, n)
+OP *f;
+NODE **at;
+int n;
+{
+return (n == 1) ? at[0] : temp_term(f, at[0], temp_chain(f, at + 1, n - 1));
+}
+
+void
+ac_temp_free()
+{
+void node_free();		/* from expr.c */
+
+while (bert_ctx->ac_ntemps)
+    node_free(bert_ctx->ac_temps[--bert_ctx->ac_ntemps]);
+}
+
+/***********************************************************************
+ *
+ * Match the arguments pat[k], pat[k+1], ... of a head, except
+ * pat[skip], to different unused arguments of the subject.
+ *
+ ***********************************************************************/
+static int
+search(pat, m, k, skip, args, used, hit)
+NODE **pat;
+int m, k, skip;
+VEC *args;
+char *used;
+int *hit;
+{
+int match_sub();		/* from match.c */
+register int j;
+
+if (k == skip) k++;
+if (k >= m) return TRUE;
+for (j = 0; j < args->n; j++) {
+    if (used[j] || !match_sub(pat[k], args->at[j])) continue;
+    used[j] = TRUE;
+    hit[k] = j;
+    if (search(pat, m, k + 1, skip, args, used, hit)) return TRUE;
+    used[j] = FALSE;
+    }
+return FALSE;
+}
+
+/* will parameter p accept a term of operator f? */
+static int
+absorbs(p, f)
+NODE *p;
+OP *f;
+{
+register OP *mt;
+
+if (!(p->op->arity & OP_NAME)) return FALSE;
+if (p->op == bert_ctx->untyped_prim) return TRUE;
+for (mt = f; mt; mt = mt->super) if (p->op == mt) return TRUE;
+return FALSE;
+}
+
+/***********************************************************************
+ *
+ * Match a head whose operator is ac or commutative, modulo AC.
+ * At the root of a head, the arguments matched are left in
+ * ac_hit[], and the number left over in ac_extra.
+ *
+ ***********************************************************************/
+int
+ac_match(head, exp, root)
+NODE *head;		/* pattern */
+NODE *exp;		/* subexpression */
+int root;		/* the root of the head? */
+{
+void *malloc();
+void free();
+register BERT_CTX *ctx = bert_ctx;
+VEC pats, pspine, args, spine, rest;
+char ubuf[CHAIN], *used;
+int hit[MAXHEAD];
+int i, m, n, skip = -1, ok = FALSE;
+
+if (exp->op != head->op) return FALSE;
+chain_get(head, &pats, &pspine);
+chain_get(exp, &args, &spine);
+m = pats.n;
+n = args.n;
+if (m > MAXHEAD) error("too many arguments of an ac operator in a rule head");
+if (n < m) goto done;
+if (n > m && !root) {		/* a parameter takes the rest */
+    for (skip = m - 1; skip >= 0; skip--)
+	if (absorbs(pats.at[skip], head->op)) break;
+    if (skip < 0) goto done;
+    }
+
+used = (n <= CHAIN) ? ubuf : (char *) malloc(n * sizeof(char));
+if (!used) error("out of memory for ac match");
+memset(used, 0, n);
+if (search(pats.at, m, 0, skip, &args, used, hit)) {
+    ok = TRUE;
+    if (skip >= 0) {
+	vec_init(&rest);
+	for (i = 0; i < n; i++) if (!used[i]) vec_add(&rest, args.at[i]);
+	((NAME_NODE *) pats.at[skip])->value =
+	    temp_chain(head->op, rest.at, rest.n);
+	vec_done(&rest);
+	}
+    if (root) {
+	for (i = 0; i < m; i++) ctx->ac_hit[i] = hit[i];
+	ctx->ac_nhit = m;
+	ctx->ac_extra = n - m;
+	}
+    }
+if (used != ubuf) free(used);
+
+done:
+vec_done(&pats);
+vec_done(&pspine);
+vec_done(&args);
+vec_done(&spine);
+return ok;
+}
+
+/***********************************************************************
+ *
+ * The arguments of the redex r that the head matched, as a term in
+ * the order of the head, for a primitive to work on.
+ *
+ ***********************************************************************/
+NODE *
+ac_redex(r)
+NODE *r;
+{
+VEC args, spine;
+NODE *hits[MAXHEAD];
+int i;
+
+chain_get(r, &args, &spine);
+for (i = 0; i < bert_ctx->ac_nhit; i++)
+    hits[i] = args.at[bert_ctx->ac_hit[i]];
+vec_done(&args);
+vec_done(&spine);
+return temp_chain(r->op, hits, bert_ctx->ac_nhit);
+}
+
+/***********************************************************************
+ *
+ * A rule matched some of the arguments of the redex r, and body is
+ * what they were rewritten to.  Free the arguments matched, and put
+ * body in their place among the other arguments.
+ *
+ * returns:	r, in canonical form
+ *
+ ***********************************************************************/
+NODE *
+ac_extend(r, body)
+NODE *r;
+NODE *body;
+{
+void expr_free();		/* from expr.c */
+void node_free();		/* from expr.c */
+VEC args, spine, keep;
+register int i, j;
+
+ac_normal(body);
+chain_get(r, &args, &spine);
+vec_init(&keep);
+vec_add(&keep, body);
+for (i = 0; i < args.n; i++) {
+    for (j = 0; j < bert_ctx->ac_nhit; j++)
+	if (bert_ctx->ac_hit[j] == i) break;
+    if (j < bert_ctx->ac_nhit) expr_free(args.at[i]);
+    else vec_add(&keep, args.at[i]);
+    }
+for (i = keep.n - 1; i < spine.n; i++) node_free(spine.at[i]);
+chain_set(&keep, &spine);
+vec_done(&keep);
+vec_done(&args);
+vec_done(&spine);
+ac_sort(r);		/* body may be an f term itself */
+return r;
+}
@@ -0,0 +1,216 @@
+/***********************************************************************
+ *
+ * Parallel batch runner.
+ *
+ * "bert -j N file ..." runs the program files N at a time.  The
+ * libraries named with --include are loaded once, before the batch
+ * starts, and each file is run in a child process forked from there
+ * (see fork_program in main.c), so the children share the parsed
+ * libraries and only parse their own program.
+ *
+ * The standard output and standard error of each child go to
+ * temporary files, and are copied out in the order the files were
+ * named on the command line, whatever order they finish in.  At most
+ * MAXPENDING files are started ahead of the first one not yet copied
+ * out, so a slow file does not leave a pile of open temporaries.
+ *
+ * When the batch is done, a summary goes to the standard error, one
+ * line per file and then the totals:
+ *
+ *	batch: <file> <ok|failed|limit|signal n> <seconds>
+ *	batch: files <n>
+ *	batch: failed <n>
+ *	batch: limit <n>
+ *	batch: seconds <wall clock seconds for the batch>
+ *
+ ***********************************************************************/
+
+#include "def.h"
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <unistd.h>
+
+#define MAXPENDING 256	/* files started but not yet copied out */
+
+typedef struct {
+    pid_t pid;		/* child, 0 when finished */
+    FILE *out, *err;	/* what the child wrote */
+    double start;	/* when it was started */
+    } JOB;
+
+/***********************************************************************
+ *
+ * Copy a temporary file to a stream, and close it.
+ *
+ ***********************************************************************/
+static void
+copy_out(tmp, to)
+FILE *tmp;
+FILE *to;
+{
+char buf[BUFSIZ];
+size_t n;
+
+if (!tmp) return;
+rewind(tmp);
+while (0 < (n = fread(buf, 1, sizeof(buf), tmp))) fwrite(buf, 1, n, to);
+fclose(tmp);
+fflush(to);
+}
+
+/***********************************************************************
+ *
+ * Start running a file in a child process.
+ *
+ * returns:	FALSE if it could not be started
+ *
+ ***********************************************************************/
+static int
+job_start(ctx, job, name)
+BERT_CTX *ctx;
+JOB *job;
+char *name;		/* program file name */
+{
+int run_program();		/* from main.c */
+double stats_clock();		/* from stats.c */
+FILE *fp;
+int status;
+
+job->pid = 0;
+job->out = tmpfile();
+job->err = tmpfile();
+if (!job->out || !job->err) {
+    perror("bert: tmpfile");
+    if (job->out) fclose(job->out);
+    if (job->err) fclose(job->err);
+    job->out = job->err = NULL;
+    return FALSE;
+    }
+fflush(stdout);		/* or the child would write it again */
+fflush(stderr);
+job->start = stats_clock();
+job->pid = fork();
+if (0 == job->pid) {
+    dup2(fileno(job->out), 1);
+    dup2(fileno(job->err), 2);
+    fp = fopen(name, "r");
+    if (NULL == fp) {
+	fprintf(stderr, "can't open program file %s\n", name);
+	_exit(1);
+	}
+    status = run_program(ctx, fp, name);
+    fflush(stdout);
+    fflush(stderr);
+    _exit(status);
+    }
+if (job->pid < 0) {
+    perror("bert: fork");
+    job->pid = 0;
+    return FALSE;
+    }
+return TRUE;
+}
+
+/***********************************************************************
+ *
+ * Run the files named in names, jobs at a time, with the libraries
+ * already loaded into ctx.
+ *
+ * returns:	exit status for main, BERT_LIMIT if any file ran into
+ *		a limit, else 1 if any failed
+ *
+ ***********************************************************************/
+int
+batch(ctx, n, names, jobs)
+BERT_CTX *ctx;
+int n;			/* number of files */
+char *names[];		/* file names */
+int jobs;		/* how many to run at once */
+{
+void *malloc();
+void free();
+double stats_clock();		/* from stats.c */
+JOB job[MAXPENDING];
+double *seconds;	/* of each file */
+int *status;		/* wait status of each file */
+int next = 0;		/* next file to start */
+int done = 0;		/* next file to copy out */
+int running = 0;
+int failed = 0;
+int limited = 0;	/* ran into a limit */
+int i, st;
+pid_t pid;
+double start;
+
+seconds = (double *) malloc(n * sizeof(double));
+status = (int *) malloc(n * sizeof(int));
+if (!seconds || !status) {
+    fprintf(stderr, "out of memory for batch of %d files\n", n);
+    return 1;
+    }
+start = stats_clock();
+
+while (done < n) {
+    /* keep jobs files running */
+    while (running < jobs && next < n && next - done < MAXPENDING) {
+	if (job_start(ctx, &job[next % MAXPENDING], names[next]))
+	    running++;
+	else {
+	    status[next] = 1 << 8;	/* exit status 1 */
+	    seconds[next] = 0.0;
+	    }
+	next++;
+	}
+
+    /* copy out finished files, in order */
+    if (done < next && 0 == job[done % MAXPENDING].pid) {
+	copy_out(job[done % MAXPENDING].out, stdout);
+	copy_out(job[done % MAXPENDING].err, stderr);
+	done++;
+	continue;
+	}
+
+    pid = wait(&st);
+    if (pid < 0) {
+	if (EINTR == errno) continue;
+	perror("bert: wait");
+	return 1;
+	}
+    for (i = done; i < next; i++) {
+	if (job[i % MAXPENDING].pid == pid) {
+	    job[i % MAXPENDING].pid = 0;
+	    seconds[i] = stats_clock() - job[i % MAXPENDING].start;
+	    status[i] = st;
+	    running--;
+	    break;
+	    }
+	}
+    }
+
+for (i = 0; i < n; i++) {
+    fprintf(stderr, "batch: %s ", names[i]);
+    if (WIFSIGNALED(status[i])) {
+	fprintf(stderr, "signal %d", WTERMSIG(status[i]));
+	failed++;
+	}
+    else if (BERT_LIMIT == WEXITSTATUS(status[i])) {
+	fprintf(stderr, "limit");
+	limited++;
+	}
+    else if (WEXITSTATUS(status[i])) {
+	fprintf(stderr, "failed");
+	failed++;
+	}
+    else fprintf(stderr, "ok");
+    fprintf(stderr, " %.6f\n", seconds[i]);
+    }
+fprintf(stderr, "batch: files %d\n", n);
+fprintf(stderr, "batch: failed %d\n", failed);
+fprintf(stderr, "batch: limit %d\n", limited);
+fprintf(stderr, "batch: seconds %.6f\n", stats_clock() - start);
+
+free((char *) seconds);
+free((char *) status);
+return limited ? BERT_LIMIT : (failed ? 1 : 0);
+}
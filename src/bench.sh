@@ -0,0 +1,155 @@
+#!/bin/sh
+# Bertrand benchmark driver.
+#
+# Generates Bertrand programs of increasing size, runs bert --stats on
+# each one, and writes one tab separated line per run to standard output:
+#
+#	commit workload size status seconds parse rewrite rewrites passes nodes
+#
+# seconds is parse + rewrite + print time as measured by bert itself;
+# status is "ok", "timeout", "error" or "skipped".  Once a workload times
+# out or fails, its larger sizes are not run.  The dense workload grows
+# as the square of its size, so sizes above DENSEMAX are skipped rather
+# than written out.
+#
+# usage: sh bench.sh [size ...]
+#
+# Environment:
+#	BERT		interpreter to run (default ./bert)
+#	BERTFLAGS	more switches for it, e.g. "--split 4"
+#	TIMEOUT		seconds allowed for each run (default 60)
+#	WORKLOADS	which workloads to run (default all of them)
+#	DENSEMAX	largest size of the dense workload (default 1000)
+#
+# Workloads:
+#	rect	grid of rectangles made of bag lines, each fixed to its
+#		left neighbour, like examples/rectangle
+#	dense	dense, diagonally dominant linear system for beep
+#	sparse	chain of two-variable linear equations for beep
+#	stream	prod ints n, as in examples/streamfact
+#	chain	a long ; chain of constant tests
+#	parts	many small linear systems that share no variables
+
+BERT=${BERT:-./bert}
+TIMEOUT=${TIMEOUT:-60}
+WORKLOADS=${WORKLOADS:-"rect dense sparse stream chain parts"}
+SIZES=${*:-"10 100 1000 10000 100000"}
+DENSEMAX=${DENSEMAX:-1000}
+
+here=`cd \`dirname $0\` && pwd`
+BERTRAND=${BERTRAND:-$here/../libraries/}
+export BERTRAND
+commit=`git -C $here rev-parse --short HEAD 2>/dev/null || echo unknown`
+tmp=${TMPDIR:-/tmp}/bertbench.$$
+mkdir -p $tmp
+trap 'rm -rf $tmp' 0 1 2 15
+
+# generate workload $1 of size $2 on standard output
+generate() {
+case $1 in
+rect) awk -v n=$2 'BEGIN {
+	print "#include bag"
+	print "#op aRect nullary"
+	print "#type '"'"'rect"
+	print "aRect { left: aLine; right: aLine; bottom: aLine; top: aLine;"
+	print "  top conn right; right conn bottom; bottom conn left; left conn top;"
+	print "  horiz top; horiz bottom; vert right; vert left; true } '"'"'rect"
+	print "main {"
+	for (i = 1; i <= n; i++) {
+		printf "r%d: aRect; widthof r%d.bottom = -3; heightof r%d.left = 2;\n", i, i, i
+		if (i == 1) print "r1.left.begin.x = 0; r1.left.begin.y = 0;"
+		else printf "r%d.left.begin.x = r%d.right.begin.x + 1; r%d.left.begin.y = r%d.left.begin.y;\n", i, i-1, i, i-1
+		}
+	printf "r%d.right.end.x }\n", n
+	}' ;;
+dense) awk -v n=$2 'BEGIN {
+	print "#include beep"
+	print "main {"
+	for (i = 1; i <= n; i++) printf "x%d: aNumber;\n", i
+	for (i = 1; i <= n; i++) {
+		for (j = 1; j <= n; j++) {
+			if (j > 1) printf " + "
+			printf "%d*x%d", (i == j) ? n + 1 : 1, j
+			}
+		printf " = %d;\n", 2 * n
+		}
+	print "x1 }"
+	}' ;;
+sparse) awk -v n=$2 'BEGIN {
+	print "#include beep"
+	print "main {"
+	for (i = 1; i <= n; i++) printf "x%d: aNumber;\n", i
+	print "x1 = 1;"
+	for (i = 2; i <= n; i++) printf "2*x%d - x%d = %d;\n", i, i-1, i + 1
+	printf "x%d }\n", n
+	}' ;;
+stream) awk -v n=$2 'BEGIN {
+	print "#include beep"
+	print "#op prod prefix 900"
+	print "#op ints prefix 900"
+	print "ints 1 { 1 }"
+	print "ints a'"'"'constant { ints (a-1) , a }"
+	print "prod a'"'"'constant { a }"
+	print "prod (a , b) { (prod a) * (prod b) }"
+	printf "main { prod ints %d }\n", n
+	}' ;;
+chain) awk -v n=$2 'BEGIN {
+	print "#include bops"
+	print "main {"
+	for (i = 1; i <= n; i++) printf "%d = %d;\n", i, i
+	print "0 }"
+	}' ;;
+parts) awk -v n=$2 'BEGIN {
+	print "#include beep"
+	print "main {"
+	for (i = 1; i <= n; i++) {
+		printf "x%d: aNumber; y%d: aNumber; z%d: aNumber;\n", i, i, i
+		printf "x%d + y%d + z%d = %d; x%d - y%d = 1; 2*z%d = x%d;\n", i, i, i, 6*i, i, i, i, i
+		}
+	printf "x%d }\n", n
+	}' ;;
+*)	echo "bench.sh: unknown workload $1" >&2
+	exit 1 ;;
+esac
+}
+
+# pick value of "stats: $1" out of the file $2
+stat() {
+sed -n "s/^stats: $1 //p" $2 | tail -1
+}
+
+printf "commit\tworkload\tsize\tstatus\tseconds\tparse\trewrite\trewrites\tpasses\tnodes\n"
+for w in $WORKLOADS; do
+    for n in $SIZES; do
+	if [ $w = dense ] && [ $n -gt $DENSEMAX ]; then
+	    printf "%s\t%s\t%s\tskipped\t-\t-\t-\t-\t-\t-\n" $commit $w $n
+	    break
+	fi
+	generate $w $n > $tmp/$w.b
+	if command -v timeout > /dev/null; then
+	    timeout $TIMEOUT $BERT $BERTFLAGS --stats $tmp/$w.b > /dev/null 2> $tmp/out
+	else
+	    $BERT $BERTFLAGS --stats $tmp/$w.b > /dev/null 2> $tmp/out
+	fi
+	case $? in
+	0)	status=ok ;;
+	124)	status=timeout ;;
+	*)	status=error ;;
+	esac
+	if [ $status = ok ] && ! grep -q '^stats: program' $tmp/out; then
+	    status=error
+	fi
+	if [ $status = ok ]; then
+	    p=`stat parse_seconds $tmp/out`
+	    r=`stat rewrite_seconds $tmp/out`
+	    o=`stat print_seconds $tmp/out`
+	    s=`echo "$p $r $o" | awk '{ printf "%.6f", $1 + $2 + $3 }'`
+	    printf "%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n" $commit $w $n \
+		$status $s $p $r `stat rewrites $tmp/out` \
+		`stat walk_passes $tmp/out` `stat nodes_high_water $tmp/out`
+	else
+	    printf "%s\t%s\t%s\t%s\t-\t-\t-\t-\t-\t-\n" $commit $w $n $status
+	    break
+	fi
+    done
+done
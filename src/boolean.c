@@ -0,0 +1,442 @@
+/***********************************************************************
+ *
+ * Booleans: clauses and unit propagation.
+ *
+ * bops declares boolean variables,
+ *
+ *	p: aBoolean
+ *
+ * of type 'boolvar, and turns a -> b, a | b and the rest into & and
+ * ~, but can do no more with a constraint such as ~(~p & ~q) than
+ * leave it in the subject: nothing follows from it until p or q is
+ * bound.  Once no rule matches the subject any more (and the other
+ * solvers have nothing to do), each conjunct of its top level ;
+ * chain (but the last, which is the answer) that is built of
+ * boolvars, true, false, ~, &, | and -> is turned into clauses,
+ *
+ *	~(~p & ~q)	   becomes	p | q
+ *	~(p & ~(q & r))	   becomes	~p | q,  ~p | r
+ *
+ * a conjunction inside a disjunction being given a variable of its
+ * own, t, which stands for it (t implies each of its conjuncts), so
+ * that the clauses are never more than linear in the size of the
+ * subject.  Then the values the clauses force are found by unit
+ * propagation: each clause watches two of its literals that are not
+ * false, and only when one of them becomes false is it looked at,
+ * for another to watch or else for the one left, which must hold.
+ * Each literal is looked at a bounded number of times per clause
+ * that watches it, so this is near linear in the size of the
+ * clauses.
+ *
+ * If a clause cannot hold, false is put at the front of the chain.
+ * Otherwise the boolvars whose values are forced are bound to true or
+ * false, and the rules of bops simplify the constraints they were
+ * in.  No search is done: a boolvar that nothing forces is left free,
+ * with its constraints.
+ *
+ * While a program with edit variables is first being solved (see
+ * edit.c), nothing is done here, as for simplex.c.
+ *
+ ***********************************************************************/
+
+#include "def.h"
+
+/* from other modules */
+OP *op_find();			/* from ops.c */
+NODE *lp_truth();		/* from simplex.c */
+void lp_update();		/* from simplex.c */
+void lp_false();		/* from simplex.c */
+double stats_clock();		/* from stats.c */
+void free();
+
+/* a literal is 2 * variable, + 1 if it is negated */
+#define TRUTH(st, l)	((st)->value[(l) >> 1] < 0 ? -1 : \
+			    (st)->value[(l) >> 1] ^ ((l) & 1))
+
+/* a clause, st->lits[at .. at+n), watching the first two */
+typedef struct clause {
+	int at;
+	int n;
+	} CLAUSE;
+
+/* everything propagation works on */
+typedef struct store {
+	NAME_NODE **names;	/* of each variable, NULL for one made here */
+	int *value;		/* of each: -1 if not known, else 0 or 1 */
+	int *seen;		/* of each literal, while building a clause */
+	int nvars, vars_size;
+	int *lits;		/* of all the clauses */
+	int nlits, lits_size;
+	CLAUSE *clauses;
+	int nclauses, clauses_size;
+	int *stack;		/* literals of the clauses being built */
+	int top, stack_size;
+	int stamp;		/* of the clause being built, in seen */
+	int satisfied;		/* it has a literal that is true */
+	int *watch;		/* of each literal, the first watch of it */
+	int *next;		/* of watch 2c + i, of lits[at + i] of clause c */
+	int *trail;		/* literals made true, in order */
+	int ntrail, head;
+	} STORE;
+
+/* the operators of bops it knows */
+typedef struct ops {
+	OP *semi, *and, *or, *implies, *not, *boolvar;
+	} OPS;
+
+#define space(n)	mem_get((size_t) (n), "boolean constraints")
+#define more(p, n)	mem_grow((void *) (p), (size_t) (n), "boolean constraints")
+
+/***********************************************************************
+ *
+ * Is ex a constraint this can turn into clauses?  It must be built of
+ * free boolvars, true, false, ~, &, | and ->, and have a boolvar.
+ *
+ ***********************************************************************/
+static int
+formula(ex, ops, vars)
+register NODE *ex;
+register OPS *ops;
+int *vars;		/* set if it has a boolvar */
+{
+register BERT_CTX *ctx = bert_ctx;
+
+if (ex->op->arity & OP_NAME) {
+    if (ex->op != ops->boolvar || ((NAME_NODE *) ex)->value) return FALSE;
+    *vars = TRUE;
+    return TRUE;
+    }
+if (ex->op == ctx->true_op || ex->op == ctx->false_op) return TRUE;
+if (ex->op == ops->not) return formula(((TERM_NODE *) ex)->right, ops, vars);
+if (ex->op == ops->and || ex->op == ops->or || ex->op == ops->implies)
+    return formula(((TERM_NODE *) ex)->left, ops, vars) &&
+	formula(((TERM_NODE *) ex)->right, ops, vars);
+return FALSE;
+}
+
+/* a new variable, for the boolvar nn or (if NULL) for a conjunction */
+static int
+variable(st, nn)
+register STORE *st;
+NAME_NODE *nn;
+{
+register int v = st->nvars;
+
+if (v == st->vars_size) {
+    st->vars_size *= 2;
+    st->names = (NAME_NODE **) more((char *) st->names,
+	st->vars_size * sizeof(NAME_NODE *));
+    st->seen = (int *) more((char *) st->seen,
+	2 * st->vars_size * sizeof(int));
+    }
+st->names[v] = nn;
+st->seen[2 * v] = st->seen[2 * v + 1] = 0;
+if (nn) nn->domain = v + 1;
+return st->nvars++;
+}
+
+/* the variable of a boolvar, the first time it is seen made new */
+static int
+named(st, nn)
+register STORE *st;
+register NAME_NODE *nn;
+{
+register int d = nn->domain;
+
+if (d > 0 && d <= st->nvars && st->names[d - 1] == nn) return d - 1;
+return variable(st, nn);
+}
+
+static void
+push(st, l)
+register STORE *st;
+int l;
+{
+if (st->top == st->stack_size)
+    st->stack = (int *) more((char *) st->stack,
+	(st->stack_size *= 2) * sizeof(int));
+st->stack[st->top++] = l;
+}
+
+/* add the clause built on the stack from base, unless it always holds */
+static void
+commit(st, base)
+register STORE *st;
+int base;
+{
+register int i, j, l;
+register CLAUSE *c;
+
+st->stamp++;
+for (i = j = base; i < st->top; i++) {
+    l = st->stack[i];
+    if (st->seen[l ^ 1] == st->stamp) break;	/* p | ~p */
+    if (st->seen[l] != st->stamp) {
+	st->seen[l] = st->stamp;
+	st->stack[j++] = l;
+	}
+    }
+if (i == st->top && !st->satisfied) {
+    if (st->nclauses == st->clauses_size)
+	st->clauses = (CLAUSE *) more((char *) st->clauses,
+	    (st->clauses_size *= 2) * sizeof(CLAUSE));
+    while (st->nlits + j - base > st->lits_size)
+	st->lits = (int *) more((char *) st->lits,
+	    (st->lits_size *= 2) * sizeof(int));
+    c = &st->clauses[st->nclauses++];
+    c->at = st->nlits;
+    c->n = j - base;
+    for (i = base; i < j; i++) st->lits[st->nlits++] = st->stack[i];
+    }
+st->top = base;
+}
+
+static void conjoin();
+
+/***********************************************************************
+ *
+ * Put the literals of ex (or, if sign is FALSE, of ~ex) on the stack,
+ * as a disjunction.  A conjunction among them is given a variable of
+ * its own, whose clauses are added first.
+ *
+ ***********************************************************************/
+static void
+disjoin(st, ex, sign, ops)
+register STORE *st;
+register NODE *ex;
+int sign;
+register OPS *ops;
+{
+register BERT_CTX *ctx = bert_ctx;
+register TERM_NODE *tn = (TERM_NODE *) ex;
+int t;
+
+if (ex->op->arity & OP_NAME)
+    push(st, 2 * named(st, (NAME_NODE *) ex) + !sign);
+else if (ex->op == ctx->true_op || ex->op == ctx->false_op) {
+    if ((ex->op == ctx->true_op) == sign) st->satisfied = TRUE;
+    }
+else if (ex->op == ops->not) disjoin(st, tn->right, !sign, ops);
+else if (ex->op == ops->or && sign) {
+    disjoin(st, tn->left, TRUE, ops);
+    disjoin(st, tn->right, TRUE, ops);
+    }
+else if (ex->op == ops->and && !sign) {		/* ~(a & b) = ~a | ~b */
+    disjoin(st, tn->left, FALSE, ops);
+    disjoin(st, tn->right, FALSE, ops);
+    }
+else if (ex->op == ops->implies && sign) {	/* a -> b = ~a | b */
+    disjoin(st, tn->left, FALSE, ops);
+    disjoin(st, tn->right, TRUE, ops);
+    }
+else {		/* a conjunction: t, where t -> it */
+    t = variable(st, (NAME_NODE *) NULL);
+    push(st, 2 * t);
+    conjoin(st, ex, sign, 2 * t + 1, ops);
+    }
+}
+
+/***********************************************************************
+ *
+ * Add the clauses of ex (or, if sign is FALSE, of ~ex), each with the
+ * literal guard in it, if there is one.
+ *
+ ***********************************************************************/
+static void
+conjoin(st, ex, sign, guard, ops)
+register STORE *st;
+register NODE *ex;
+int sign;
+int guard;		/* -1 if none */
+register OPS *ops;
+{
+register TERM_NODE *tn = (TERM_NODE *) ex;
+int base, satisfied;
+
+if (ex->op == ops->not) conjoin(st, tn->right, !sign, guard, ops);
+else if (ex->op == ops->and && sign) {
+    conjoin(st, tn->left, TRUE, guard, ops);
+    conjoin(st, tn->right, TRUE, guard, ops);
+    }
+else if (ex->op == ops->or && !sign) {		/* ~(a | b) = ~a & ~b */
+    conjoin(st, tn->left, FALSE, guard, ops);
+    conjoin(st, tn->right, FALSE, guard, ops);
+    }
+else if (ex->op == ops->implies && !sign) {	/* ~(a -> b) = a & ~b */
+    conjoin(st, tn->left, TRUE, guard, ops);
+    conjoin(st, tn->right, FALSE, guard, ops);
+    }
+else {		/* a disjunction: one clause */
+    satisfied = st->satisfied;
+    st->satisfied = FALSE;
+    base = st->top;
+    if (guard >= 0) push(st, guard);
+    disjoin(st, ex, sign, ops);
+    commit(st, base);
+    st->satisfied = satisfied;
+    }
+}
+
+/* make the literal l true */
+static void
+assign(st, l)
+register STORE *st;
+int l;
+{
+st->value[l >> 1] = !(l & 1);
+st->trail[st->ntrail++] = l;
+}
+
+/***********************************************************************
+ *
+ * Propagate the literals on the trail.  For each literal made false,
+ * each clause that watches it watches another that is not false, if
+ * it has one; else the other literal it watches must hold.
+ *
+ * returns:	FALSE if a clause cannot hold
+ *
+ ***********************************************************************/
+static int
+propagate(st)
+register STORE *st;
+{
+register int w, *link, *l;
+int f, k, n, other;
+
+while (st->head < st->ntrail) {
+    f = st->trail[st->head++] ^ 1;	/* the literal made false */
+    for (link = &st->watch[f]; (w = *link) >= 0; ) {
+	l = &st->lits[st->clauses[w >> 1].at];
+	n = st->clauses[w >> 1].n;
+	other = l[!(w & 1)];
+	if (TRUTH(st, other) == 1) {	/* the clause holds */
+	    link = &st->next[w];
+	    continue;
+	    }
+	for (k = 2; k < n && TRUTH(st, l[k]) == 0; k++) ;
+	if (k < n) {		/* watch l[k] instead */
+	    l[w & 1] = l[k];
+	    l[k] = f;
+	    *link = st->next[w];
+	    st->next[w] = st->watch[l[w & 1]];
+	    st->watch[l[w & 1]] = w;
+	    continue;
+	    }
+	if (TRUTH(st, other) == 0) return FALSE;
+	assign(st, other);
+	link = &st->next[w];
+	}
+    }
+return TRUE;
+}
+
+/***********************************************************************
+ *
+ * Propagate the boolean constraints of the subject.
+ *
+ * returns:	TRUE if the subject was changed
+ *
+ ***********************************************************************/
+int
+boolean()
+{
+register BERT_CTX *ctx = bert_ctx;
+register STORE *st;
+register CLAUSE *c;
+register int i;
+STORE store;
+OPS ops;
+NODE **at, *x;
+double start;
+int vars, holds, forced = 0, changed = FALSE;
+
+if (!ctx->subject || (ctx->nedits && !ctx->solved)) return FALSE;
+ops.semi = op_find(ctx->single_op, ";", BINARY);
+ops.and = op_find(ctx->single_op, "&", BINARY);
+ops.or = op_find(ctx->single_op, "|", BINARY);
+ops.implies = op_find(ctx->double_op, "->", BINARY);
+ops.not = op_find(ctx->single_op, "~", PREFIX);
+ops.boolvar = op_find(ctx->type_op, "boolvar", 0);
+if (!ops.semi || !ops.boolvar || ctx->subject->op != ops.semi) return FALSE;
+
+/* the clauses of the chain */
+start = stats_clock();
+st = &store;
+st->vars_size = st->lits_size = st->clauses_size = st->stack_size = 16;
+st->names = (NAME_NODE **) space(st->vars_size * sizeof(NAME_NODE *));
+st->seen = (int *) space(2 * st->vars_size * sizeof(int));
+st->lits = (int *) space(st->lits_size * sizeof(int));
+st->clauses = (CLAUSE *) space(st->clauses_size * sizeof(CLAUSE));
+st->stack = (int *) space(st->stack_size * sizeof(int));
+st->nvars = st->nlits = st->nclauses = st->top = st->stamp = 0;
+st->satisfied = FALSE;
+for (at = &ctx->subject; (*at)->op == ops.semi;
+  at = &((TERM_NODE *) *at)->right) {
+    x = ((TERM_NODE *) *at)->left;
+    if (x->op == ctx->false_op) break;
+    vars = FALSE;
+    if (formula(x, &ops, &vars) && vars) conjoin(st, x, TRUE, -1, &ops);
+    }
+if (x->op == ctx->false_op || !st->nclauses) {
+    free((char *) st->stack);
+    free((char *) st->clauses);
+    free((char *) st->lits);
+    free((char *) st->seen);
+    free((char *) st->names);
+    return FALSE;
+    }
+ctx->stats.boolean++;
+
+/* watch the first two literals of each clause; units hold at once */
+st->value = (int *) space(st->nvars * sizeof(int));
+st->watch = (int *) space(2 * st->nvars * sizeof(int));
+st->next = (int *) space(2 * st->nclauses * sizeof(int));
+st->trail = (int *) space(st->nvars * sizeof(int));
+st->ntrail = st->head = 0;
+for (i = 0; i < st->nvars; i++) st->value[i] = -1;
+for (i = 0; i < 2 * st->nvars; i++) st->watch[i] = -1;
+holds = TRUE;
+for (c = st->clauses; holds && c < st->clauses + st->nclauses; c++) {
+    register int *l = &st->lits[c->at];
+    register int w = 2 * (c - st->clauses);
+    if (c->n >= 2) {
+	st->next[w] = st->watch[l[0]];
+	st->watch[l[0]] = w;
+	st->next[w + 1] = st->watch[l[1]];
+	st->watch[l[1]] = w + 1;
+	}
+    else if (!c->n || TRUTH(st, l[0]) == 0) holds = FALSE;
+    else if (TRUTH(st, l[0]) < 0) assign(st, l[0]);
+    }
+if (holds) holds = propagate(st);
+
+if (!holds) {		/* there is no solution */
+    lp_false();
+    changed = TRUE;
+    }
+else {
+    for (i = 0; i < st->nvars; i++)
+	if (st->names[i] && st->value[i] >= 0) {
+	    st->names[i]->value = lp_truth(st->value[i] ?
+		ctx->true_op : ctx->false_op);
+	    forced++;
+	    }
+    if (forced) {
+	lp_update();
+	ctx->stats.boolean_forced += forced;
+	changed = TRUE;
+	}
+    }
+
+free((char *) st->trail);
+free((char *) st->next);
+free((char *) st->watch);
+free((char *) st->value);
+free((char *) st->stack);
+free((char *) st->clauses);
+free((char *) st->lits);
+free((char *) st->seen);
+free((char *) st->names);
+ctx->stats.boolean_time += stats_clock() - start;
+return changed;
+}
@@ -0,0 +1,776 @@
+/***********************************************************************
+ *
+ * Engine contexts.
+ *
+ * All of the state of the interpreter is kept in a BERT_CTX (see
+ * def.h), so that several independent programs can be loaded and
+ * run in one process, one per thread.  The engine itself finds its
+ * state through bert_ctx, which is private to each thread.  The
+ * entry points below take a context as an argument and make it the
+ * current context of the calling thread before doing any work.
+ *
+ * Typical use:
+ *	ctx = ctx_new();
+ *	ctx_include(ctx, "beep");	.. optional, preload libraries
+ *	if (BERT_OK == ctx_load(ctx, file, "name") &&
+ *	  BERT_OK == ctx_solve(ctx))
+ *	    ctx_print(ctx);
+ *	else fprintf(stderr, "%s\n", ctx->error_msg);
+ *	ctx_free(ctx);
+ *
+ * Errors do not abort the process.  The entry points catch them and
+ * return BERT_ERROR, leaving the message in ctx->error_msg.  A
+ * program is loaded into a region of its own on top of the
+ * preloaded libraries, and a failed load or solve takes that
+ * region (its nodes, operators, rules, names and strings, and the
+ * parse and match stacks) back out, so the context can be used to
+ * load another program.  Loading a program also takes out the
+ * previous one.  A library that fails to load is taken out the
+ * same way.  A program that runs into a step, time or node limit
+ * stays loaded, so that ctx_report can show how far it got.
+ *
+ * ctx_extend is for sessions that feed a context one input at a
+ * time: each input is parsed on top of everything kept so far, and
+ * is kept once it has been parsed.  ctx_edit changes an edit
+ * variable of a solved program (see edit.c).
+ *
+ * A context may be used by only one thread at a time.
+ *
+ ***********************************************************************/
+
+#include "def.h"
+#include <stdlib.h>
+
+CTX_LOCAL BERT_CTX *bert_ctx = NULL;	/* current context of this thread */
+
+/***********************************************************************
+ *
+ * Regions.
+ * region_mark starts a region in the current context, region_release
+ * takes everything in it back out, and region_commit makes it a
+ * permanent part of the context.
+ *
+ ***********************************************************************/
+static void
+region_mark()
+{
+void expr_mark();		/* from expr.c */
+void op_mark();			/* from ops.c */
+register BERT_CTX *ctx = bert_ctx;
+register REGION *r = &ctx->region;
+
+r->level = ++ctx->level;	/* rules built from now on */
+expr_mark(r);
+op_mark(r);
+r->all_strings = ctx->all_strings;
+r->global_refs = ctx->global_names->refs;
+r->global_op = ctx->global_names->op;
+r->rule_verbose = ctx->rule_verbose;
+r->included = ctx->included;
+r->sub_top = ctx->sub_top;
+r->pragma_steps = ctx->pragma_steps;
+r->pragma_time = ctx->pragma_time;
+r->pragma_nodes = ctx->pragma_nodes;
+r->pragma_strategy = ctx->pragma_strategy;
+r->ac_ops = ctx->ac_ops;
+r->nedits = ctx->nedits;
+}
+
+static void
+region_commit()
+{
+void expr_commit();		/* from expr.c */
+
+expr_commit(&bert_ctx->region);
+bert_ctx->region.level = 0;
+}
+
+static void
+region_release()
+{
+void expr_release();		/* from expr.c */
+void op_release();		/* from ops.c */
+void name_space_release();	/* from names.c */
+void char_mem_free();		/* from util.c */
+void st_mem_free();		/* from util.c */
+NODE *subject_pop();		/* from match.c */
+void edit_drop();		/* from edit.c */
+register BERT_CTX *ctx = bert_ctx;
+register REGION *r = &ctx->region;
+int i;
+
+if (!r->level) return;		/* nothing loaded */
+
+/* close any #include files, the first file belongs to the caller */
+while (ctx->filespushed) {
+    fclose(ctx->infile);
+    ctx->filespushed--;
+    ctx->infile = ctx->infiles[ctx->filespushed];
+    }
+ctx->infile = (FILE *) NULL;
+ctx->infilename = NULL;
+
+/* parse and match stacks, and the subject from before the region */
+st_mem_free();
+ctx->pstack = (SNODE *) NULL;
+ctx->stack = (SNODE *) NULL;
+ctx->subject = (NODE *) NULL;
+while (ctx->sub_top != r->sub_top) ctx->subject = subject_pop();
+
+name_space_release(ctx->global_names, r);
+ctx->global_names->refs = r->global_refs;
+ctx->global_names->op = r->global_op;
+ctx->rule_verbose = r->rule_verbose;
+op_release(r);
+expr_release(r);
+ctx->ndomains = ctx->nfd = 0;	/* the domains of its names */
+char_mem_free(r->all_strings);
+ctx->included = r->included;
+ctx->pragma_steps = r->pragma_steps;
+ctx->pragma_time = r->pragma_time;
+ctx->pragma_nodes = r->pragma_nodes;
+ctx->pragma_strategy = r->pragma_strategy;
+ctx->ac_ops = r->ac_ops;
+if (ctx->solved && ctx->solved_level == r->level) edit_drop(TRUE);
+ctx->nedits = r->nedits;
+for (i = 0; !ctx->solved && i < ctx->nedits; i++)	/* names may be gone */
+    ctx->edits[i].var = (NAME_NODE *) NULL;
+
+ctx->learn = ctx->bondage = FALSE;
+ctx->verbose = FALSE;
+ctx->lineno = ctx->charno = 0;
+ctx->scan_class = C_NL;
+ctx->scan_c = '\n';
+ctx->level = r->level - 1;
+r->level = 0;
+}
+
+/***********************************************************************
+ *
+ * An error was caught by an entry point.
+ * Take the region being loaded back out of the context.
+ *
+ ***********************************************************************/
+static int
+caught(ctx)
+BERT_CTX *ctx;
+{
+void st_mem_free();		/* from util.c */
+
+ctx->catch = (jmp_buf *) NULL;
+ctx->ac_ntemps = 0;		/* nodes of a match cut short */
+if (ctx->region.level) region_release();
+else if (ctx->subject) {	/* rewriting a kept session input */
+    st_mem_free();
+    ctx->stack = (SNODE *) NULL;
+    ctx->subject = (NODE *) NULL;	/* may be half rewritten */
+    ctx->learn = ctx->bondage = FALSE;
+    }
+return ctx->error_code;
+}
+
+/***********************************************************************
+ *
+ * Make ctx the current context of this thread.
+ * Returns the previous current context.
+ *
+ ***********************************************************************/
+BERT_CTX *
+ctx_select(ctx)
+BERT_CTX *ctx;
+{
+BERT_CTX *old = bert_ctx;
+
+bert_ctx = ctx;
+return old;
+}
+
+/***********************************************************************
+ *
+ * Allocate a new context, with only the primitive operators.
+ * The context is not selected.
+ *
+ ***********************************************************************/
+BERT_CTX *
+ctx_new()
+{
+NODE *init();			/* from util.c */
+void expr_free();		/* from expr.c */
+register BERT_CTX *ctx;
+BERT_CTX *old;
+
+ctx = (BERT_CTX *) calloc(1, sizeof(BERT_CTX));
+if (!ctx) {
+    fprintf(stderr, "out of memory for engine context\n");
+    exit(1);
+    }
+ctx->rule_verbose = -1;		/* no rules yet */
+ctx->out = stderr;
+ctx->scan_class = C_NL;		/* scanner starts on a new line */
+ctx->scan_c = '\n';
+
+old = ctx_select(ctx);
+ctx->subject = init();		/* init constant operators */
+ctx->main_op = ctx->subject->op;
+expr_free(ctx->subject);	/* each program gets its own */
+ctx->subject = (NODE *) NULL;
+ctx->lineno = 0;
+ctx_select(old);
+return ctx;
+}
+
+/***********************************************************************
+ *
+ * Free a context and all of the memory it owns.
+ *
+ ***********************************************************************/
+void
+ctx_free(ctx)
+BERT_CTX *ctx;
+{
+void op_mem_free();		/* from ops.c */
+void st_mem_free();		/* from util.c */
+void expr_mem_free();		/* from expr.c */
+void char_mem_free();		/* from util.c */
+NODE *subject_pop();		/* from match.c */
+void free();
+BERT_CTX *old = ctx_select(ctx);
+
+while (ctx->filespushed) {	/* close any #include files */
+    fclose(ctx->infile);
+    ctx->filespushed--;
+    ctx->infile = ctx->infiles[ctx->filespushed];
+    }
+while (ctx->sub_top) subject_pop();
+op_mem_free();		/* operators and their rules */
+st_mem_free();		/* stack nodes */
+expr_mem_free();	/* expression nodes */
+char_mem_free((char *) NULL);	/* character strings */
+if (ctx->hashes) free((char *) ctx->hashes);
+if (ctx->hash_rules) free((char *) ctx->hash_rules);
+if (ctx->ac_temps) free((char *) ctx->ac_temps);
+if (ctx->lx_terms) free((char *) ctx->lx_terms);
+if (ctx->edits) free((char *) ctx->edits);
+if (ctx->kept) free((char *) ctx->kept);
+if (ctx->domains) free((char *) ctx->domains);
+if (ctx->fd_vars) free((char *) ctx->fd_vars);
+free((char *) ctx);
+ctx_select(old == ctx ? (BERT_CTX *) NULL : old);
+}
+
+/***********************************************************************
+ *
+ * Preload a library into a context, as if it were #included.
+ * The library is found the same way as #included files, and
+ * later #includes of it are ignored.
+ * Any program loaded into the context is taken out first.
+ *
+ * returns:	BERT_OK, BERT_NOFILE, or BERT_ERROR
+ *
+ ***********************************************************************/
+int
+ctx_include(ctx, name)
+BERT_CTX *ctx;
+char *name;		/* name of library */
+{
+FILE *lib_open();		/* from prep.c */
+char *include_note();		/* from prep.c */
+void parse();			/* from parse.c */
+void edit_drop();		/* from edit.c */
+jmp_buf env;
+FILE *fp;
+
+ctx_select(ctx);
+region_release();	/* libraries go under the program */
+edit_drop(FALSE);
+fp = lib_open(name);
+if (NULL == fp) {
+    snprintf(ctx->error_msg, MAXERROR, "library %s: file not found", name);
+    return ctx->error_code = BERT_NOFILE;
+    }
+if (setjmp(env)) {
+    fclose(fp);
+    return caught(ctx);
+    }
+ctx->catch = &env;
+
+region_mark();
+ctx->infilename = include_note(name);
+if (ctx->infilename) {		/* not already included */
+    ctx->infile = fp;
+    ctx->lineno = 1;
+    ctx->charno = 0;
+    ctx->verbose = FALSE;
+    parse();
+    }
+fclose(fp);
+ctx->infile = (FILE *) NULL;
+ctx->lineno = 0;
+region_commit();
+
+ctx->catch = (jmp_buf *) NULL;
+return BERT_OK;
+}
+
+/***********************************************************************
+ *
+ * Parse a program into a context.
+ * Builds the operator tables and rules, and the initial subject.
+ * Any program loaded before is taken out first.
+ * The file is not closed.
+ *
+ * returns:	BERT_OK or BERT_ERROR
+ *
+ ***********************************************************************/
+int
+ctx_load(ctx, fp, name)
+BERT_CTX *ctx;
+FILE *fp;		/* program */
+char *name;		/* name of program, for error messages */
+{
+NODE *node_new();		/* from expr.c */
+void parse();			/* from parse.c */
+void stats_reset();		/* from stats.c */
+double stats_clock();		/* from stats.c */
+void edit_drop();		/* from edit.c */
+register TERM_NODE *insex;	/* initial subject expression */
+jmp_buf env;
+double start;
+
+ctx_select(ctx);
+region_release();
+edit_drop(FALSE);
+if (setjmp(env)) return caught(ctx);
+ctx->catch = &env;
+
+stats_reset();
+start = stats_clock();
+region_mark();
+
+/* create initial subject expression */
+insex = (TERM_NODE *) node_new();
+insex->op = ctx->main_op;
+insex->label = ctx->global_names;
+ctx->global_names->refs++;	/* since we have a pointer to it */
+insex->left = (NODE *) NULL;
+insex->right = (NODE *) NULL;
+ctx->subject = (NODE *) insex;
+
+ctx->infilename = name;
+ctx->infile = fp;
+ctx->lineno = 1;
+ctx->charno = 0;
+ctx->verbose = FALSE;
+parse();
+ctx->stats.parse_time = stats_clock() - start - ctx->stats.build_time;
+ctx->lineno = 0;	/* to supress error message line numbers */
+
+ctx->catch = (jmp_buf *) NULL;
+return BERT_OK;
+}
+
+/***********************************************************************
+ *
+ * What a solved subject leaves to the next input of a session: the
+ * conjuncts of its top level ; chain that were not solved, and its
+ * value too if that is a constraint (its type is 'boolean or under
+ * it).  Otherwise the value is freed.
+ *
+ * returns:	the residual constraints, or NULL if there are none
+ *
+ ***********************************************************************/
+static NODE *
+residual(ex, semi)
+NODE *ex;
+OP *semi;		/* the ; operator */
+{
+void expr_free();		/* from expr.c */
+void node_free();		/* from expr.c */
+void name_free();		/* from names.c */
+register TERM_NODE *link = (TERM_NODE *) NULL;
+NODE **at = &ex, **last;
+NODE *value;
+OP *type;
+
+while ((*at)->op == semi) {
+    last = at;
+    link = (TERM_NODE *) *at;
+    at = &link->right;
+    }
+value = *at;
+/* the type of a term is its operator's supertype; a name's is its op */
+type = (value->op->arity & OP_TERM) ? value->op->super : value->op;
+for (; type; type = type->super)
+    if (0 == strcmp(type->pname, "boolean")) return ex;
+expr_free(value);
+if (!link) return (NODE *) NULL;
+*last = link->left;
+if (link->label) name_free(link->label);
+node_free((NODE *) link);
+return ex;
+}
+
+/***********************************************************************
+ *
+ * Parse one more input of a session into a context, on top of the
+ * libraries and all of the earlier inputs, whose operators, types,
+ * rules and bound global names stay.  If the input has a main rule,
+ * a new subject is made from it, to be rewritten against the global
+ * names and the constraints that the inputs before left unsolved
+ * (see residual): residual ; main.  The main rule is dropped when the
+ * next input is read.  Else the subject left by the inputs before
+ * stays.
+ *
+ * Only the parse is taken back out if it fails.  Once parsed, the
+ * input is kept, since rewriting changes the global names and older
+ * expressions in place; if ctx_solve then fails, the names bound
+ * until then stay bound and the subject is dropped.
+ *
+ * returns:	BERT_OK or BERT_ERROR
+ *
+ ***********************************************************************/
+int
+ctx_extend(ctx, fp, name)
+BERT_CTX *ctx;
+FILE *fp;		/* input */
+char *name;		/* name of input, for error messages */
+{
+NODE *node_new();		/* from expr.c */
+void expr_free();		/* from expr.c */
+void parse();			/* from parse.c */
+void rule_free();		/* from rules.c */
+void stats_reset();		/* from stats.c */
+double stats_clock();		/* from stats.c */
+NODE *subject_pop();		/* from match.c */
+void subject_push();		/* from match.c */
+void edit_drop();		/* from edit.c */
+OP *op_find();			/* from ops.c */
+register TERM_NODE *insex;	/* initial subject expression */
+register TERM_NODE *link;
+register RULE *rr;
+NODE *old;
+OP *semi;
+jmp_buf env;
+double start;
+
+ctx_select(ctx);
+if (ctx->region.level) region_commit();	/* a program loaded before stays */
+while ((rr = ctx->main_op->hash)) {	/* already used */
+    ctx->main_op->hash = rr->next;
+    rule_free(rr);
+    }
+if (setjmp(env)) return caught(ctx);	/* the old subject comes back */
+ctx->catch = &env;
+
+stats_reset();
+start = stats_clock();
+region_mark();
+subject_push(ctx->subject);
+ctx->subject = (NODE *) NULL;
+
+ctx->infilename = name;
+ctx->infile = fp;
+ctx->lineno = 1;
+ctx->charno = 0;
+ctx->verbose = FALSE;
+parse();
+ctx->stats.parse_time = stats_clock() - start - ctx->stats.build_time;
+ctx->lineno = 0;
+region_commit();
+
+old = subject_pop();
+if (!ctx->main_op->hash) ctx->subject = old;
+else {		/* rewrite main against the global names */
+    semi = op_find(ctx->single_op, ";", BINARY);
+    if (old && semi) old = residual(old, semi);
+    else if (old) {
+	expr_free(old);
+	old = (NODE *) NULL;
+	}
+    edit_drop(FALSE);		/* edit variables are free again */
+    insex = (TERM_NODE *) node_new();
+    insex->op = ctx->main_op;
+    insex->label = ctx->global_names;
+    ctx->global_names->refs++;
+    insex->left = (NODE *) NULL;
+    insex->right = (NODE *) NULL;
+    ctx->subject = (NODE *) insex;
+    if (old) {		/* the constraints left unsolved come first */
+	link = (TERM_NODE *) node_new();
+	link->op = semi;
+	link->label = (NAME_NODE *) NULL;
+	link->left = old;
+	link->right = (NODE *) insex;
+	ctx->subject = (NODE *) link;
+	}
+    }
+
+ctx->catch = (jmp_buf *) NULL;
+return BERT_OK;
+}
+
+/***********************************************************************
+ *
+ * Take the program loaded into a context back out,
+ * leaving only the preloaded libraries.
+ *
+ ***********************************************************************/
+void
+ctx_reset(ctx)
+BERT_CTX *ctx;
+{
+void edit_drop();		/* from edit.c */
+
+ctx_select(ctx);
+region_release();
+edit_drop(FALSE);
+}
+
+/***********************************************************************
+ *
+ * Apply rules to the subject expression until none match, or until
+ * a limit is used up, leaving the message in ctx->error_msg.
+ *
+ * returns:	TRUE if it stopped at a limit
+ *
+ ***********************************************************************/
+int
+rewrite(ctx)
+BERT_CTX *ctx;
+{
+NODE *walk();			/* from match.c */
+double stats_clock();		/* from stats.c */
+void cycle_start();		/* from cycle.c */
+void ac_normal();		/* from ac.c */
+int simplex();			/* from simplex.c */
+int interval();			/* from interval.c */
+int newton();			/* from newton.c */
+int fd();			/* from fd.c */
+int boolean();			/* from boolean.c */
+int split();			/* from split.c */
+long dedup();			/* from dedup.c */
+double start;
+int parts = ctx->parts > 1 && !ctx->nedits && !ctx->verbose;
+int limited;
+long sweep = 0;		/* rewrites before the next sweep for duplicates */
+long steps, nodes;
+long base = ctx->stats.nodes_live;	/* nodes in use before rewriting */
+double seconds;
+
+/* the smaller of the limits of the caller and of the program */
+steps = ctx->step_limit;
+if (ctx->pragma_steps && (!steps || ctx->pragma_steps < steps))
+    steps = ctx->pragma_steps;
+seconds = ctx->time_limit;
+if (ctx->pragma_time > 0.0 && (seconds <= 0.0 || ctx->pragma_time < seconds))
+    seconds = ctx->pragma_time;
+nodes = ctx->node_limit;
+if (ctx->pragma_nodes && (!nodes || ctx->pragma_nodes < nodes))
+    nodes = ctx->pragma_nodes;
+
+/* the strategy of the caller, else of the program */
+if (ctx->strategy) ctx->reduction = ctx->strategy;
+else if (ctx->pragma_strategy) ctx->reduction = ctx->pragma_strategy;
+else ctx->reduction = OUTERMOST;
+if (ctx->ac_ops) ac_normal(ctx->subject);
+if (ctx->cycle_window) cycle_start(ctx->subject);
+ctx->quiet++;		/* rules or types may have changed */
+ctx->ndomains = 0;	/* bounds are of this answer */
+
+if (ctx->verbose) fprintf(stderr, "\n");
+start = stats_clock();
+do {	/* apply rules to subject expression */
+    ctx->subject = walk(ctx->subject);
+    if (parts && split(&limited)) {	/* once, when it is a conjunction */
+	parts = FALSE;
+	if (limited) {
+	    ctx->learn = TRUE;
+	    break;
+	    }
+	}
+    /* drop duplicate conjuncts now and then, and before the solvers */
+    if (!ctx->learn || ctx->stats.rewrites >= sweep)
+	sweep = ctx->stats.rewrites + dedup();
+    if (!ctx->learn) {	/* no rule matches: try the solvers */
+	if (!simplex() && !interval() && !newton() && !fd() && !boolean())
+	    break;
+	ctx->learn = TRUE;
+	}
+    if (ctx->cycle_length) {
+	snprintf(ctx->error_msg, MAXERROR,
+	    "rewrite cycle of %d rewrites found", ctx->cycle_length);
+	break;
+	}
+    if (steps && ctx->stats.rewrites >= steps) {
+	snprintf(ctx->error_msg, MAXERROR,
+	    "step limit of %ld rewrites exceeded", steps);
+	break;
+	}
+    if (seconds > 0.0 && stats_clock() - start > seconds) {
+	snprintf(ctx->error_msg, MAXERROR,
+	    "time limit of %g seconds exceeded", seconds);
+	break;
+	}
+    if (nodes && ctx->stats.nodes_live - base > nodes) {
+	snprintf(ctx->error_msg, MAXERROR,
+	    "node limit of %ld new expression nodes exceeded", nodes);
+	break;
+	}
+    } while (TRUE);
+
+if (ctx->learn) {	/* ran out of steps, time or nodes, or cycled */
+    ctx->learn = FALSE;
+    return TRUE;
+    }
+return FALSE;
+}
+
+/***********************************************************************
+ *
+ * Apply rules to the subject expression until none match.
+ * The final subject expression is left in ctx->subject.
+ *
+ * Rewriting stops early if it uses up the step, time or node limit
+ * of the context, or a smaller one set by #limit in the program.
+ * The subject is then left as far as it got, for ctx_report.
+ *
+ * A program with edit variables is solved for them, and then
+ * rewritten again with their values (see edit.c).  Once it has
+ * been, and only their values have changed since, only that second
+ * rewriting is done.
+ *
+ * returns:	BERT_OK, BERT_ERROR or BERT_LIMIT
+ *
+ ***********************************************************************/
+int
+ctx_solve(ctx)
+BERT_CTX *ctx;
+{
+double stats_clock();		/* from stats.c */
+void edit_keep();		/* from edit.c */
+void edit_apply();		/* from edit.c */
+void edit_check();		/* from edit.c */
+jmp_buf env;
+double start;
+int limited;
+
+ctx_select(ctx);
+if (!ctx->subject && !(ctx->solved && ctx->edits_changed)) {
+    snprintf(ctx->error_msg, MAXERROR, "no program loaded");
+    return ctx->error_code = BERT_ERROR;
+    }
+if (setjmp(env)) return caught(ctx);
+ctx->catch = &env;
+
+start = stats_clock();
+if (ctx->solved && ctx->edits_changed) {	/* an edit */
+    edit_check();
+    edit_apply();
+    limited = rewrite(ctx);
+    ctx->stats.edits++;
+    ctx->stats.edit_time = stats_clock() - start;
+    }
+else {
+    limited = rewrite(ctx);
+    if (!limited && ctx->nedits && !ctx->solved) {
+	edit_keep();
+	edit_apply();
+	limited = rewrite(ctx);
+	}
+    }
+ctx->stats.rewrite_time = stats_clock() - start;
+
+ctx->catch = (jmp_buf *) NULL;
+if (limited) return ctx->error_code = BERT_LIMIT;
+return BERT_OK;
+}
+
+/***********************************************************************
+ *
+ * Give an edit variable of the program a new value, and solve the
+ * program again from its solved form.
+ *
+ * returns:	BERT_OK, BERT_ERROR or BERT_LIMIT
+ *
+ ***********************************************************************/
+int
+ctx_edit(ctx, name, value)
+BERT_CTX *ctx;
+char *name;		/* edit variable */
+double value;
+{
+int edit_find();		/* from edit.c */
+int i;
+
+ctx_select(ctx);
+if (!ctx->solved) {
+    snprintf(ctx->error_msg, MAXERROR, "no program solved for edits");
+    return ctx->error_code = BERT_ERROR;
+    }
+if (0 > (i = edit_find(name))) {
+    snprintf(ctx->error_msg, MAXERROR, "%s is not an edit variable", name);
+    return ctx->error_code = BERT_ERROR;
+    }
+ctx->edits[i].value = value;
+ctx->edits_changed = TRUE;
+return ctx_solve(ctx);
+}
+
+/***********************************************************************
+ *
+ * Report on a program that ran into a limit: print the subject as
+ * far as it was rewritten, and the n rules that fired most often,
+ * or the rules of the rewrite cycle it was stopped in.
+ *
+ ***********************************************************************/
+void
+ctx_report(ctx, n)
+BERT_CTX *ctx;
+int n;			/* how many rules */
+{
+void expr_print();		/* from expr.c */
+void rule_top();		/* from rules.c */
+void cycle_print();		/* from cycle.c */
+
+ctx_select(ctx);
+if (!ctx->subject) return;
+fprintf(ctx->out, "partial expression is: ");
+expr_print(ctx->subject);
+if (ctx->cycle_length) {
+    fprintf(ctx->out, "\nrules in cycle:\n");
+    cycle_print();
+    return;
+    }
+fprintf(ctx->out, "\nrules fired most:\n");
+rule_top(n);
+}
+
+/***********************************************************************
+ *
+ * Print the final subject expression (and, if tracing, the
+ * global name space; with --bounds, the bounds of its variables).
+ *
+ ***********************************************************************/
+void
+ctx_print(ctx)
+BERT_CTX *ctx;
+{
+void expr_print();		/* from expr.c */
+void name_space_print();	/* from names.c */
+void interval_print();		/* from interval.c */
+double stats_clock();		/* from stats.c */
+double start;
+
+ctx_select(ctx);
+if (!ctx->subject) return;
+if (ctx->verbose && ctx->global_names->child) {
+    fprintf(ctx->out, "\nglobal name space is: ");
+    name_space_print(ctx->global_names);
+    }
+start = stats_clock();
+if (ctx->verbose) fprintf(ctx->out, "\nfinal expression is: ");
+expr_print(ctx->subject);
+fprintf(ctx->out, "\n");
+if (bounds) interval_print();
+ctx->stats.print_time = stats_clock() - start;
+}
@@ -0,0 +1,250 @@
+/***********************************************************************
+ *
+ * Rewrite cycle detection.
+ *
+ * Rule sets that oscillate (e.g. a pair of rules that commute the
+ * arguments of an operator back and forth) never finish.  When
+ * cycle_window is set, walk() keeps a fingerprint of the subject
+ * expression up to date as it rewrites, and the fingerprints after
+ * the last cycle_window rewrites are remembered.  If the subject
+ * comes back to the same fingerprint twice, with the same number of
+ * rewrites in between, ctx_solve stops and the rules that fired in
+ * that cycle can be printed with cycle_print.
+ *
+ * The fingerprint of an expression is
+ *
+ *	sum over its nodes n of  g(n) * w(path to n)
+ *
+ * where g is a scrambled hash of the contents of the node (operator,
+ * label, name, number or string), and w is a rolling hash of the
+ * left/right steps from the root down to the node, so that the same
+ * subexpression in a different place counts differently.  Since
+ *
+ *	w(p followed by q) = w(p) * M^length(q) + w(q starting from 0)
+ *
+ * the part of the fingerprint that comes from a subexpression at p
+ * is w(p) * S1 + S2, with S1 and S2 depending only on the
+ * subexpression.  Replacing the redex then only takes the sums of
+ * the old redex and of what replaces it, and the path down to it
+ * from the walk stack: no more work than the rewrite itself did.
+ * Only when a variable is bound, and walk() updates the whole
+ * subject anyway, is the whole fingerprint computed again.
+ *
+ * Names count by identity.  Fresh local names are new nodes, so a
+ * rule that makes new names each time it fires is not a cycle.
+ *
+ ***********************************************************************/
+
+#include "def.h"
+
+#define SEED	0x9e3779b97f4a7c15UL	/* w of the root */
+#define M	0xbf58476d1ce4e5b9UL	/* odd multiplier of the path hash */
+#define STEP_L	0x94d049bb133111ebUL	/* a step to the left child */
+#define STEP_R	0x2545f4914f6cdd1dUL	/* a step to the right child */
+
+#define WR	1	/* walk right next, as in match.c */
+
+typedef unsigned long HASH;
+
+/* scramble the bits of a word (the splitmix64 finalizer) */
+static HASH
+mix(x)
+HASH x;
+{
+x ^= x >> 30;
+x *= 0xbf58476d1ce4e5b9UL;
+x ^= x >> 27;
+x *= 0x94d049bb133111ebUL;
+x ^= x >> 31;
+return x;
+}
+
+/* hash of the contents of one node */
+static HASH
+node_hash(n)
+NODE *n;
+{
+register HASH h = mix((HASH) n->op);
+register char *s;
+
+if (n->op->arity & OP_TERM) {
+    if (((TERM_NODE *) n)->label) h += mix((HASH) ((TERM_NODE *) n)->label + 1);
+    }
+else if (n->op->arity & OP_NAME) h = mix((HASH) n + 2);
+else if (n->op->arity & OP_NUM) {
+    union { double d; HASH h; } v;
+    v.h = 0;
+    v.d = ((NUM_NODE *) n)->value;
+    h += mix(v.h + 3);
+    }
+else if (n->op->arity & OP_STR) {
+    for (s = ((STR_NODE *) n)->value; s && *s; s++) h = h * 31 + *s;
+    h = mix(h + 4);
+    }
+return h;
+}
+
+/***********************************************************************
+ *
+ * Add the sums S1 and S2 of a subexpression (see above) into s1, s2.
+ * pow is M to the depth below the subexpression, rel the path hash
+ * from the subexpression down to this node.
+ *
+ ***********************************************************************/
+static void
+sums(n, pow, rel, s1, s2)
+register NODE *n;
+HASH pow, rel;
+HASH *s1, *s2;
+{
+register HASH g;
+
+while (n) {
+    g = node_hash(n);
+    *s1 += g * pow;
+    *s2 += g * rel;
+    if (!(n->op->arity & OP_TERM)) return;
+    if (((TERM_NODE *) n)->left && ((TERM_NODE *) n)->right)
+	sums(((TERM_NODE *) n)->left, pow * M, rel * M + STEP_L, s1, s2);
+    else if (((TERM_NODE *) n)->left) {		/* just one child */
+	n = ((TERM_NODE *) n)->left;
+	pow *= M;
+	rel = rel * M + STEP_L;
+	continue;
+	}
+    n = ((TERM_NODE *) n)->right;
+    pow *= M;
+    rel = rel * M + STEP_R;
+    }
+}
+
+/* the part of the fingerprint from subexpression n at path weight w */
+static HASH
+part(n, w)
+NODE *n;
+HASH w;
+{
+HASH s1 = 0, s2 = 0;
+
+sums(n, (HASH) 1, (HASH) 0, &s1, &s2);
+return w * s1 + s2;
+}
+
+/***********************************************************************
+ *
+ * Start fingerprinting a subject, at the start of ctx_solve.
+ *
+ ***********************************************************************/
+void
+cycle_start(subject)
+NODE *subject;
+{
+void *malloc();
+register BERT_CTX *ctx = bert_ctx;
+
+if (ctx->cycle_window > MAXWINDOW) ctx->cycle_window = MAXWINDOW;
+if (!ctx->hashes) {
+    ctx->hashes = (HASH *) malloc(MAXWINDOW * sizeof(HASH));
+    ctx->hash_rules = (RULE **) malloc(MAXWINDOW * sizeof(RULE *));
+    if (!ctx->hashes || !ctx->hash_rules)
+	error("out of memory for cycle detection");
+    }
+ctx->hash_count = 0;
+ctx->cycle_length = 0;
+ctx->subject_hash = part(subject, SEED);
+}
+
+/***********************************************************************
+ *
+ * The redex at the top of the walk stack is about to be rewritten:
+ * take it out of the fingerprint, and remember where it was.
+ *
+ ***********************************************************************/
+void
+cycle_out(redex)
+NODE *redex;
+{
+register BERT_CTX *ctx = bert_ctx;
+register SNODE *stn;
+register OP *op;
+HASH pow = 1, w = 0;
+int left;
+
+/* path hash, from the bottom of the path up */
+for (stn = ctx->stack; stn; stn = stn->next) {
+    op = stn->node->op;
+    if (op->arity & BINARY) left = (stn->info == WR);
+    else left = (op->arity == POSTFIX);
+    w += (left ? STEP_L : STEP_R) * pow;
+    pow *= M;
+    }
+ctx->path_weight = w + SEED * pow;
+ctx->subject_hash -= part(redex, ctx->path_weight);
+}
+
+/* and put what replaced it back in */
+void
+cycle_in(body)
+NODE *body;
+{
+bert_ctx->subject_hash += part(body, bert_ctx->path_weight);
+}
+
+/* a variable was bound, and the whole subject updated */
+void
+cycle_rehash(subject)
+NODE *subject;
+{
+bert_ctx->subject_hash = part(subject, SEED);
+}
+
+/***********************************************************************
+ *
+ * Note the fingerprint after a rewrite by rule rr, and look back
+ * for a cycle.  If the subject had the same fingerprint k rewrites
+ * ago and 2k rewrites ago, cycle_length is set to k.
+ *
+ ***********************************************************************/
+void
+cycle_note(rr)
+RULE *rr;
+{
+register BERT_CTX *ctx = bert_ctx;
+register HASH h = ctx->subject_hash;
+register long t = ctx->hash_count++;
+register int w = ctx->cycle_window;
+register int k;
+
+ctx->hashes[t % w] = h;
+ctx->hash_rules[t % w] = rr;
+for (k = 1; 2 * k < w && 2 * k <= t; k++) {
+    if (ctx->hashes[(t - k) % w] == h &&
+      ctx->hashes[(t - 2 * k) % w] == h) {
+	ctx->cycle_length = k;
+	return;
+	}
+    }
+}
+
+/***********************************************************************
+ *
+ * Print the rules of the cycle found, in the order they fired.
+ *
+ ***********************************************************************/
+void
+cycle_print()
+{
+void expr_print();		/* from expr.c */
+register BERT_CTX *ctx = bert_ctx;
+register RULE *rr;
+long t;
+
+for (t = ctx->hash_count - ctx->cycle_length; t < ctx->hash_count; t++) {
+    rr = ctx->hash_rules[t % ctx->cycle_window];
+    fprintf(ctx->out, "    ");
+    expr_print(rr->head);
+    fprintf(ctx->out, " { ");
+    expr_print(rr->body);
+    fprintf(ctx->out, " }\n");
+    }
+}
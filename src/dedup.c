@@ -0,0 +1,186 @@
+/***********************************************************************
+ *
+ * Duplicate constraints.
+ *
+ * Records make the same equation more than once: p = q for two
+ * points of bag is p.x = q.x & p.y = q.y, and the lines of a shape
+ * meet in the same points, so a constraint can be put in the ; chain
+ * of the subject again and again.  Each copy would be put in linear
+ * form, solved and then checked on its own, and the copies of a
+ * nonlinear equation make a set of equations that has more equations
+ * than variables (see newton.c).
+ *
+ * Now and then while rewriting (see rewrite in ctx.c), and each time
+ * before the solvers are tried, the conjuncts of the top level chain
+ * (but the last, which is the answer) are put in a hash table, and
+ * one that is the same as a conjunct before it is dropped, as is one
+ * that is just true.  Only relations (= ~= < <= > >=) are dropped as
+ * duplicates: other conjuncts, like the x! of an output, mean
+ * something each time they are there.  Names are the same only if
+ * they are the same name, and a conjunct with a label is kept.
+ *
+ * A sweep looks at each node of the chain once, so the next one
+ * waits for as many rewrites as there were nodes, and a chain is
+ * never swept more often than it is rewritten.
+ *
+ ***********************************************************************/
+
+#include "def.h"
+#include <string.h>
+
+#define MINSWEEP	64	/* fewest rewrites between sweeps */
+
+/* from other modules */
+OP *op_find();			/* from ops.c */
+void expr_free();		/* from expr.c */
+void node_free();		/* from expr.c */
+void cycle_rehash();		/* from cycle.c */
+double stats_clock();		/* from stats.c */
+void free();
+
+/* a conjunct in the hash table */
+typedef struct seen {
+	unsigned long hash;
+	NODE *x;		/* NULL if the slot is empty */
+	} SEEN;
+
+#define space(n)	mem_get((size_t) (n), "duplicate constraints")
+
+/***********************************************************************
+ *
+ * Hash an expression, counting its nodes in *n.
+ *
+ ***********************************************************************/
+static unsigned long
+hash(x, n)
+register NODE *x;
+long *n;
+{
+register unsigned long h = 0;
+register char *s;
+
+while (x) {
+    (*n)++;
+    h = h * 1000003 + (unsigned long) x->op;
+    if (x->op->arity & OP_NAME) return h * 1000003 + (unsigned long) x;
+    if (x->op->arity & OP_NUM) {
+	union { double d; unsigned long u; } v;
+	v.u = 0;
+	v.d = ((NUM_NODE *) x)->value;
+	return h * 1000003 + v.u;
+	}
+    if (x->op->arity & OP_STR) {
+	for (s = ((STR_NODE *) x)->value; s && *s; s++) h = h * 31 + *s;
+	return h;
+	}
+    if (((TERM_NODE *) x)->label)
+	h = h * 1000003 + (unsigned long) ((TERM_NODE *) x)->label;
+    if (((TERM_NODE *) x)->left)
+	h = h * 1000003 + hash(((TERM_NODE *) x)->left, n);
+    x = ((TERM_NODE *) x)->right;
+    }
+return h;
+}
+
+/***********************************************************************
+ *
+ * Are two expressions the same?  Names by identity.
+ *
+ ***********************************************************************/
+static int
+same(a, b)
+register NODE *a, *b;
+{
+while (a != b) {
+    if (!a || !b || a->op != b->op) return FALSE;
+    if (a->op->arity & OP_NAME) return FALSE;
+    if (a->op->arity & OP_NUM)
+	return ((NUM_NODE *) a)->value == ((NUM_NODE *) b)->value;
+    if (a->op->arity & OP_STR)
+	return 0 == strcmp(((STR_NODE *) a)->value, ((STR_NODE *) b)->value);
+    if (((TERM_NODE *) a)->label != ((TERM_NODE *) b)->label) return FALSE;
+    if (!same(((TERM_NODE *) a)->left, ((TERM_NODE *) b)->left))
+	return FALSE;
+    a = ((TERM_NODE *) a)->right;
+    b = ((TERM_NODE *) b)->right;
+    }
+return TRUE;
+}
+
+/***********************************************************************
+ *
+ * Sweep the chain of the subject for duplicate and true conjuncts.
+ *
+ * returns:	the rewrites to wait before the next sweep
+ *
+ ***********************************************************************/
+long
+dedup()
+{
+register BERT_CTX *ctx = bert_ctx;
+OP *semi, *rel[6];
+SEEN *table;
+register SEEN *e;
+NODE **at, *x, *stop = NULL;
+register TERM_NODE *c;
+long nodes = 0, dropped = 0;
+unsigned long h, mask;
+int n, i;
+double start;
+
+semi = op_find(ctx->single_op, ";", BINARY);
+if (!semi || !ctx->subject || ctx->subject->op != semi) return MINSWEEP;
+rel[0] = op_find(ctx->single_op, "=", BINARY);
+rel[1] = op_find(ctx->double_op, "~=", BINARY);
+rel[2] = op_find(ctx->single_op, "<", BINARY);
+rel[3] = op_find(ctx->double_op, "<=", BINARY);
+rel[4] = op_find(ctx->single_op, ">", BINARY);
+rel[5] = op_find(ctx->double_op, ">=", BINARY);
+
+start = stats_clock();
+for (n = 0, x = ctx->subject; x->op == semi; x = ((TERM_NODE *) x)->right)
+    n++;
+for (mask = 15; mask < 2 * (unsigned long) n; mask = 2 * mask + 1);
+table = (SEEN *) space((mask + 1) * sizeof(SEEN));
+memset((char *) table, 0, (mask + 1) * sizeof(SEEN));
+
+for (at = &ctx->subject; (*at)->op == semi; ) {
+    c = (TERM_NODE *) *at;
+    x = c->left;
+    if (!c->label && x->op == ctx->true_op && !((TERM_NODE *) x)->label)
+	goto drop;
+    for (i = 0; i < 6; i++) if (x->op == rel[i]) break;
+    if (c->label || i == 6 || ((TERM_NODE *) x)->label) {
+	nodes++;
+	at = &c->right;
+	continue;
+	}
+    h = hash(x, &nodes);
+    for (e = &table[h & mask]; e->x; e = &table[(e - table + 1) & mask])
+	if (e->hash == h && same(e->x, x)) break;
+    if (!e->x) {	/* the first of its kind */
+	e->hash = h;
+	e->x = x;
+	at = &c->right;
+	continue;
+	}
+drop:
+    *at = c->right;
+    stop = c->right;
+    expr_free(c->left);
+    node_free((NODE *) c);
+    dropped++;
+    }
+free((char *) table);
+
+if (dropped) {
+    /* what follows the links before the last one dropped has changed */
+    for (x = ctx->subject; x != stop; x = ((TERM_NODE *) x)->right)
+	((TERM_NODE *) x)->quiet = 0;
+    if (ctx->cycle_window) cycle_rehash(ctx->subject);
+    }
+ctx->stats.dedup++;
+ctx->stats.dedup_dropped += dropped;
+ctx->stats.dedup_time += stats_clock() - start;
+return nodes > MINSWEEP ? nodes : MINSWEEP;
+}
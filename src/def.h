@@ -7,6 +7,7 @@ static char notice[] = "Copyright (c) 1988 Wm Leler";
 
 #include <stdio.h>
 #include <string.h>
+#include <setjmp.h>
 
 /* Location to look for #included files in */
 #ifndef LIBDIR
@@ -25,9 +26,62 @@ static char notice[] = "Copyright (c) 1988 Wm Leler";
 #define MAXTOKEN 1023           /* maximum length of an input token */
                                 /* including strings! */
 #define MAXFILES 16             /* max input files (max depth of #includes) */
+#define MAXINCLUDES 64          /* max different files #included */
+#define MAXERROR 512            /* max length of an error message */
+#define MAXWINDOW 4096          /* max rewrites looked back for a cycle */
+#define MAXTOP 20               /* most rules rule_top will print */
 
 extern void error();	/* print error message routine, from util.c */
-extern int verbose;	/* print debugging info, from main.c */
+extern void *mem_get(size_t, char *);		/* malloc or error, from util.c */
+extern void *mem_grow(void *, size_t, char *);	/* realloc or error, from util.c */
+
+/* Run statistics, printed by the --stats switch (see stats.c) */
+typedef struct stats {
+	double parse_time;	/* seconds spent parsing (less rule_build) */
+	double build_time;	/* seconds spent in rule_build */
+	double rewrite_time;	/* seconds spent rewriting the subject */
+	double print_time;	/* seconds spent printing the answer */
+	long passes;		/* calls to walk() */
+	long rewrites;		/* rules fired */
+	long updates;		/* full-subject expr_update calls */
+	long skipped;		/* quiet terms walk() did not search */
+	long agenda;		/* rewrites of conjuncts taken out of turn */
+	long nodes_alloc;	/* expression nodes handed out */
+	long nodes_freed;	/* expression nodes given back */
+	long nodes_live;	/* expression nodes in use */
+	long nodes_high;	/* high water mark of nodes_live */
+	long node_bytes;	/* bytes of expression node memory */
+	long snodes_get;	/* stack nodes handed out */
+	long snodes_live;	/* stack nodes in use */
+	long snodes_high;	/* high water mark of snodes_live */
+	long snode_bytes;	/* bytes of stack node memory */
+	long op_used;		/* bytes of operator memory in use */
+	long op_bytes;		/* bytes of operator memory allocated */
+	long edits;		/* re-solves after an edit */
+	double edit_time;	/* seconds spent on the last of them */
+	long simplex;		/* linear programs solved (simplex.c) */
+	double simplex_time;	/* seconds spent on them */
+	long newton;		/* nonlinear sets tried (newton.c) */
+	double newton_time;	/* seconds spent on them */
+	long interval;		/* interval propagations (interval.c) */
+	double interval_time;	/* seconds spent on them */
+	long fd;		/* finite domain searches (fd.c) */
+	long fd_failures;	/* dead ends they ran into */
+	double fd_time;		/* seconds spent on them */
+	long boolean;		/* boolean propagations (boolean.c) */
+	long boolean_forced;	/* boolvars they bound */
+	double boolean_time;	/* seconds spent on them */
+	long split;		/* subjects split into parts (split.c) */
+	long split_components;	/* independent components found in them */
+	long split_parts;	/* child processes they were solved in */
+	double split_time;	/* seconds spent on them, wall clock */
+	long dedup;		/* sweeps for duplicate conjuncts (dedup.c) */
+	long dedup_dropped;	/* conjuncts they dropped */
+	double dedup_time;	/* seconds spent on them */
+	} STATS;
+
+extern int statistics;	/* print statistics, from stats.c */
+extern int bounds;	/* print bounds, from interval.c */
 
 /* token types, returned from scan()				*/
 #define OPER	301	/* user defined operator		*/
@@ -64,6 +118,8 @@ typedef struct rule {
 	struct namenode *space;	/* local name space */
 	short size;		/* number of label names in rule */
 	short verbose;		/* trace */
+	int level;		/* load level (see ctx.c) */
+	long fired;		/* times used in this program */
 	} RULE, *RULE_PTR;
 
 typedef struct snode {		/* stack nodes */
@@ -84,6 +140,9 @@ typedef	struct op {
 	struct rule *hash;		/* rules this operator is root of */
 	struct op *super;		/* supertype */
 	struct op *other;		/* friend operator */
+	unsigned char strategy;		/* INNERMOST or OUTERMOST, */
+					/* 0 to use the default */
+	unsigned char ac;		/* AC_COMM, and AC_ASSOC if ac */
 	unsigned char length;		/* length of print name */
 	char pname[1];			/* first char of print name */
 	/* other characters follow ... */
@@ -117,6 +176,19 @@ typedef	struct op {
 #define OUTFIX1		0x2004	/* starting outfix (matchfix) */
 #define OUTFIX2		0x2008	/* finishing outfix (matchfix) */
 
+/* Reduction strategies (see walk in match.c) */
+#define OUTERMOST	1	/* try a term before its arguments */
+#define INNERMOST	2	/* try a term after its arguments */
+#define PARALLEL	3	/* outermost, and rewrite every redex */
+				/* found in a pass (default only) */
+
+/* Associative and commutative operators (see ac.c) */
+#define AC_COMM		1	/* commutative */
+#define AC_ASSOC	2	/* and associative */
+#define MAXHEAD		32	/* max arguments of an ac term in a rule head */
+
+#define MAXMOVED	16	/* max parameters moved into a rule body */
+
 /* Nodes that live in expressions (shouldn't stow thrones) */
 
 /* expression term node */
@@ -125,6 +197,7 @@ typedef struct termnode {
 	struct namenode	*label;	/* optional label for node */
 	struct node *right;	/* right child (optional) */
 	struct node *left;	/* left child (optional) */
+	long quiet;		/* nothing in it matched, in pass (match.c) */
 	} TERM_NODE, *TERM_NODE_PTR;
 
 /* name node */
@@ -135,8 +208,13 @@ typedef struct namenode {
 	struct namenode *child;	 /* children of this name */
 	char *pval;		 /* print value of name */
 	struct node *value;	 /* also used during instantiation */
-	short refs;		 /* reference count for garbage collection */
-	short interest;		 /* how interesting is this variable? */
+	int refs;		 /* reference count for garbage collection */
+	int domain;		 /* its interval (numvar, interval.c), finite */
+				 /* domain (intvar, fd.c) or clause variable */
+				 /* (boolvar, boolean.c) + 1, if it has one */
+	short edit;		 /* edit variable number, 0 if not (edit.c) */
+	short uses;		 /* of a parameter: 1 + times it is in the */
+				 /* body of its rule, else 0 (rules.c) */
 	} NAME_NODE, *NAME_NODE_PTR;
 
 /* numeric constant node */
@@ -151,6 +229,39 @@ typedef struct stringnode {
 	char	*value;		/* actual string */
 	} STR_NODE, *STR_NODE_PTR;
 
+/* an edit variable, from #edit (edit.c) */
+typedef struct edit {
+	char *name;		/* global name, may be dotted */
+	double value;		/* its value */
+	struct namenode *var;	/* the name, once it has been made */
+	} EDIT;
+
+/* a name kept with the solved form, and its value then (edit.c) */
+typedef struct kept {
+	struct namenode *name;
+	struct node *value;	/* NULL if it was free */
+	} KEPT;
+
+/* a term of a linear expression, while it is being worked on (lx.c) */
+typedef struct lxterm {
+	struct node *var;	/* variable, or something not linear */
+	double coef;		/* its coefficient */
+	int seq;		/* order it was found in */
+	} LX_TERM;
+
+/* the bounds found for a variable (interval.c) */
+typedef struct interval {
+	struct namenode *var;
+	double lo, hi;		/* may be infinite */
+	int shown;		/* printed yet? */
+	} INTERVAL;
+
+/* an intvar and the bounds it was declared with (fd.c) */
+typedef struct fdvar {
+	struct namenode *var;
+	int lo, hi;
+	} FD_VAR;
+
 /* this union is used only to determine the maximum size of a node */
 union maxnode {
 	struct termnode t;
@@ -168,3 +279,201 @@ typedef struct node {
 	char filler[sizeof(union maxnode) -
 	    (sizeof(struct op *) + sizeof(struct node *))];
 	} NODE, *NODE_PTR;
+
+/* Engine context.
+ * Everything a running interpreter needs lives here, so that several
+ * programs can be run at once (one per thread) in the same process.
+ * bert_ctx points to the context of the current thread; the entry
+ * points in ctx.c select a context before calling into the engine.
+ */
+
+/* Result codes of the entry points in ctx.c */
+#define BERT_OK		0	/* success */
+#define BERT_ERROR	1	/* error, message is in error_msg */
+#define BERT_NOFILE	2	/* file could not be opened */
+#define BERT_LIMIT	3	/* step, time or node limit exceeded */
+
+/* A region is everything added to a context by one load (a library
+ * or a program): expression nodes, operators, rules, global names
+ * and #included files.  It is recorded by region_mark (ctx.c), and
+ * can be taken back out of the context by region_release.
+ */
+typedef struct region {
+	int level;		/* load level of its rules, 0 if not open */
+	NODE *all_expr_mem;	/* expression node memory before region */
+	NODE *expr_mem;		/* free expression nodes before region */
+	long nodes_live;	/* expression nodes in use before region */
+	long node_bytes;	/* expression node memory before region */
+	char *op_mem;		/* operator memory block before region */
+	int free_byte;		/* next free byte in that block */
+	long op_used;		/* operator memory used before region */
+	long op_bytes;		/* operator memory before region */
+	char *all_strings;	/* character strings before region */
+	int global_refs;	/* references to global name space */
+	OP *global_op;		/* type of global name space */
+	int rule_verbose;	/* verbose setting of previous rule */
+	int included;		/* number of files #included */
+	struct sub_stack *sub_top;	/* subject stack before region */
+	long pragma_steps;	/* #limit settings before region */
+	double pragma_time;
+	long pragma_nodes;
+	int pragma_strategy;	/* #strategy setting before region */
+	int ac_ops;		/* ac operators before region */
+	int nedits;		/* edit variables before region */
+	} REGION;
+
+/* storage class for per-thread variables */
+#ifndef CTX_LOCAL
+#define CTX_LOCAL __thread
+#endif
+
+typedef struct bert_ctx {
+	int verbose;		/* print debugging info */
+	NODE *subject;		/* subject expression */
+	STATS stats;		/* run statistics */
+	FILE *out;		/* where expressions are printed */
+	long step_limit;	/* max rewrites per program, 0 if none */
+	double time_limit;	/* max seconds of rewriting, 0 if none */
+	long node_limit;	/* max expression nodes added, 0 if none */
+	int strategy;		/* default reduction strategy, 0 for OUTERMOST */
+	int parts;		/* processes to solve the independent parts */
+				/* of a subject in, 0 if none (split.c) */
+	int agenda;		/* cheap conjuncts first (see walk in match.c) */
+
+	/* ctx.c */
+	jmp_buf *catch;		/* where error() returns to, if set */
+	int error_code;		/* result of failed entry point */
+	char error_msg[MAXERROR];	/* message of last error */
+	OP *main_op;		/* operator of initial subject */
+	int level;		/* load level of new rules */
+	REGION region;		/* program loaded on top of libraries */
+	int included;		/* number of files #included */
+	char *includes[MAXINCLUDES];	/* names of files #included */
+
+	/* match.c */
+	int learn;		/* did I learn anything? */
+	int bondage;		/* did a variable get bound? */
+	SNODE *stack;		/* stack for walking tree */
+	struct sub_stack *sub_top;	/* stack of subject expressions */
+	int reduction;		/* default strategy of this solve */
+	long quiet;		/* stamp of terms known not to match */
+	int moving;		/* instantiate moves parameters used once */
+	NODE *moved[MAXMOVED];	/* the parameters it moved */
+	int nmoved;
+
+	/* expr.c */
+	NODE *expr_mem;		/* next free expression tree node */
+	NODE *all_expr_mem;	/* all expression node memory */
+
+	/* names.c */
+	NAME_NODE *global_names;	/* root of global name space */
+
+	/* ops.c */
+	OP *single_op;		/* list of single-character operators */
+	OP *double_op;		/* list of double-character operators */
+	OP *name_op;		/* list of alphanumeric operators */
+	OP *type_op;		/* list of types */
+	char *op_mem;		/* operator memory */
+	int free_byte;		/* next free byte */
+
+	/* primitive.c */
+	OP *pnum_prim;		/* a particular positive numeric constant */
+	OP *nnum_prim;		/* a particular negative numeric constant */
+	OP *znum_prim;		/* the numeric constant zero */
+	OP *str_prim;		/* a particular string constant */
+	OP *undeclared_prim;	/* not declared yet ('?) */
+	OP *untyped_prim;	/* declared, but untyped */
+	OP *positive_type;	/* numeric constants greater than zero */
+	OP *nonzero_type;	/* numeric constants not equal to zero */
+	OP *constant_type;	/* any numeric constant */
+	OP *literal_type;	/* string constants */
+	OP *true_op;		/* boolean true operator */
+	OP *false_op;		/* boolean false operator */
+
+	/* parse.c */
+	SNODE *pstack;		/* (top of) parse stack */
+	NODE *boe;		/* beginning of expression */
+	int next_token;		/* next token (for lookahead) */
+	int token;		/* token identifier returned from scanner.c */
+	NAME_NODE *rule_names;	/* local names for this rule */
+
+	/* rules.c */
+	int label_count;	/* number of label names in a rule */
+	int rule_verbose;	/* verbose setting of previous rule */
+	RULE *top[MAXTOP];	/* most used rules, most first */
+	int ntop, maxtop;	/* rules in top, and most wanted */
+
+	/* scanner.c */
+	double token_val;	/* value of numeric token */
+	char token_prval[MAXTOKEN + 1];	/* print value of token */
+	OP *token_op;		/* operator node for operator token */
+	int lineno;		/* current line number */
+	int charno;		/* position in current line */
+	FILE *infile;		/* input file */
+	char *infilename;	/* input file name */
+	int filespushed;	/* depth of #includes */
+	FILE *infiles[MAXFILES];	/* #include file pointers */
+	char *infilenames[MAXFILES];	/* #include file names */
+	int inlinenos[MAXFILES];	/* line numbers */
+	int verboses[MAXFILES];	/* verbose flags */
+	int scan_class;		/* class of last character read */
+	int scan_c;		/* last character read */
+
+	/* prep.c */
+	int token_pos;		/* position in preprocessor statement */
+	long pragma_steps;	/* limits set by #limit, 0 if none */
+	double pragma_time;
+	long pragma_nodes;
+	int pragma_strategy;	/* set by #strategy, 0 if none */
+
+	/* ac.c */
+	int ac_ops;		/* ac or commutative operators defined */
+	int ac_hit[MAXHEAD];	/* arguments of the redex matched, */
+	int ac_nhit;		/* in the order of the rule head */
+	int ac_extra;		/* arguments of the redex not matched */
+	NODE **ac_temps;	/* nodes made while matching */
+	int ac_ntemps;
+	int ac_tempsize;
+
+	/* lx.c */
+	LX_TERM *lx_terms;	/* terms of the linear expressions */
+	int lx_nterms;
+	int lx_size;
+
+	/* edit.c */
+	EDIT *edits;		/* edit variables */
+	int nedits;
+	int edit_size;
+	int edits_changed;	/* values changed since the last answer? */
+	NODE *solved;		/* subject solved for the edit variables */
+	int solved_level;	/* region it was solved in */
+	KEPT *kept;		/* names that depend on them */
+	int nkept;
+	int kept_size;
+
+	/* interval.c */
+	INTERVAL *domains;	/* of the variables of the constraints */
+	int ndomains;
+	int domain_size;
+
+	/* fd.c */
+	FD_VAR *fd_vars;	/* intvars declared */
+	int nfd;
+	int fd_size;
+
+	/* cycle.c */
+	int cycle_window;	/* rewrites to look back for a cycle, 0 if off */
+	unsigned long subject_hash;	/* fingerprint of the subject */
+	unsigned long path_weight;	/* of the redex being rewritten */
+	unsigned long *hashes;	/* fingerprints after recent rewrites */
+	struct rule **hash_rules;	/* the rules that made them */
+	long hash_count;	/* rewrites fingerprinted */
+	int cycle_length;	/* rewrites in the cycle found, 0 if none */
+
+	/* util.c */
+	SNODE *st_mem;		/* free stack nodes */
+	SNODE *all_st_mem;	/* all stack memory */
+	char *all_strings;	/* all character string memory */
+	} BERT_CTX;
+
+extern CTX_LOCAL BERT_CTX *bert_ctx;	/* current context, from ctx.c */
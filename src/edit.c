@@ -0,0 +1,279 @@
+/***********************************************************************
+ *
+ * Edit variables.
+ *
+ * A program can name global variables whose values are to be
+ * changed once it has been solved, such as the width of
+ * examples/rectangle in a layout tool that redraws it as it is
+ * dragged:
+ *
+ *	#edit width 3
+ *	main { width: aNumber; ... widthof bottom = -width; ... }
+ *
+ * While the program is rewritten an edit variable is left free.
+ * linsolve never takes it as a pivot, so each variable that depends
+ * on it is bound to a linear expression in it.  When no more rules
+ * match, this solved form is kept: a copy of the subject, and the
+ * values of the global names that are free or depend on a free name
+ * (the only values that binding a variable can change).  Then the
+ * edit variables are bound to their values, and the subject is
+ * rewritten again to give the answer.
+ *
+ * An edit (ctx_edit, or another #edit of the name in a session)
+ * starts from the solved form: the kept names get their solved
+ * values back, the edit variables get their new values, and only
+ * the rewriting that was left after solving is done again.  Nothing
+ * is parsed, and equations that do not involve an edit variable are
+ * not solved again.  stats_print shows the time the last edit took.
+ *
+ * The program must not constrain an edit variable by itself, as in
+ * width = 3; that binds it while it should be free.  Equations that
+ * leave only edit variables are checked against their values.
+ *
+ ***********************************************************************/
+
+#include "def.h"
+
+/* from other modules */
+NODE *expr_copy();		/* from expr.c */
+NODE *expr_update();		/* from expr.c */
+void expr_free();		/* from expr.c */
+NAME_NODE *name_copy();		/* from names.c */
+void name_free();		/* from names.c */
+char *char_copy();		/* from util.c */
+NODE *lx_number();		/* from lx.c */
+
+/***********************************************************************
+ *
+ * Find an edit variable by name.
+ *
+ * returns:	its index in ctx->edits, -1 if there is none
+ *
+ ***********************************************************************/
+int
+edit_find(name)
+char *name;
+{
+register int i;
+
+for (i = 0; i < bert_ctx->nedits; i++)
+    if (0 == strcmp(bert_ctx->edits[i].name, name)) return i;
+return -1;
+}
+
+/***********************************************************************
+ *
+ * Declare an edit variable, or give one a new value (#edit).
+ *
+ ***********************************************************************/
+void
+edit_set(name, value)
+char *name;
+double value;
+{
+void *malloc();
+void *realloc();
+register BERT_CTX *ctx = bert_ctx;
+int i = edit_find(name);
+
+if (i < 0) {
+    if (ctx->nedits == ctx->edit_size) {
+	ctx->edit_size = ctx->edit_size ? 2 * ctx->edit_size : 8;
+	ctx->edits = (EDIT *) (ctx->edits ?
+	    realloc((char *) ctx->edits, ctx->edit_size * sizeof(EDIT)) :
+	    malloc(ctx->edit_size * sizeof(EDIT)));
+	if (!ctx->edits) error("out of memory for edit variables");
+	}
+    i = ctx->nedits++;
+    ctx->edits[i].name = char_copy(name);
+    ctx->edits[i].var = (NAME_NODE *) NULL;
+    }
+ctx->edits[i].value = value;
+ctx->edits_changed = TRUE;
+}
+
+/***********************************************************************
+ *
+ * Find the global name of each edit variable, once the program has
+ * made it, and mark it.  A dotted name is looked up a part at a time.
+ *
+ ***********************************************************************/
+static NAME_NODE *
+lookup(name)
+char *name;
+{
+register NAME_NODE *nn = bert_ctx->global_names;
+register char *p;
+int len;
+
+while (nn && *name) {
+    for (p = name; *p && *p != '.'; p++) ;
+    len = p - name;
+    for (nn = nn->child; nn; nn = nn->next)
+	if (0 == strncmp(nn->pval, name, len) && !nn->pval[len]) break;
+    name = *p ? p + 1 : p;
+    }
+return nn;
+}
+
+void
+edit_attach()
+{
+register BERT_CTX *ctx = bert_ctx;
+register int i;
+
+for (i = 0; i < ctx->nedits; i++)
+    if (!ctx->edits[i].var && (ctx->edits[i].var = lookup(ctx->edits[i].name)))
+	ctx->edits[i].var->edit = i + 1;
+}
+
+/***********************************************************************
+ *
+ * Keep the solved form.
+ *
+ ***********************************************************************/
+
+/* does an expression name a free variable? */
+static int
+depends(ex)
+register NODE *ex;
+{
+if (ex->op->arity & OP_NAME) return !((NAME_NODE *) ex)->value;
+if (!(ex->op->arity & OP_TERM)) return FALSE;
+return (((TERM_NODE *) ex)->left && depends(((TERM_NODE *) ex)->left)) ||
+    (((TERM_NODE *) ex)->right && depends(((TERM_NODE *) ex)->right));
+}
+
+static void
+keep(nn)
+register NAME_NODE *nn;		/* first of a list of names */
+{
+void *malloc();
+void *realloc();
+register BERT_CTX *ctx = bert_ctx;
+
+for (; nn; nn = nn->next) {
+    if (!nn->value || depends(nn->value)) {
+	if (ctx->nkept == ctx->kept_size) {
+	    ctx->kept_size = ctx->kept_size ? 2 * ctx->kept_size : 64;
+	    ctx->kept = (KEPT *) (ctx->kept ?
+		realloc((char *) ctx->kept, ctx->kept_size * sizeof(KEPT)) :
+		malloc(ctx->kept_size * sizeof(KEPT)));
+	    if (!ctx->kept) error("out of memory for edit variables");
+	    }
+	ctx->kept[ctx->nkept].name = name_copy(nn);
+	ctx->kept[ctx->nkept++].value =
+	    nn->value ? expr_copy(nn->value) : (NODE *) NULL;
+	}
+    keep(nn->child);
+    }
+}
+
+void
+edit_keep()
+{
+register BERT_CTX *ctx = bert_ctx;
+register int i;
+
+edit_attach();
+for (i = 0; i < ctx->nedits; i++) {
+    if (!ctx->edits[i].var) {
+	fprintf(stderr, "edit variable: %s\n", ctx->edits[i].name);
+	error("edit variable not declared by the program");
+	}
+    if (ctx->edits[i].var->value) {
+	fprintf(stderr, "edit variable: %s\n", ctx->edits[i].name);
+	error("edit variable bound by the program");
+	}
+    }
+ctx->solved = expr_copy(ctx->subject);
+ctx->solved_level = ctx->region.level;
+ctx->nkept = 0;
+keep(ctx->global_names->child);
+}
+
+/***********************************************************************
+ *
+ * Check that each edit is of an edit variable of the solved program.
+ * One declared since it was solved is not kept.
+ *
+ ***********************************************************************/
+void
+edit_check()
+{
+register BERT_CTX *ctx = bert_ctx;
+register int i;
+
+for (i = 0; i < ctx->nedits; i++)
+    if (!ctx->edits[i].var) {
+	fprintf(stderr, "edit variable: %s\n", ctx->edits[i].name);
+	ctx->nedits = i;	/* it and any declared after it */
+	error(lookup(ctx->edits[i].name) ?
+	    "edit variable not declared before the program was solved" :
+	    "edit variable not declared by the program");
+	}
+}
+
+/***********************************************************************
+ *
+ * Give the kept names their solved values back.
+ *
+ ***********************************************************************/
+static void
+restore()
+{
+register KEPT *k;
+
+for (k = bert_ctx->kept; k < bert_ctx->kept + bert_ctx->nkept; k++) {
+    if (k->name->value) expr_free(k->name->value);
+    k->name->value = k->value ? expr_copy(k->value) : (NODE *) NULL;
+    }
+}
+
+/***********************************************************************
+ *
+ * Start the answer: the solved subject, with the edit variables
+ * bound to their values.
+ *
+ ***********************************************************************/
+void
+edit_apply()
+{
+register BERT_CTX *ctx = bert_ctx;
+register EDIT *e;
+
+restore();
+for (e = ctx->edits; e < ctx->edits + ctx->nedits; e++) {
+    if (e->var->value) expr_free(e->var->value);
+    e->var->value = lx_number(e->value);
+    }
+if (ctx->subject) expr_free(ctx->subject);
+ctx->subject = expr_update(expr_copy(ctx->solved));
+ctx->edits_changed = FALSE;
+}
+
+/***********************************************************************
+ *
+ * Drop the solved form, leaving the edit variables free again.
+ * If its region has been released, its nodes are already gone.
+ *
+ ***********************************************************************/
+void
+edit_drop(released)
+int released;		/* region of the solved form released? */
+{
+register BERT_CTX *ctx = bert_ctx;
+register KEPT *k;
+
+if (!ctx->solved) return;
+if (!released) {
+    restore();
+    for (k = ctx->kept; k < ctx->kept + ctx->nkept; k++) {
+	if (k->value) expr_free(k->value);
+	name_free(k->name);
+	}
+    expr_free(ctx->solved);
+    }
+ctx->solved = (NODE *) NULL;
+ctx->nkept = 0;
+}
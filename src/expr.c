@@ -8,7 +8,6 @@
 #include <ctype.h>
 
 #define NODE_ALLOC 100		/* number of expr. tree nodes to allocate */
-NODE *expr_mem = NULL;		/* next free expression tree node */ 
 
 /***********************************************************************
  *
@@ -26,23 +25,126 @@ void *calloc();
 NODE *temp;
 register int i;
 
-if (!expr_mem) {
+if (!bert_ctx->expr_mem) {
+    register NODE *mem;
 #   ifdef DEBUG
     printf("allocating expression nodes\n");
     fflush(stdout);
 #   endif
-    expr_mem = (NODE *) calloc(NODE_ALLOC, sizeof (NODE));
-    if (!expr_mem) error("out of memory");
+    /* first node of each chunk links the chunks together */
+    mem = (NODE *) calloc(NODE_ALLOC + 1, sizeof (NODE));
+    if (!mem) error("out of memory");
+    mem->next = bert_ctx->all_expr_mem;
+    bert_ctx->all_expr_mem = mem++;
     for (i = 0; i < NODE_ALLOC - 1; i++)
-	expr_mem[i].next = &expr_mem[i+1];
-    expr_mem[NODE_ALLOC-1].next = NULL;
+	mem[i].next = &mem[i+1];
+    mem[NODE_ALLOC-1].next = NULL;
+    bert_ctx->expr_mem = mem;
+    bert_ctx->stats.node_bytes += (NODE_ALLOC + 1) * sizeof (NODE);
     }
 
-temp = expr_mem;
-expr_mem = expr_mem->next;
+temp = bert_ctx->expr_mem;
+bert_ctx->expr_mem = temp->next;
+((TERM_NODE *) temp)->quiet = 0;	/* in case it is a term */
+bert_ctx->stats.nodes_alloc++;
+if (++bert_ctx->stats.nodes_live > bert_ctx->stats.nodes_high)
+    bert_ctx->stats.nodes_high = bert_ctx->stats.nodes_live;
 return temp ;
 }
 
+/***********************************************************************
+ *
+ * Free all expression node memory.
+ *
+ ***********************************************************************/
+void
+expr_mem_free()
+{
+register NODE *t;
+void free();
+
+while (bert_ctx->all_expr_mem) {
+    t = bert_ctx->all_expr_mem->next;
+    free((char *) bert_ctx->all_expr_mem);
+    bert_ctx->all_expr_mem = t;
+    }
+bert_ctx->expr_mem = (NODE *) NULL;
+bert_ctx->stats.node_bytes = 0;
+bert_ctx->stats.nodes_live = 0;
+}
+
+/***********************************************************************
+ *
+ * Expression node memory for regions (see ctx.c).
+ *
+ * When a region is marked, the free list is put aside, so that every
+ * node handed out inside the region comes from chunks allocated
+ * after the mark.  Releasing the region frees those chunks and
+ * restores the old free list.  Old nodes that were freed inside the
+ * region are lost until the context is freed.
+ * Committing the region keeps its nodes, and puts the old free
+ * list back at the end of the current one.
+ *
+ ***********************************************************************/
+void
+expr_mark(r)
+REGION *r;
+{
+r->all_expr_mem = bert_ctx->all_expr_mem;
+r->expr_mem = bert_ctx->expr_mem;
+r->nodes_live = bert_ctx->stats.nodes_live;
+r->node_bytes = bert_ctx->stats.node_bytes;
+bert_ctx->expr_mem = (NODE *) NULL;
+}
+
+void
+expr_release(r)
+REGION *r;
+{
+register NODE *t;
+void free();
+
+while (bert_ctx->all_expr_mem != r->all_expr_mem) {
+    t = bert_ctx->all_expr_mem->next;
+    free((char *) bert_ctx->all_expr_mem);
+    bert_ctx->all_expr_mem = t;
+    }
+bert_ctx->expr_mem = r->expr_mem;
+bert_ctx->stats.nodes_live = r->nodes_live;
+bert_ctx->stats.node_bytes = r->node_bytes;
+}
+
+void
+expr_commit(r)
+REGION *r;
+{
+register NODE *t;
+
+if (!bert_ctx->expr_mem) bert_ctx->expr_mem = r->expr_mem;
+else if (r->expr_mem) {
+    for (t = bert_ctx->expr_mem; t->next; t = t->next) ;
+    t->next = r->expr_mem;
+    }
+}
+
+/***********************************************************************
+ *
+ * Was node p allocated inside region r?
+ *
+ ***********************************************************************/
+int
+node_in_region(p, r)
+NODE *p;
+REGION *r;
+{
+register NODE *chunk;
+
+for (chunk = bert_ctx->all_expr_mem; chunk != r->all_expr_mem;
+  chunk = chunk->next)
+    if (p > chunk && p <= chunk + NODE_ALLOC) return TRUE;
+return FALSE;
+}
+
 /***********************************************************************
  *
  * Storage reclamation
@@ -53,8 +155,10 @@ node_free(n)
 NODE *n;	/* expression node to be freed */
 {
 /* Put a node back on free list */
-n->next = expr_mem;
-expr_mem = n;
+n->next = bert_ctx->expr_mem;
+bert_ctx->expr_mem = n;
+bert_ctx->stats.nodes_freed++;
+bert_ctx->stats.nodes_live--;
 }
 
 void expr_free(fn)
@@ -86,6 +190,7 @@ else {
 /***********************************************************************
  *
  * Traverse and print the expression tree inorder.
+ * Printed on the output stream of the context (normally stderr).
  *
  * entry:	root of tree (or subtree)
  *
@@ -100,42 +205,42 @@ char *arity_name();	/* from ops.c */
 /* static unsigned char *hit_newline = 0;
 if (_iob[2]._ptr < hit_newline || 65 < _iob[2]._ptr - hit_newline) {
     hit_newline = _iob[2]._ptr;
-    fprintf(stderr,"\n   ");
+    fprintf(bert_ctx->out,"\n   ");
     } */
 /* if node is a string */
-if (p->op->arity == OP_STR) fprintf(stderr, "\"%s\"", ((STR_NODE *)p)->value);
+if (p->op->arity == OP_STR) fprintf(bert_ctx->out, "\"%s\"", ((STR_NODE *)p)->value);
 /* if node is a number */
-else if (p->op->arity == OP_NUM) fprintf(stderr, "%g", ((NUM_NODE *)p)->value);
+else if (p->op->arity == OP_NUM) fprintf(bert_ctx->out, "%g", ((NUM_NODE *)p)->value);
 /* if node is a name */
 else if (p->op->arity == OP_NAME) name_print((NAME_NODE *) p);
 /* if node is a nullary operator */
 else if (p->op->arity == NULLARY) {
     if (((TERM_NODE *)p)->label) {
 	name_print(((TERM_NODE *)p)->label);
-	fprintf(stderr, ":");
+	fprintf(bert_ctx->out, ":");
 	}
-    if (isalpha(p->op->pname[0])) fprintf(stderr, " %s ", p->op->pname);
-    else fprintf(stderr, "%s", p->op->pname);
+    if (isalpha(p->op->pname[0])) fprintf(bert_ctx->out, " %s ", p->op->pname);
+    else fprintf(bert_ctx->out, "%s", p->op->pname);
     }
 /* if node is a binary or unary operator */
 else if ((p->op->arity & BINARY) || (p->op->arity & UNARY)) {
     /* if node is labeled */
     if (((TERM_NODE *)p)->label) {
 	name_print(((TERM_NODE *)p)->label);
-	fprintf(stderr, ":");
+	fprintf(bert_ctx->out, ":");
 	}
-    if (p->op->arity != OUTFIX1) fprintf(stderr, "(");
+    if (p->op->arity != OUTFIX1) fprintf(bert_ctx->out, "(");
     /* print left argument */
     if ((p->op->arity & BINARY) || (p->op->arity == POSTFIX))
 	expr_print(((TERM_NODE *)p)->left);
     /* print operator.  If alphabetic, put spaces around it */
-    if (isalpha(p->op->pname[0])) fprintf(stderr, " %s ", p->op->pname);
-    else fprintf(stderr, "%s", p->op->pname);
+    if (isalpha(p->op->pname[0])) fprintf(bert_ctx->out, " %s ", p->op->pname);
+    else fprintf(bert_ctx->out, "%s", p->op->pname);
     /* print right argument */
     if (p->op->arity != POSTFIX) expr_print(((TERM_NODE *)p)->right);
     /* print matching outfix operator */
-    if (p->op->arity == OUTFIX1) fprintf(stderr, "%s", p->op->other->pname);
-    else fprintf(stderr, ")");
+    if (p->op->arity == OUTFIX1) fprintf(bert_ctx->out, "%s", p->op->other->pname);
+    else fprintf(bert_ctx->out, ")");
     }
 else {
     fprintf(stderr, "arity: %s\n", arity_name(p->op->arity));
@@ -203,12 +308,20 @@ error("invalid operator arity in expr_copy");
 /***********************************************************************
  *
  * Walk expression tree replacing bound variables by their values.
+ * A term that walk() found quiet (see match.c) is woken if a
+ * variable in it is replaced, since rules may match it now.
  *
  * entry:	root of tree.
  *
  * exit:	root of updated tree.
  *
  ***********************************************************************/
+/* was a child of a quiet term replaced, or woken itself?  walk() */
+/* does not go inside [ ] (eval -4), so what is in it has no stamp */
+#define WOKEN(tn, ex, old)	((tn)->quiet && ((ex) != (old) || \
+	((tn)->op->eval != -4 && (ex)->op->arity & OP_TERM && \
+	((TERM_NODE *) (ex))->quiet != (tn)->quiet)))
+
 NODE *
 expr_update(tree)
 NODE *tree;
@@ -230,10 +343,16 @@ if (tree->op->arity & OP_NAME) {	/* a NAME_NODE */
     else return tree;
     }
 if (tree->op->arity & OP_TERM) {	/* a TERM_NODE */
-    if (((TERM_NODE *)tree)->left)
-	((TERM_NODE *)tree)->left = expr_update(((TERM_NODE *)tree)->left);
-    if (((TERM_NODE *)tree)->right)
-	((TERM_NODE *)tree)->right = expr_update(((TERM_NODE *)tree)->right);
+    register TERM_NODE *tn = (TERM_NODE *) tree;
+    NODE *old;
+    if ((old = tn->left)) {
+	tn->left = expr_update(old);
+	if (WOKEN(tn, tn->left, old)) tn->quiet = 0;
+	}
+    if ((old = tn->right)) {
+	tn->right = expr_update(old);
+	if (WOKEN(tn, tn->right, old)) tn->quiet = 0;
+	}
     }
 return tree;	/* anything else */
 }
@@ -0,0 +1,939 @@
+/***********************************************************************
+ *
+ * Finite domains: integer variables, propagation and search.
+ *
+ * The library fd declares integer variables with small domains,
+ *
+ *	x: aInt(1, 9)
+ *
+ * which the rule for aInt types 'intvar, and records here with its
+ * bounds (fd_declare, the primitive of that rule).  An intvar is an
+ * sterm, but not a numvar, so linsolve, simplex, newton and interval
+ * leave it alone, and the relations of bops over intvars stay in the
+ * subject.  Once no rule matches the subject any more (and the other
+ * solvers have nothing to do), the constraints of its top level ;
+ * chain whose sides are built of numbers, intvars, + - * and - a,
+ *
+ *	a = b	~(a = b)	a <= b		a < b
+ *
+ * (a ~= b, a >= b and a > b are turned into these by bops) are
+ * solved together:
+ *
+ *	- each intvar gets its domain, a bitset of the values from
+ *	  its lowest to its highest;
+ *	- the constraints are revised, AC-3 style, from a queue until
+ *	  no domain gets smaller: one with two variables, x - y + k
+ *	  rel 0, by shifting and masking the words of the bitsets, a
+ *	  word at a time; another linear one by the bounds of its
+ *	  terms; and any other by trying its values once all but one
+ *	  or two of its variables are fixed;
+ *	- then search labels the variable with the smallest domain
+ *	  with each of its values in turn, from the lowest, and
+ *	  revises again.  The domains a choice cuts down are saved on
+ *	  the trail first, and put back when it fails.
+ *
+ * If there is a solution, the variables are bound to it, and the
+ * constraints are replaced by true; if there is none, false is put
+ * at the front of the chain.  A search that runs into FAILURES dead
+ * ends gives up, and leaves the constraints as they were.  An intvar
+ * that is in none of the constraints is left free, and so is one of
+ * a constraint with anything else in it, which the rules go on with
+ * once its other variables are bound.
+ *
+ * While a program with edit variables is first being solved (see
+ * edit.c), nothing is done here, as for simplex.c.
+ *
+ ***********************************************************************/
+
+#include "def.h"
+#include <math.h>
+
+#define MAXVALUES	65536	/* values a domain can have */
+#define FAILURES	100000	/* dead ends before the search gives up */
+#define EPSILON		1e-9	/* a sum this close to zero is zero */
+
+#define BITS	((int) (8 * sizeof(unsigned long)))	/* in a word of a domain */
+#define WORDS(n)	(((n) + BITS - 1) / BITS)
+
+/* from other modules */
+OP *op_find();			/* from ops.c */
+void lp_satisfied();		/* from simplex.c */
+void lp_bind();			/* from simplex.c */
+void lp_false();		/* from simplex.c */
+double stats_clock();		/* from stats.c */
+void free();
+
+/* relations, of a constraint t[0] + ... + t[n-1] + k rel 0 */
+#define R_EQ	0
+#define R_NE	1
+#define R_LE	2
+#define R_LT	3
+
+/* the domain of a variable, while solving */
+typedef struct dom {
+	NAME_NODE *var;
+	int lo;			/* the value of bit 0 */
+	int nbits;
+	unsigned long *w;	/* its words, in st->words */
+	int value;		/* while trying a constraint */
+	int saved;		/* level it was last saved at */
+	} DOM;
+
+/* a term of a linear constraint */
+typedef struct fdterm {
+	int d;			/* domain */
+	double c;		/* coefficient */
+	} FD_TERM;
+
+typedef struct con {
+	NODE **at;		/* the conjunct it was made from */
+	int rel;
+	NODE *left, *right;	/* its sides, if it is not linear */
+	FD_TERM *t;		/* else its terms, by domain */
+	int n;
+	double k;
+	int *d;			/* its domains */
+	int nd;
+	int queued;		/* waiting to be revised? */
+	} CON;
+
+/* a domain saved on the trail */
+typedef struct trail {
+	int d;
+	int saved;		/* its saved level before */
+	int at;			/* where its words are, in st->kept */
+	} TRAIL;
+
+/* everything the search works on */
+typedef struct store {
+	DOM *doms;
+	int ndoms;
+	int *map;		/* domain of each of ctx->fd_vars, -1 if none */
+	unsigned long *words;	/* of all the domains */
+	CON *cons;
+	int ncons;
+	int *uses, *used;	/* constraints of domain i: used[uses[i] .. uses[i+1]) */
+	int *queue;		/* constraints to revise, a ring */
+	int head, count;
+	TRAIL *trail;		/* domains cut down since each choice */
+	int ntrail, trail_size;
+	unsigned long *kept;	/* their words */
+	int nkept, kept_size;
+	int level;		/* choices made */
+	long failures;
+	} STORE;
+
+/* the operators of bops it knows */
+typedef struct ops {
+	OP *semi, *equal, *le, *lt, *not, *intvar;
+	OP *add, *sub, *mul, *neg;
+	} OPS;
+
+#define space(n)	mem_get((size_t) (n), "finite domains")
+#define more(p, n)	mem_grow((void *) (p), (size_t) (n), "finite domains")
+
+/***********************************************************************
+ *
+ * The primitive of aInt (lo, hi): record the domain of the intvar it
+ * labels.  ex is aInt (lo , hi).
+ *
+ ***********************************************************************/
+NODE *
+fd_declare(ex)
+TERM_NODE *ex;
+{
+NODE *node_new();		/* from expr.c */
+void fd_add();			/* below */
+register BERT_CTX *ctx = bert_ctx;
+register NAME_NODE *nn = ex->label;
+register TERM_NODE *answer = (TERM_NODE *) node_new();
+TERM_NODE *range = (TERM_NODE *) ex->right;
+double lo = ceil(((NUM_NODE *) range->left)->value);
+double hi = floor(((NUM_NODE *) range->right)->value);
+
+answer->op = ctx->true_op;
+answer->label = (NAME_NODE *) NULL;
+answer->left = answer->right = (NODE *) NULL;
+if (!nn) return (NODE *) answer;	/* nothing to give it to */
+if (hi < lo || hi - lo >= MAXVALUES) {
+    fprintf(stderr, "domain: %g to %g\n", lo, hi);
+    error("finite domain empty or too large");
+    }
+fd_add(nn, (int) lo, (int) hi);
+return (NODE *) answer;
+}
+
+/* record the intvar nn, with its bounds (also used by split.c) */
+void
+fd_add(nn, lo, hi)
+NAME_NODE *nn;
+int lo, hi;
+{
+register BERT_CTX *ctx = bert_ctx;
+
+if (ctx->nfd == ctx->fd_size) {
+    ctx->fd_size = ctx->fd_size ? 2 * ctx->fd_size : 32;
+    ctx->fd_vars = (FD_VAR *) (ctx->fd_vars ?
+	more((char *) ctx->fd_vars, ctx->fd_size * sizeof(FD_VAR)) :
+	space(ctx->fd_size * sizeof(FD_VAR)));
+    }
+ctx->fd_vars[ctx->nfd].var = nn;
+ctx->fd_vars[ctx->nfd].lo = lo;
+ctx->fd_vars[ctx->nfd].hi = hi;
+nn->domain = ++ctx->nfd;
+}
+
+/***********************************************************************
+ *
+ * Bitsets.  Bit i of a domain is its value lo + i.
+ *
+ ***********************************************************************/
+static int
+count(d)
+register DOM *d;
+{
+register unsigned long x;
+register int i, n = 0;
+
+for (i = 0; i < WORDS(d->nbits); i++)
+    for (x = d->w[i]; x; x &= x - 1) n++;
+return n;
+}
+
+/* the lowest value, or the highest; the domain is not empty */
+static int
+least(d)
+register DOM *d;
+{
+register int i, b;
+
+for (i = 0; !d->w[i]; i++) ;
+for (b = 0; !(d->w[i] >> b & 1); b++) ;
+return d->lo + i * BITS + b;
+}
+
+static int
+most(d)
+register DOM *d;
+{
+register int i, b;
+
+for (i = WORDS(d->nbits) - 1; !d->w[i]; i--) ;
+for (b = BITS - 1; !(d->w[i] >> b & 1); b--) ;
+return d->lo + i * BITS + b;
+}
+
+static int
+empty(d)
+register DOM *d;
+{
+register int i;
+
+for (i = 0; i < WORDS(d->nbits); i++)
+    if (d->w[i]) return FALSE;
+return TRUE;
+}
+
+/* bits from p on of w (nbits long), zero outside it */
+static unsigned long
+get(w, nbits, p)
+unsigned long *w;
+int nbits, p;
+{
+int i, s;
+unsigned long x = 0;
+
+if (p <= -(int) BITS || p >= nbits) return 0;
+if (p < 0) return get(w, nbits, 0) << -p;
+i = p / BITS;
+s = p % BITS;
+x = w[i] >> s;
+if (s && i + 1 < WORDS(nbits)) x |= w[i + 1] << (BITS - s);
+return x;
+}
+
+/***********************************************************************
+ *
+ * Cut a domain down.  It is saved on the trail first, and the
+ * constraints on it are queued.
+ *
+ * returns:	FALSE if it is empty
+ *
+ ***********************************************************************/
+static void
+save(st, d)
+register STORE *st;
+int d;
+{
+register DOM *dp = &st->doms[d];
+register TRAIL *t;
+int n = WORDS(dp->nbits);
+
+if (dp->saved == st->level) return;
+if (st->ntrail == st->trail_size) {
+    st->trail_size = st->trail_size ? 2 * st->trail_size : 64;
+    st->trail = (TRAIL *) more((char *) st->trail,
+	st->trail_size * sizeof(TRAIL));
+    }
+while (st->nkept + n > st->kept_size) {
+    st->kept_size = st->kept_size ? 2 * st->kept_size : 256;
+    st->kept = (unsigned long *) more((char *) st->kept,
+	st->kept_size * sizeof(unsigned long));
+    }
+t = &st->trail[st->ntrail++];
+t->d = d;
+t->saved = dp->saved;
+t->at = st->nkept;
+memcpy((char *) &st->kept[st->nkept], (char *) dp->w, n * sizeof(unsigned long));
+st->nkept += n;
+dp->saved = st->level;
+}
+
+/* put the domains back as they were at trail height h */
+static void
+restore(st, h)
+register STORE *st;
+int h;
+{
+register TRAIL *t;
+register DOM *dp;
+
+while (st->ntrail > h) {
+    t = &st->trail[--st->ntrail];
+    dp = &st->doms[t->d];
+    memcpy((char *) dp->w, (char *) &st->kept[t->at],
+	WORDS(dp->nbits) * sizeof(unsigned long));
+    dp->saved = t->saved;
+    st->nkept = t->at;
+    }
+}
+
+static void
+wake(st, d, c)
+register STORE *st;
+int d;
+CON *c;			/* the constraint that cut it down */
+{
+register int j;
+register CON *u;
+
+for (j = st->uses[d]; j < st->uses[d + 1]; j++) {
+    u = &st->cons[st->used[j]];
+    if (u != c && !u->queued) {
+	u->queued = TRUE;
+	st->queue[(st->head + st->count++) % st->ncons] = st->used[j];
+	}
+    }
+}
+
+/* and the domain with mask m (a word for each of its words) */
+static int
+cut(st, d, m, c)
+register STORE *st;
+int d;
+unsigned long *m;
+CON *c;
+{
+register DOM *dp = &st->doms[d];
+register int i;
+int n = WORDS(dp->nbits), changed = FALSE;
+
+for (i = 0; i < n && !changed; i++)
+    if (dp->w[i] & ~m[i]) changed = TRUE;
+if (!changed) return TRUE;
+save(st, d);
+for (i = 0; i < n; i++) dp->w[i] &= m[i];	/* a word at a time */
+wake(st, d, c);
+return !empty(dp);
+}
+
+/* keep the values from lo to hi */
+static int
+bound(st, d, lo, hi, c)
+register STORE *st;
+int d;
+double lo, hi;
+CON *c;
+{
+register DOM *dp = &st->doms[d];
+register int i;
+int n = WORDS(dp->nbits), l, h;
+unsigned long m[MAXVALUES / BITS + 1];
+
+if (lo <= least(dp) && hi >= most(dp)) return TRUE;
+l = (lo <= dp->lo) ? 0 : (lo > dp->lo + dp->nbits) ? dp->nbits :
+    (int) ceil(lo - EPSILON) - dp->lo;
+h = (hi >= dp->lo + dp->nbits) ? dp->nbits - 1 : (hi < dp->lo) ? -1 :
+    (int) floor(hi + EPSILON) - dp->lo;
+for (i = 0; i < n; i++) m[i] = 0;
+for (i = l; i <= h && i < dp->nbits; i++) {
+    if (i % BITS == 0 && i + (int) BITS - 1 <= h) {	/* a whole word */
+	m[i / BITS] = ~0UL;
+	i += BITS - 1;
+	}
+    else m[i / BITS] |= 1UL << (i % BITS);
+    }
+return cut(st, d, m, c);
+}
+
+/* take a value out */
+static int
+drop(st, d, v, c)
+register STORE *st;
+int d, v;
+CON *c;
+{
+register DOM *dp = &st->doms[d];
+int i = v - dp->lo;
+
+if (i < 0 || i >= dp->nbits || !(dp->w[i / BITS] >> (i % BITS) & 1))
+    return TRUE;
+save(st, d);
+dp->w[i / BITS] &= ~(1UL << (i % BITS));
+wake(st, d, c);
+return !empty(dp);
+}
+
+/***********************************************************************
+ *
+ * Compile a constraint.
+ *
+ ***********************************************************************/
+
+/* the domain of an intvar, made if it is new; -1 if it has none */
+static int
+domain(st, nn)
+register STORE *st;
+register NAME_NODE *nn;
+{
+register BERT_CTX *ctx = bert_ctx;
+register DOM *dp;
+register int i = nn->domain - 1;
+
+if (i < 0 || i >= ctx->nfd || ctx->fd_vars[i].var != nn) return -1;
+if (st->map[i] >= 0) return st->map[i];
+if (0 == st->ndoms % 16)
+    st->doms = (DOM *) more((char *) st->doms, (st->ndoms + 16) * sizeof(DOM));
+dp = &st->doms[st->ndoms];
+dp->var = nn;
+dp->lo = ctx->fd_vars[i].lo;
+dp->nbits = ctx->fd_vars[i].hi - dp->lo + 1;
+dp->w = (unsigned long *) NULL;		/* once they are all known */
+dp->saved = -1;
+return st->map[i] = st->ndoms++;
+}
+
+/* the intvars of an expression, FALSE if it has anything else */
+static int
+known(st, ex, ops, c)
+register STORE *st;
+register NODE *ex;
+register OPS *ops;
+register CON *c;
+{
+register OP *op = ex->op;
+int d, i;
+
+if (op->arity & OP_NUM) return TRUE;
+if (op->arity & OP_NAME) {
+    if (op != ops->intvar || ((NAME_NODE *) ex)->value) return FALSE;
+    if (0 > (d = domain(st, (NAME_NODE *) ex))) return FALSE;
+    for (i = 0; i < c->nd; i++)
+	if (c->d[i] == d) return TRUE;
+    if (0 == c->nd % 8)
+	c->d = (int *) more((char *) c->d, (c->nd + 8) * sizeof(int));
+    c->d[c->nd++] = d;
+    return TRUE;
+    }
+if (op == ops->add || op == ops->sub || op == ops->mul)
+    return known(st, ((TERM_NODE *) ex)->left, ops, c) &&
+	known(st, ((TERM_NODE *) ex)->right, ops, c);
+if (op == ops->neg) return known(st, ((TERM_NODE *) ex)->right, ops, c);
+return FALSE;
+}
+
+/* add f times an expression to the terms of c; FALSE if not linear */
+static int
+linear(st, ex, f, ops, c)
+STORE *st;
+register NODE *ex;
+double f;
+register OPS *ops;
+register CON *c;
+{
+register TERM_NODE *tn = (TERM_NODE *) ex;
+register int i;
+int d;
+
+if (ex->op->arity & OP_NUM) {
+    c->k += f * ((NUM_NODE *) ex)->value;
+    return TRUE;
+    }
+if (ex->op->arity & OP_NAME) {
+    d = domain(st, (NAME_NODE *) ex);
+    for (i = 0; i < c->n; i++)
+	if (c->t[i].d == d) break;
+    if (i == c->n) {
+	c->t[c->n].d = d;
+	c->t[c->n++].c = 0.0;
+	}
+    c->t[i].c += f;
+    return TRUE;
+    }
+if (ex->op == ops->add)
+    return linear(st, tn->left, f, ops, c) && linear(st, tn->right, f, ops, c);
+if (ex->op == ops->sub)
+    return linear(st, tn->left, f, ops, c) && linear(st, tn->right, -f, ops, c);
+if (ex->op == ops->neg) return linear(st, tn->right, -f, ops, c);
+if (ex->op == ops->mul) {
+    if (tn->left->op->arity & OP_NUM)
+	return linear(st, tn->right, f * ((NUM_NODE *) tn->left)->value, ops, c);
+    if (tn->right->op->arity & OP_NUM)
+	return linear(st, tn->left, f * ((NUM_NODE *) tn->right)->value, ops, c);
+    }
+return FALSE;
+}
+
+/* the value of an expression, with the values of its domains */
+static double
+eval(st, ex, ops)
+register STORE *st;
+register NODE *ex;
+register OPS *ops;
+{
+register TERM_NODE *tn = (TERM_NODE *) ex;
+
+if (ex->op->arity & OP_NUM) return ((NUM_NODE *) ex)->value;
+if (ex->op->arity & OP_NAME)
+    return (double) st->doms[domain(st, (NAME_NODE *) ex)].value;
+if (ex->op == ops->add)
+    return eval(st, tn->left, ops) + eval(st, tn->right, ops);
+if (ex->op == ops->sub)
+    return eval(st, tn->left, ops) - eval(st, tn->right, ops);
+if (ex->op == ops->mul)
+    return eval(st, tn->left, ops) * eval(st, tn->right, ops);
+return -eval(st, tn->right, ops);	/* known() let nothing else by */
+}
+
+/* does rel hold of x? */
+static int
+holds(rel, x)
+int rel;
+double x;
+{
+switch (rel) {
+ case R_EQ:	return fabs(x) <= EPSILON;
+ case R_NE:	return fabs(x) > EPSILON;
+ case R_LE:	return x <= EPSILON;
+ default:	return x < -EPSILON;
+ }
+}
+
+/* does c hold with the values of its domains? */
+static int
+check(st, c, ops)
+register STORE *st;
+register CON *c;
+OPS *ops;
+{
+register int i;
+double x;
+
+if (c->left)
+    return holds(c->rel, eval(st, c->left, ops) - eval(st, c->right, ops));
+for (x = c->k, i = 0; i < c->n; i++)
+    x += c->t[i].c * st->doms[c->t[i].d].value;
+return holds(c->rel, x);
+}
+
+/***********************************************************************
+ *
+ * Revise a constraint.
+ *
+ * returns:	FALSE if a domain is empty
+ *
+ ***********************************************************************/
+
+/* x - y + k rel 0, by the words of the bitsets */
+static int
+pair(st, c)
+register STORE *st;
+register CON *c;
+{
+int x = (c->t[0].c > 0.0) ? c->t[0].d : c->t[1].d;
+int y = (c->t[0].c > 0.0) ? c->t[1].d : c->t[0].d;
+register DOM *dx = &st->doms[x], *dy = &st->doms[y];
+register int i;
+int k = (int) c->k;	/* x = y - k for R_EQ */
+unsigned long m[MAXVALUES / BITS + 1];
+
+switch (c->rel) {
+ case R_EQ:	/* bit i of x is value dx->lo + i, y value dx->lo + i + k */
+    for (i = 0; i < WORDS(dx->nbits); i++)
+	m[i] = get(dy->w, dy->nbits, dx->lo + k - dy->lo + i * BITS);
+    if (!cut(st, x, m, c)) return FALSE;
+    for (i = 0; i < WORDS(dy->nbits); i++)
+	m[i] = get(dx->w, dx->nbits, dy->lo - k - dx->lo + i * BITS);
+    return cut(st, y, m, c);
+ case R_NE:
+    if (least(dy) == most(dy) && !drop(st, x, least(dy) - k, c)) return FALSE;
+    if (least(dx) == most(dx) && !drop(st, y, least(dx) + k, c)) return FALSE;
+    return TRUE;
+ case R_LE:	/* x <= y - k */
+    if (!bound(st, x, -HUGE_VAL, (double) (most(dy) - k), c)) return FALSE;
+    return bound(st, y, (double) (least(dx) + k), HUGE_VAL, c);
+ default:	/* x < y - k */
+    if (!bound(st, x, -HUGE_VAL, (double) (most(dy) - k - 1), c)) return FALSE;
+    return bound(st, y, (double) (least(dx) + k + 1), HUGE_VAL, c);
+ }
+}
+
+/* a linear constraint, by the bounds of its terms */
+static int
+sums(st, c)
+register STORE *st;
+register CON *c;
+{
+register int i, j;
+double lo, hi, tlo, thi, rlo, rhi, a;
+DOM *dp;
+
+for (i = 0; i < c->n; i++) {
+    /* the bounds of k plus the other terms */
+    for (rlo = rhi = c->k, j = 0; j < c->n; j++) {
+	if (j == i) continue;
+	dp = &st->doms[c->t[j].d];
+	tlo = c->t[j].c * least(dp);
+	thi = c->t[j].c * most(dp);
+	rlo += (tlo < thi) ? tlo : thi;
+	rhi += (tlo < thi) ? thi : tlo;
+	}
+    /* a x + r rel 0 */
+    a = c->t[i].c;
+    dp = &st->doms[c->t[i].d];
+    switch (c->rel) {
+     case R_EQ:
+	lo = ((a > 0.0) ? -rhi : -rlo) / a;
+	hi = ((a > 0.0) ? -rlo : -rhi) / a;
+	break;
+     case R_NE:
+	if (rlo != rhi) continue;
+	lo = -rlo / a;
+	if (lo == floor(lo) && !drop(st, c->t[i].d, (int) lo, c)) return FALSE;
+	continue;
+     default:		/* a x <= -rlo, less a little if strict */
+	lo = -HUGE_VAL;
+	hi = HUGE_VAL;
+	if (a > 0.0) hi = -rlo / a;
+	else lo = -rlo / a;
+	if (c->rel == R_LT) {
+	    if (a > 0.0 && hi == floor(hi)) hi -= 1.0;
+	    if (a < 0.0 && lo == floor(lo)) lo += 1.0;
+	    }
+	break;
+     }
+    if (!bound(st, c->t[i].d, lo, hi, c)) return FALSE;
+    }
+return TRUE;
+}
+
+/* any constraint, by trying values once at most two domains are open */
+static int
+tries(st, c, ops)
+register STORE *st;
+register CON *c;
+OPS *ops;
+{
+DOM *dp, *dq;
+int open[2], nopen = 0, i, x, v, w, ok;
+unsigned long m[MAXVALUES / BITS + 1];
+
+for (i = 0; i < c->nd; i++) {
+    dp = &st->doms[c->d[i]];
+    if (least(dp) != most(dp)) {
+	if (nopen == 2) return TRUE;	/* later */
+	open[nopen++] = c->d[i];
+	}
+    else dp->value = least(dp);
+    }
+if (!nopen) return check(st, c, ops);
+for (x = 0; x < nopen; x++) {
+    dp = &st->doms[open[x]];
+    dq = (nopen == 2) ? &st->doms[open[1 - x]] : (DOM *) NULL;
+    for (i = 0; i < WORDS(dp->nbits); i++) m[i] = 0;
+    for (v = 0; v < dp->nbits; v++) {
+	if (!(dp->w[v / BITS] >> (v % BITS) & 1)) continue;
+	dp->value = dp->lo + v;
+	ok = FALSE;
+	if (!dq) ok = check(st, c, ops);
+	else for (w = 0; w < dq->nbits && !ok; w++) {
+	    if (!(dq->w[w / BITS] >> (w % BITS) & 1)) continue;
+	    dq->value = dq->lo + w;
+	    ok = check(st, c, ops);
+	    }
+	if (ok) m[v / BITS] |= 1UL << (v % BITS);
+	}
+    if (!cut(st, open[x], m, c)) return FALSE;
+    }
+return TRUE;
+}
+
+static int
+revise(st, c, ops)
+register STORE *st;
+register CON *c;
+OPS *ops;
+{
+if (c->left) return tries(st, c, ops);
+if (c->n == 2 && c->t[0].c == -c->t[1].c && fabs(c->t[0].c) == 1.0 &&
+  c->k == floor(c->k))
+    return pair(st, c);
+return sums(st, c);
+}
+
+/* revise until the queue is empty */
+static int
+propagate(st, ops)
+register STORE *st;
+OPS *ops;
+{
+register CON *c;
+
+while (st->count) {
+    c = &st->cons[st->queue[st->head]];
+    st->head = (st->head + 1) % st->ncons;
+    st->count--;
+    c->queued = FALSE;
+    if (!revise(st, c, ops)) {
+	while (st->count) {	/* empty it for the next choice */
+	    st->cons[st->queue[st->head]].queued = FALSE;
+	    st->head = (st->head + 1) % st->ncons;
+	    st->count--;
+	    }
+	return FALSE;
+	}
+    }
+return TRUE;
+}
+
+/***********************************************************************
+ *
+ * Search, first fail.
+ *
+ * returns:	TRUE if every domain has one value, that satisfies
+ *		every constraint; FALSE if there is none, or if the
+ *		search gave up (st->failures is then over FAILURES)
+ *
+ ***********************************************************************/
+static int
+search(st, ops)
+register STORE *st;
+OPS *ops;
+{
+register DOM *dp;
+register int i;
+int best = -1, size = 0, n, h, v;
+
+if (!propagate(st, ops)) return FALSE;
+for (i = 0; i < st->ndoms; i++) {
+    n = count(&st->doms[i]);
+    if (n > 1 && (best < 0 || n < size)) {
+	best = i;
+	size = n;
+	}
+    }
+if (best < 0) {		/* all fixed */
+    for (i = 0; i < st->ndoms; i++)
+	st->doms[i].value = least(&st->doms[i]);
+    for (i = 0; i < st->ncons; i++)
+	if (!check(st, &st->cons[i], ops)) return FALSE;
+    return TRUE;
+    }
+
+dp = &st->doms[best];
+for (v = 0; v < dp->nbits; v++) {
+    if (!(dp->w[v / BITS] >> (v % BITS) & 1)) continue;
+    h = st->ntrail;
+    st->level++;
+    save(st, best);
+    for (i = 0; i < WORDS(dp->nbits); i++) dp->w[i] = 0;
+    dp->w[v / BITS] = 1UL << (v % BITS);
+    wake(st, best, (CON *) NULL);
+    if (search(st, ops)) return TRUE;
+    restore(st, h);
+    st->level--;
+    if (++st->failures > FAILURES) return FALSE;
+    }
+return FALSE;
+}
+
+/***********************************************************************
+ *
+ * Solve the finite domain constraints of the subject.
+ *
+ * returns:	TRUE if the subject was changed
+ *
+ ***********************************************************************/
+int
+fd()
+{
+register BERT_CTX *ctx = bert_ctx;
+register CON *c;
+register int i, j;
+OPS ops;
+STORE st;
+NODE **at, *x, *eq;
+NODE **vars;
+double *val, start;
+int size = 16, rel, nw, solved, changed = FALSE;
+
+if (!ctx->subject || !ctx->nfd || (ctx->nedits && !ctx->solved))
+    return FALSE;
+ops.semi = op_find(ctx->single_op, ";", BINARY);
+ops.equal = op_find(ctx->single_op, "=", BINARY);
+ops.le = op_find(ctx->double_op, "<=", BINARY);
+ops.lt = op_find(ctx->single_op, "<", BINARY);
+ops.not = op_find(ctx->single_op, "~", PREFIX);
+ops.intvar = op_find(ctx->type_op, "intvar", 0);
+ops.add = op_find(ctx->single_op, "+", BINARY);
+ops.sub = op_find(ctx->single_op, "-", BINARY);
+ops.mul = op_find(ctx->single_op, "*", BINARY);
+ops.neg = op_find(ctx->single_op, "-", PREFIX);
+if (!ops.semi || !ops.equal || !ops.intvar) return FALSE;
+
+/* the constraints of the chain */
+start = stats_clock();
+st.doms = (DOM *) NULL;
+st.ndoms = st.ncons = 0;
+st.map = (int *) space(ctx->nfd * sizeof(int));
+for (i = 0; i < ctx->nfd; i++) st.map[i] = -1;
+st.cons = (CON *) space(size * sizeof(CON));
+for (at = &ctx->subject; ; at = &((TERM_NODE *) *at)->right) {
+    NODE **conj = ((*at)->op == ops.semi) ? &((TERM_NODE *) *at)->left : at;
+    x = *conj;
+    if (x->op == ctx->false_op) break;
+    eq = x;
+    rel = -1;
+    if (x->op == ops.equal) rel = R_EQ;
+    else if (x->op == ops.le) rel = R_LE;
+    else if (x->op == ops.lt) rel = R_LT;
+    else if (x->op == ops.not && ((TERM_NODE *) x)->right->op == ops.equal) {
+	rel = R_NE;
+	eq = ((TERM_NODE *) x)->right;
+	}
+    if (rel >= 0) {
+	if (st.ncons == size)
+	    st.cons = (CON *) more((char *) st.cons, (size *= 2) * sizeof(CON));
+	c = &st.cons[st.ncons];
+	c->at = conj;
+	c->rel = rel;
+	c->d = (int *) NULL;
+	c->nd = 0;
+	c->t = (FD_TERM *) NULL;
+	c->left = c->right = (NODE *) NULL;
+	if (known(&st, ((TERM_NODE *) eq)->left, &ops, c) &&
+	  known(&st, ((TERM_NODE *) eq)->right, &ops, c) && c->nd) {
+	    c->t = (FD_TERM *) space(c->nd * sizeof(FD_TERM));
+	    c->n = 0;
+	    c->k = 0.0;
+	    if (linear(&st, ((TERM_NODE *) eq)->left, 1.0, &ops, c) &&
+	      linear(&st, ((TERM_NODE *) eq)->right, -1.0, &ops, c)) {
+		for (i = j = 0; i < c->n; i++)	/* that cancelled out */
+		    if (c->t[i].c != 0.0) c->t[j++] = c->t[i];
+		c->n = j;
+		}
+	    else {
+		c->left = ((TERM_NODE *) eq)->left;
+		c->right = ((TERM_NODE *) eq)->right;
+		}
+	    st.ncons++;
+	    }
+	else if (c->d) free((char *) c->d);
+	}
+    if ((*at)->op != ops.semi) break;
+    }
+if (x->op == ctx->false_op || !st.ncons) {
+    for (c = st.cons; c < st.cons + st.ncons; c++) {
+	free((char *) c->d);
+	free((char *) c->t);
+	}
+    free((char *) st.cons);
+    free((char *) st.map);
+    if (st.doms) free((char *) st.doms);
+    return FALSE;
+    }
+ctx->stats.fd++;
+
+/* the domains, full */
+for (nw = i = 0; i < st.ndoms; i++) nw += WORDS(st.doms[i].nbits);
+st.words = (unsigned long *) space(nw * sizeof(unsigned long));
+for (nw = i = 0; i < st.ndoms; i++) {
+    register DOM *dp = &st.doms[i];
+    dp->w = &st.words[nw];
+    for (j = 0; j < WORDS(dp->nbits); j++) dp->w[j] = ~0UL;
+    if (dp->nbits % BITS) dp->w[j - 1] = (1UL << (dp->nbits % BITS)) - 1;
+    nw += WORDS(dp->nbits);
+    }
+
+/* the constraints of each domain */
+st.uses = (int *) space((st.ndoms + 1) * sizeof(int));
+for (i = 0; i <= st.ndoms; i++) st.uses[i] = 0;
+for (c = st.cons; c < st.cons + st.ncons; c++)
+    for (i = 0; i < c->nd; i++) st.uses[c->d[i] + 1]++;
+for (i = 0; i < st.ndoms; i++) st.uses[i + 1] += st.uses[i];
+st.used = (int *) space((st.uses[st.ndoms] + 1) * sizeof(int));
+for (c = st.cons; c < st.cons + st.ncons; c++)
+    for (i = 0; i < c->nd; i++) st.used[st.uses[c->d[i]]++] = c - st.cons;
+for (i = st.ndoms; i > 0; i--) st.uses[i] = st.uses[i - 1];
+st.uses[0] = 0;
+
+/* propagate and search */
+st.queue = (int *) space(st.ncons * sizeof(int));
+st.head = 0;
+st.count = st.ncons;
+for (i = 0; i < st.ncons; i++) {
+    st.queue[i] = i;
+    st.cons[i].queued = TRUE;
+    }
+st.trail = (TRAIL *) NULL;
+st.kept = (unsigned long *) NULL;
+st.ntrail = st.trail_size = st.nkept = st.kept_size = 0;
+st.level = 0;
+st.failures = 0;
+solved = search(&st, &ops);
+ctx->stats.fd_failures += st.failures;
+
+if (solved) {
+    vars = (NODE **) space(st.ndoms * sizeof(NODE *));
+    val = (double *) space(st.ndoms * sizeof(double));
+    for (c = st.cons; c < st.cons + st.ncons; c++) lp_satisfied(c->at);
+    for (i = 0; i < st.ndoms; i++) {
+	vars[i] = (NODE *) st.doms[i].var;
+	val[i] = (double) st.doms[i].value;
+	}
+    lp_bind(vars, val, st.ndoms);
+    free((char *) val);
+    free((char *) vars);
+    changed = TRUE;
+    }
+else if (st.failures <= FAILURES) {	/* there is no solution */
+    lp_false();
+    changed = TRUE;
+    }
+
+if (st.trail) free((char *) st.trail);
+if (st.kept) free((char *) st.kept);
+free((char *) st.queue);
+free((char *) st.used);
+free((char *) st.uses);
+free((char *) st.words);
+for (c = st.cons; c < st.cons + st.ncons; c++) {
+    free((char *) c->d);
+    free((char *) c->t);
+    }
+free((char *) st.cons);
+free((char *) st.map);
+free((char *) st.doms);
+ctx->stats.fd_time += stats_clock() - start;
+return changed;
+}
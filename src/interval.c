@@ -0,0 +1,713 @@
+/***********************************************************************
+ *
+ * Bounds of variables, by interval constraint propagation.
+ *
+ * Once no rule matches the subject any more (and simplex.c has
+ * nothing to do), each free numvar in the constraints of its top
+ * level ; chain
+ *
+ *	a = b	a <= b	a < b	(a < b is taken as a <= b)
+ *
+ * whose sides are built of numbers, numvars, linear expressions of
+ * beep, and
+ *
+ *	a + b	a - b	a * b	a / b	a ^ b	- a
+ *
+ * gets an interval, its domain, which starts as all the numbers.
+ * The name points to it (its domain field), and ctx->domains holds
+ * them.  Each constraint is compiled into a tape of steps that
+ * computes a - b, and is revised the HC4 way:
+ *
+ *	- forward, the interval of each step is found from those of
+ *	  its arguments, bottom up;
+ *	- the interval of the last step is cut down to [0, 0] for
+ *	  an equation or [-inf, 0] for an inequality;
+ *	- backward, the interval of each argument is cut down to what
+ *	  could give its step's interval (x in (r - b) for r = x + b,
+ *	  and so on), top down, which cuts down the domains of the
+ *	  variables at the bottom.
+ *
+ * A constraint is revised again when the domain of one of its
+ * variables has been cut down by more than a little since it was
+ * last revised.  The constraints to be revised wait in a queue, and
+ * when it is empty the domains are as small as revising any one
+ * constraint can make them:
+ *
+ *	- if one is empty, the constraints cannot all hold, and false
+ *	  is put at the front of the chain;
+ *	- a variable whose domain is a single number (within rounding)
+ *	  is bound to it, and a constraint all of whose variables are
+ *	  bound that way is replaced by true;
+ *	- other domains are left, and --bounds prints them after the
+ *	  answer (see interval_print).
+ *
+ * Each step is rounded outward, so that a domain always holds every
+ * solution: x = sqrt(2) is found from x * x = 2 and 0 <= x (x * x
+ * is taken as x ^ 2, which can be revised where x * x cannot).  Other
+ * than that, this only finds what revising one constraint at a time
+ * can, so a domain may be much bigger than the solutions in it.
+ *
+ * While a program with edit variables is first being solved (see
+ * edit.c), nothing is done here, as for simplex.c.
+ *
+ ***********************************************************************/
+
+#include "def.h"
+#include <math.h>
+
+#define ROUNDING	4e-16	/* relative error of a step, rounded out */
+#define SINGLE		1e-9	/* a domain this narrow is a number */
+#define PROGRESS	1e-3	/* part of a domain cut to revise again */
+#define REVISIONS	100	/* times each constraint can be revised */
+
+int bounds;			/* print domains? set by --bounds */
+
+/* from other modules */
+OP *op_find();			/* from ops.c */
+void lp_satisfied();		/* from simplex.c */
+void lp_bind();			/* from simplex.c */
+void lp_false();		/* from simplex.c */
+void qname_print();		/* from names.c */
+double stats_clock();		/* from stats.c */
+void free();
+
+/* steps of a tape */
+#define S_CONST	0	/* c */
+#define S_VAR	1	/* domain var */
+#define S_ADD	2	/* a + b */
+#define S_SUB	3	/* a - b */
+#define S_MUL	4	/* a * b */
+#define S_DIV	5	/* a / b */
+#define S_POW	6	/* a ^ b */
+#define S_NEG	7	/* - a */
+
+typedef struct step {
+	int code;
+	int a, b;		/* steps that are its arguments */
+	int var;		/* domain, for S_VAR */
+	double c;		/* constant, for S_CONST */
+	double lo, hi;		/* interval, while revising */
+	} STEP;
+
+/* a constraint: the steps from first to last compute a - b */
+typedef struct con {
+	NODE **at;		/* the conjunct it was made from */
+	int first, last;
+	int equal;		/* a = b, else a <= b */
+	int queued;		/* waiting to be revised? */
+	} CON;
+
+/* the operators of beep and bops it knows */
+typedef struct ops {
+	OP *semi, *equal, *le, *lt, *plus, *times, *numvar;
+	OP *add, *sub, *mul, *div, *pow, *neg;
+	} OPS;
+
+/* the constraints waiting to be revised, each at most once */
+typedef struct queue {
+	int *item;
+	int head, count, size;
+	} QUEUE;
+
+/* what is being built */
+typedef struct tape {
+	STEP *s;
+	int n, size;
+	} TAPE;
+
+#define space(n)	mem_get((size_t) (n), "interval propagation")
+#define more(p, n)	mem_grow((void *) (p), (size_t) (n), "interval propagation")
+
+/***********************************************************************
+ *
+ * The domain of a variable, made if it has none.
+ *
+ * returns:	its index in ctx->domains
+ *
+ ***********************************************************************/
+static int
+domain(nn)
+register NAME_NODE *nn;
+{
+register BERT_CTX *ctx = bert_ctx;
+register int i = nn->domain - 1;
+
+if (i >= 0 && i < ctx->ndomains && ctx->domains[i].var == nn) return i;
+if (ctx->ndomains == ctx->domain_size) {
+    ctx->domain_size = ctx->domain_size ? 2 * ctx->domain_size : 32;
+    ctx->domains = (INTERVAL *) (ctx->domains ?
+	more((char *) ctx->domains, ctx->domain_size * sizeof(INTERVAL)) :
+	space(ctx->domain_size * sizeof(INTERVAL)));
+    }
+i = ctx->ndomains++;
+ctx->domains[i].var = nn;
+ctx->domains[i].lo = -HUGE_VAL;
+ctx->domains[i].hi = HUGE_VAL;
+nn->domain = i + 1;
+return i;
+}
+
+/***********************************************************************
+ *
+ * Compile an expression onto the end of the tape.
+ *
+ * returns:	its step, -1 if it cannot be compiled
+ *
+ ***********************************************************************/
+static int
+emit(tp, code, a, b)
+register TAPE *tp;
+int code, a, b;
+{
+if (tp->n == tp->size) {
+    tp->size = tp->size ? 2 * tp->size : 64;
+    tp->s = (STEP *) more((char *) tp->s, tp->size * sizeof(STEP));
+    }
+tp->s[tp->n].code = code;
+tp->s[tp->n].a = a;
+tp->s[tp->n].b = b;
+return tp->n++;
+}
+
+static int
+compile(tp, ex, ops)
+register TAPE *tp;
+register NODE *ex;
+register OPS *ops;
+{
+register TERM_NODE *tn = (TERM_NODE *) ex;
+register OP *op = ex->op;
+int a, b, s, code;
+
+if (op->arity & OP_NUM) {
+    s = emit(tp, S_CONST, -1, -1);
+    tp->s[s].c = ((NUM_NODE *) ex)->value;
+    return s;
+    }
+if (op->arity & OP_NAME) {
+    if (op != ops->numvar || ((NAME_NODE *) ex)->value) return -1;
+    s = emit(tp, S_VAR, -1, -1);
+    tp->s[s].var = domain((NAME_NODE *) ex);
+    return s;
+    }
+if ((op->arity & BINARY) == BINARY) {
+    if (op == ops->add || op == ops->plus) code = S_ADD;
+    else if (op == ops->sub) code = S_SUB;
+    else if (op == ops->mul || op == ops->times) code = S_MUL;
+    else if (op == ops->div) code = S_DIV;
+    else if (op == ops->pow) code = S_POW;
+    else return -1;
+    if (0 > (a = compile(tp, tn->left, ops))) return -1;
+    if (0 > (b = compile(tp, tn->right, ops))) return -1;
+    if (code == S_MUL && tp->s[a].code == S_VAR && tp->s[b].code == S_VAR &&
+      tp->s[a].var == tp->s[b].var) {	/* x * x, as x ^ 2 */
+	tp->s[b].code = S_CONST;
+	tp->s[b].c = 2.0;
+	code = S_POW;
+	}
+    return emit(tp, code, a, b);
+    }
+if (op->arity == PREFIX && op == ops->neg) {
+    if (0 > (a = compile(tp, tn->right, ops))) return -1;
+    return emit(tp, S_NEG, a, -1);
+    }
+return -1;
+}
+
+/***********************************************************************
+ *
+ * Interval arithmetic.  Each function gives the interval [*lo, *hi]
+ * of a result, rounded out, and returns FALSE if it is empty.
+ *
+ ***********************************************************************/
+static double
+lower(x)
+double x;
+{
+return (x == HUGE_VAL || x == -HUGE_VAL) ? x : x - fabs(x) * ROUNDING;
+}
+
+static double
+upper(x)
+double x;
+{
+return (x == HUGE_VAL || x == -HUGE_VAL) ? x : x + fabs(x) * ROUNDING;
+}
+
+/* a product, with 0 * inf = 0 */
+static double
+times(x, y)
+double x, y;
+{
+return (x == 0.0 || y == 0.0) ? 0.0 : x * y;
+}
+
+static int
+mul(alo, ahi, blo, bhi, lo, hi)
+double alo, ahi, blo, bhi;
+double *lo, *hi;
+{
+double p[4];
+register int i;
+
+p[0] = times(alo, blo);
+p[1] = times(alo, bhi);
+p[2] = times(ahi, blo);
+p[3] = times(ahi, bhi);
+*lo = *hi = p[0];
+for (i = 1; i < 4; i++) {
+    if (p[i] < *lo) *lo = p[i];
+    if (p[i] > *hi) *hi = p[i];
+    }
+*lo = lower(*lo);
+*hi = upper(*hi);
+return TRUE;
+}
+
+/* a / b, or all the numbers if b holds 0 (empty if b is just 0) */
+static int
+quo(alo, ahi, blo, bhi, lo, hi)
+double alo, ahi, blo, bhi;
+double *lo, *hi;
+{
+if (blo > 0.0 || bhi < 0.0)
+    return mul(alo, ahi, lower(1.0 / bhi), upper(1.0 / blo), lo, hi);
+*lo = -HUGE_VAL;
+*hi = HUGE_VAL;
+return blo != 0.0 || bhi != 0.0;
+}
+
+/* is b a whole number n, with a^n defined for any a? */
+static int
+whole(blo, bhi)
+double blo, bhi;
+{
+return blo == bhi && blo == floor(blo) && fabs(blo) <= 1e6;
+}
+
+static int
+power(alo, ahi, blo, bhi, lo, hi)
+double alo, ahi, blo, bhi;
+double *lo, *hi;
+{
+double x, y;
+
+if (whole(blo, bhi)) {
+    if (blo == 0.0) {
+	*lo = *hi = 1.0;
+	return TRUE;
+	}
+    x = pow(alo, fabs(blo));
+    y = pow(ahi, fabs(blo));
+    if (fmod(blo, 2.0) != 0.0) {	/* odd */
+	*lo = x;
+	*hi = y;
+	}
+    else if (alo >= 0.0) {
+	*lo = x;
+	*hi = y;
+	}
+    else if (ahi <= 0.0) {
+	*lo = y;
+	*hi = x;
+	}
+    else {
+	*lo = 0.0;
+	*hi = (x > y) ? x : y;
+	}
+    *lo = lower(lower(*lo));		/* pow may be off by an ulp */
+    *hi = upper(upper(*hi));
+    if (blo < 0.0) return quo(1.0, 1.0, *lo, *hi, lo, hi);
+    return TRUE;
+    }
+if (alo > 0.0) {	/* monotone in each argument */
+    double p[4];
+    register int i;
+
+    p[0] = pow(alo, blo);
+    p[1] = pow(alo, bhi);
+    p[2] = pow(ahi, blo);
+    p[3] = pow(ahi, bhi);
+    *lo = *hi = p[0];
+    for (i = 1; i < 4; i++) {
+	if (p[i] < *lo) *lo = p[i];
+	if (p[i] > *hi) *hi = p[i];
+	}
+    *lo = lower(lower(*lo));
+    *hi = upper(upper(*hi));
+    return TRUE;
+    }
+*lo = -HUGE_VAL;
+*hi = HUGE_VAL;
+return TRUE;
+}
+
+/* the n-th root of x, n odd or x not negative */
+static double
+root(x, n)
+double x, n;
+{
+if (x == HUGE_VAL || x == -HUGE_VAL) return x;
+return (x < 0.0) ? -pow(-x, 1.0 / n) : pow(x, 1.0 / n);
+}
+
+/***********************************************************************
+ *
+ * Cut an interval down to [lo, hi].
+ *
+ * returns:	FALSE if it is empty
+ *
+ ***********************************************************************/
+static int
+narrow(xlo, xhi, lo, hi)
+double *xlo, *xhi;
+double lo, hi;
+{
+if (lo > *xlo) *xlo = lo;
+if (hi < *xhi) *xhi = hi;
+return *xlo <= *xhi;
+}
+
+/* cut the interval of a step down to [l, h] */
+#define CUT(p, l, h)	narrow(&(p)->lo, &(p)->hi, l, h)
+
+/***********************************************************************
+ *
+ * Revise a constraint, HC4 style, and queue those that share a
+ * variable whose domain it cut down.
+ *
+ * returns:	FALSE if a domain is empty
+ *
+ ***********************************************************************/
+static int
+revise(s, c, uses, used, cons, q)
+STEP *s;		/* the tape */
+CON *c;
+int *uses, *used;	/* constraints of domain i: used[uses[i] .. uses[i+1]) */
+CON *cons;
+register QUEUE *q;
+{
+register BERT_CTX *ctx = bert_ctx;
+register STEP *p;
+register int i;
+STEP *a, *b;
+INTERVAL *d;
+double lo, hi, olo, ohi, n;
+
+/* forward */
+for (i = c->first; i <= c->last; i++) {
+    p = &s[i];
+    a = (p->a >= 0) ? &s[p->a] : (STEP *) NULL;
+    b = (p->b >= 0) ? &s[p->b] : (STEP *) NULL;
+    switch (p->code) {
+     case S_CONST:
+	p->lo = p->hi = p->c;
+	break;
+     case S_VAR:
+	p->lo = ctx->domains[p->var].lo;
+	p->hi = ctx->domains[p->var].hi;
+	break;
+     case S_ADD:
+	p->lo = lower(a->lo + b->lo);
+	p->hi = upper(a->hi + b->hi);
+	break;
+     case S_SUB:
+	p->lo = lower(a->lo - b->hi);
+	p->hi = upper(a->hi - b->lo);
+	break;
+     case S_MUL:
+	mul(a->lo, a->hi, b->lo, b->hi, &p->lo, &p->hi);
+	break;
+     case S_DIV:
+	if (!quo(a->lo, a->hi, b->lo, b->hi, &p->lo, &p->hi)) return FALSE;
+	break;
+     case S_POW:
+	power(a->lo, a->hi, b->lo, b->hi, &p->lo, &p->hi);
+	break;
+     case S_NEG:
+	p->lo = -a->hi;
+	p->hi = -a->lo;
+	break;
+     }
+    }
+
+/* the relation */
+if (!CUT(&s[c->last], -HUGE_VAL, 0.0)) return FALSE;
+if (c->equal && !CUT(&s[c->last], 0.0, HUGE_VAL)) return FALSE;
+
+/* backward */
+for (i = c->last; i >= c->first; i--) {
+    p = &s[i];
+    a = (p->a >= 0) ? &s[p->a] : (STEP *) NULL;
+    b = (p->b >= 0) ? &s[p->b] : (STEP *) NULL;
+    switch (p->code) {
+     case S_CONST:
+	if (p->c < p->lo || p->c > p->hi) return FALSE;
+	break;
+     case S_VAR:
+	d = &ctx->domains[p->var];
+	olo = d->lo;
+	ohi = d->hi;
+	if (!narrow(&d->lo, &d->hi, p->lo, p->hi)) return FALSE;
+	if (olo == -HUGE_VAL || ohi == HUGE_VAL ?
+	  (d->lo != olo || d->hi != ohi) :
+	  (d->lo - olo) + (ohi - d->hi) > PROGRESS * (ohi - olo)) {
+	    register int j;
+
+	    for (j = uses[p->var]; j < uses[p->var + 1]; j++)
+		if (&cons[used[j]] != c && !cons[used[j]].queued) {
+		    cons[used[j]].queued = TRUE;
+		    q->item[(q->head + q->count++) % q->size] = used[j];
+		    }
+	    }
+	break;
+     case S_ADD:
+	if (!CUT(a, lower(p->lo - b->hi), upper(p->hi - b->lo))) return FALSE;
+	if (!CUT(b, lower(p->lo - a->hi), upper(p->hi - a->lo))) return FALSE;
+	break;
+     case S_SUB:
+	if (!CUT(a, lower(p->lo + b->lo), upper(p->hi + b->hi))) return FALSE;
+	if (!CUT(b, lower(a->lo - p->hi), upper(a->hi - p->lo))) return FALSE;
+	break;
+     case S_MUL:
+	if (b->lo > 0.0 || b->hi < 0.0) {
+	    quo(p->lo, p->hi, b->lo, b->hi, &lo, &hi);
+	    if (!CUT(a, lo, hi)) return FALSE;
+	    }
+	if (a->lo > 0.0 || a->hi < 0.0) {
+	    quo(p->lo, p->hi, a->lo, a->hi, &lo, &hi);
+	    if (!CUT(b, lo, hi)) return FALSE;
+	    }
+	break;
+     case S_DIV:
+	mul(p->lo, p->hi, b->lo, b->hi, &lo, &hi);
+	if (!CUT(a, lo, hi)) return FALSE;
+	if (p->lo > 0.0 || p->hi < 0.0) {
+	    quo(a->lo, a->hi, p->lo, p->hi, &lo, &hi);
+	    if (!CUT(b, lo, hi)) return FALSE;
+	    }
+	break;
+     case S_POW:
+	if (!whole(b->lo, b->hi) || b->lo <= 0.0) break;
+	n = b->lo;
+	if (fmod(n, 2.0) != 0.0) {	/* odd */
+	    if (!CUT(a, lower(lower(root(p->lo, n))),
+	      upper(upper(root(p->hi, n))))) return FALSE;
+	    }
+	else {		/* a in -r or r */
+	    double plo, phi, mlo, mhi;
+	    int pos, neg;
+
+	    if (!CUT(p, 0.0, HUGE_VAL)) return FALSE;
+	    lo = lower(lower(root(p->lo, n)));
+	    hi = upper(upper(root(p->hi, n)));
+	    plo = mlo = a->lo;
+	    phi = mhi = a->hi;
+	    pos = narrow(&plo, &phi, lo, hi);
+	    neg = narrow(&mlo, &mhi, -hi, -lo);
+	    if (!pos && !neg) return FALSE;
+	    a->lo = neg ? mlo : plo;
+	    a->hi = pos ? phi : mhi;
+	    }
+	break;
+     case S_NEG:
+	if (!CUT(a, -p->hi, -p->lo)) return FALSE;
+	break;
+     }
+    }
+return TRUE;
+}
+
+/* is a domain a single number? */
+static int
+single(d)
+register INTERVAL *d;
+{
+double most = fabs(d->lo) > fabs(d->hi) ? fabs(d->lo) : fabs(d->hi);
+
+if (d->lo == -HUGE_VAL || d->hi == HUGE_VAL) return FALSE;
+return d->hi - d->lo <= SINGLE * (most > 1.0 ? most : 1.0);
+}
+
+/***********************************************************************
+ *
+ * Propagate the bounds of the constraints of the subject.
+ *
+ * returns:	TRUE if the subject was changed
+ *
+ ***********************************************************************/
+int
+interval()
+{
+register BERT_CTX *ctx = bert_ctx;
+register CON *c;
+register int i, j;
+OPS ops;
+TAPE tp;
+CON *cons;
+QUEUE q;
+NODE **at, *x, **bound;
+double *val, start;
+int *uses, *used;
+int ncons = 0, size = 16, first, a, b, nb, left, ok = TRUE;
+
+ctx->ndomains = 0;
+if (!ctx->subject || (ctx->nedits && !ctx->solved)) return FALSE;
+ops.semi = op_find(ctx->single_op, ";", BINARY);
+ops.equal = op_find(ctx->single_op, "=", BINARY);
+ops.le = op_find(ctx->double_op, "<=", BINARY);
+ops.lt = op_find(ctx->single_op, "<", BINARY);
+ops.numvar = op_find(ctx->type_op, "numvar", 0);
+if (!ops.semi || !ops.equal || !ops.numvar) return FALSE;
+ops.plus = op_find(ctx->double_op, "++", BINARY);
+ops.times = op_find(ctx->double_op, "**", BINARY);
+ops.add = op_find(ctx->single_op, "+", BINARY);
+ops.sub = op_find(ctx->single_op, "-", BINARY);
+ops.mul = op_find(ctx->single_op, "*", BINARY);
+ops.div = op_find(ctx->single_op, "/", BINARY);
+ops.pow = op_find(ctx->single_op, "^", BINARY);
+ops.neg = op_find(ctx->single_op, "-", PREFIX);
+
+/* compile the constraints of the chain */
+start = stats_clock();
+tp.s = (STEP *) NULL;
+tp.n = tp.size = 0;
+cons = (CON *) space(size * sizeof(CON));
+for (at = &ctx->subject; ; at = &((TERM_NODE *) *at)->right) {
+    NODE **conj = ((*at)->op == ops.semi) ? &((TERM_NODE *) *at)->left : at;
+    x = *conj;
+    if (x->op == ctx->false_op) break;
+    if (x->op == ops.equal || x->op == ops.le || x->op == ops.lt) {
+	first = tp.n;
+	a = compile(&tp, ((TERM_NODE *) x)->left, &ops);
+	b = (a < 0) ? -1 : compile(&tp, ((TERM_NODE *) x)->right, &ops);
+	for (i = first; b >= 0 && i < tp.n && tp.s[i].code != S_VAR; i++) ;
+	if (b >= 0 && i < tp.n) {	/* else left to the rules */
+	    if (ncons == size)
+		cons = (CON *) more((char *) cons, (size *= 2) * sizeof(CON));
+	    c = &cons[ncons++];
+	    c->at = conj;
+	    c->first = first;
+	    c->last = emit(&tp, S_SUB, a, b);
+	    c->equal = (x->op == ops.equal);
+	    }
+	else tp.n = first;
+	}
+    if ((*at)->op != ops.semi) break;
+    }
+if (x->op == ctx->false_op || !ctx->ndomains) {
+    ctx->ndomains = 0;
+    free((char *) tp.s);
+    free((char *) cons);
+    return FALSE;
+    }
+ctx->stats.interval++;
+
+/* the constraints of each domain */
+uses = (int *) space((ctx->ndomains + 1) * sizeof(int));
+for (j = 0; j <= ctx->ndomains; j++) uses[j] = 0;
+for (c = cons; c < cons + ncons; c++)
+    for (i = c->first; i <= c->last; i++)
+	if (tp.s[i].code == S_VAR) uses[tp.s[i].var + 1]++;
+for (j = 0; j < ctx->ndomains; j++) uses[j + 1] += uses[j];
+used = (int *) space((uses[ctx->ndomains] + 1) * sizeof(int));
+for (c = cons; c < cons + ncons; c++)
+    for (i = c->first; i <= c->last; i++)
+	if (tp.s[i].code == S_VAR) {
+	    j = tp.s[i].var;
+	    used[uses[j]++] = c - cons;
+	    }
+for (j = ctx->ndomains; j > 0; j--) uses[j] = uses[j - 1];
+uses[0] = 0;
+
+/* revise the constraints until the queue is empty */
+q.item = (int *) space(ncons * sizeof(int));
+q.head = 0;
+q.count = q.size = ncons;
+for (i = 0; i < ncons; i++) {
+    q.item[i] = i;
+    cons[i].queued = TRUE;
+    }
+for (left = REVISIONS * ncons; ok && q.count && left > 0; left--) {
+    c = &cons[q.item[q.head]];
+    q.head = (q.head + 1) % q.size;
+    q.count--;
+    c->queued = FALSE;
+    ok = revise(tp.s, c, uses, used, cons, &q);
+    }
+
+/* false, or bind the variables that have one value */
+nb = 0;
+if (!ok) lp_false();
+else {
+    bound = (NODE **) space(ctx->ndomains * sizeof(NODE *));
+    val = (double *) space(ctx->ndomains * sizeof(double));
+    for (c = cons; c < cons + ncons; c++) {
+	for (i = c->first; i <= c->last; i++)
+	    if (tp.s[i].code == S_VAR && !single(&ctx->domains[tp.s[i].var]))
+		break;
+	if (i > c->last) lp_satisfied(c->at);
+	}
+    for (j = 0; j < ctx->ndomains; j++)
+	if (single(&ctx->domains[j])) {
+	    bound[nb] = (NODE *) ctx->domains[j].var;
+	    val[nb++] = 0.5 * (ctx->domains[j].lo + ctx->domains[j].hi);
+	    }
+    if (nb) lp_bind(bound, val, nb);
+    free((char *) val);
+    free((char *) bound);
+    }
+
+free((char *) q.item);
+free((char *) used);
+free((char *) uses);
+free((char *) cons);
+free((char *) tp.s);
+ctx->stats.interval_time += stats_clock() - start;
+return !ok || nb > 0;
+}
+
+/***********************************************************************
+ *
+ * Print the domains of the variables left in the answer (--bounds).
+ * They are found from the subject, so that names freed since the
+ * domains were made are never looked at.
+ *
+ ***********************************************************************/
+static void
+show(ex)
+register NODE *ex;
+{
+register BERT_CTX *ctx = bert_ctx;
+register NAME_NODE *nn;
+register INTERVAL *d;
+int i;
+
+if (!ex) return;
+if (ex->op->arity & OP_NAME) {
+    nn = (NAME_NODE *) ex;
+    i = nn->domain - 1;
+    if (nn->value || i < 0 || i >= ctx->ndomains) return;
+    d = &ctx->domains[i];
+    if (d->var != nn || d->shown) return;
+    d->shown = TRUE;
+    if (d->lo == -HUGE_VAL && d->hi == HUGE_VAL) return;
+    fprintf(ctx->out, "bounds: ");
+    qname_print(nn);
+    fprintf(ctx->out, " [%g, %g]\n", d->lo, d->hi);
+    return;
+    }
+if (!(ex->op->arity & OP_TERM)) return;
+show(((TERM_NODE *) ex)->left);
+show(((TERM_NODE *) ex)->right);
+}
+
+void
+interval_print()
+{
+register BERT_CTX *ctx = bert_ctx;
+register int i;
+
+for (i = 0; i < ctx->ndomains; i++) ctx->domains[i].shown = FALSE;
+show(ctx->subject);
+}
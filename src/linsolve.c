@@ -0,0 +1,511 @@
+/***********************************************************************
+ *
+ * Solve linear equations by Gaussian elimination.
+ *
+ * beep used to solve the equations in a ; chain one at a time,
+ *
+ *	0 = ((c**v'numvar) ++ rest'number) ; ex { v is ((-1/c) * rest) ; ex }
+ *
+ * and every binding was then substituted into the whole subject
+ * before the next equation could be solved.  Instead, the rule
+ *
+ *	0 = lx'linearop ; ex	{ linsolve_primitive }
+ *
+ * now takes every equation 0 = lx in the ; chain whose linear
+ * expression is ready (all of its terms are variables times
+ * constants), and solves them together:
+ *
+ *	- each equation becomes a sparse row, a run of (variable,
+ *	  coefficient) pairs sorted as in lx.c, plus a constant;
+ *	- forward elimination takes the variables in order, and for
+ *	  each one pivots on the row with the largest coefficient
+ *	  (partial pivoting), and eliminates the variable from the
+ *	  other rows that start with it;
+ *	- back substitution gives the value of each pivot variable,
+ *	  as a constant, or (if there are fewer independent equations
+ *	  than variables) as a linear expression in the variables that
+ *	  were not pivots, as the one at a time rule did;
+ *	- all of the pivot variables are bound at once, and the
+ *	  equations are taken out of the chain.  Equations that were
+ *	  redundant vanish; if they were inconsistent, false is put in
+ *	  their place.
+ *
+ * Equations that are not ready, and all other constraints, are left
+ * in the chain.  While some of those are equations, which may yet
+ * become ready, only the variables that are fixed are bound; the
+ * rest of the solution goes to the end of the chain as equations
+ * 0 = lx - v, for when they are.  Binding a variable to an
+ * expression in others, and then binding those, makes values that
+ * grow exponentially, as the one at a time rule did.
+ *
+ * If the equation that the rule matched is not ready itself (a
+ * binding has put something that is not linear in it, see lx.c),
+ * it is split into 0 = lx + nonlinear, which the rule does not
+ * match, so that the rules for + can finish it.
+ *
+ ***********************************************************************/
+
+#include "def.h"
+#include <math.h>
+
+#define EPSILON	1e-10	/* relative size of a difference taken to be zero */
+#define space(n)	mem_get((size_t) (n), "linear equations")
+
+/* from other modules */
+double lx_run();		/* from lx.c */
+int lx_tidy();			/* from lx.c */
+void lx_put();			/* from lx.c */
+NODE *lx_build();		/* from lx.c */
+NODE *lx_number();		/* from lx.c */
+NODE *lx_term();		/* from lx.c */
+int lx_order();			/* from lx.c */
+NODE *expr_copy();		/* from expr.c */
+OP *op_find();			/* from ops.c */
+NODE *node_new();		/* from expr.c */
+void edit_attach();		/* from edit.c */
+void free();
+
+/* an equation 0 = t[0] + ... + t[n-1] + k */
+typedef struct row {
+	NODE **at;		/* the equation it was made from */
+	LX_TERM *t;		/* terms, sorted by variable */
+	int n;			/* number of terms */
+	double k;		/* constant */
+	} ROW;
+
+/***********************************************************************
+ *
+ * If an equation is ready, make it into a row.
+ *
+ * returns:	TRUE if it is ready
+ *
+ ***********************************************************************/
+static int
+ready(at, r, equal, plus, times)
+NODE **at;		/* a conjunct of the ; chain */
+ROW *r;			/* row to fill in */
+OP *equal, *plus, *times;
+{
+register TERM_NODE *eq = (TERM_NODE *) *at;
+register LX_TERM *t;
+int n;
+
+if (eq->op != equal || !(eq->left->op->arity & OP_NUM) ||
+  ((NUM_NODE *) eq->left)->value != 0.0 || eq->right->op != plus)
+    return FALSE;
+bert_ctx->lx_nterms = 0;
+r->k = lx_run(eq->right, 1.0, plus, times, &n);
+for (t = bert_ctx->lx_terms; t < bert_ctx->lx_terms + n; t++)
+    if (!(t->var->op->arity & OP_NAME)) return FALSE;
+r->at = at;
+r->n = n;
+r->t = (LX_TERM *) space(n * sizeof(LX_TERM));
+memcpy((char *) r->t, (char *) bert_ctx->lx_terms, n * sizeof(LX_TERM));
+return TRUE;
+}
+
+/* is a - b zero, apart from rounding? */
+static double
+difference(a, b)
+double a, b;
+{
+double d = a - b;
+
+return (fabs(d) <= EPSILON * (fabs(a) + fabs(b))) ? 0.0 : d;
+}
+
+/***********************************************************************
+ *
+ * Subtract f times the pivot row from a row that starts with the
+ * same variable, so that the row no longer has that variable.
+ *
+ ***********************************************************************/
+static void
+eliminate(r, p, f)
+ROW *r, *p;		/* row, pivot row */
+double f;
+{
+register LX_TERM *a = r->t + 1, *b = p->t + 1;
+LX_TERM *ea = r->t + r->n, *eb = p->t + p->n;
+LX_TERM *t = (LX_TERM *) space((r->n + p->n) * sizeof(LX_TERM));
+int n = 0;
+double c;
+
+while (a < ea || b < eb) {
+    if (b == eb || (a < ea && a->var != b->var && 0 > lx_order(
+      (NAME_NODE *) a->var, (NAME_NODE *) b->var)))
+	t[n++] = *a++;
+    else if (a == ea || a->var != b->var) {
+	t[n] = *b++;
+	t[n++].coef *= -f;
+	}
+    else {
+	if (0.0 != (c = difference(a->coef, f * b->coef))) {
+	    t[n] = *a;
+	    t[n++].coef = c;
+	    }
+	a++;
+	b++;
+	}
+    }
+r->k = difference(r->k, f * p->k);
+free((char *) r->t);
+r->t = t;
+r->n = n;
+}
+
+/***********************************************************************
+ *
+ * The constant of a row that has no variables left but edit
+ * variables (see edit.c), which are never pivots, at their values.
+ *
+ ***********************************************************************/
+static double
+leftover(r)
+ROW *r;
+{
+register LX_TERM *t;
+double sum = 0.0;
+
+for (t = r->t; t < r->t + r->n; t++)
+    sum -= t->coef * bert_ctx->edits[((NAME_NODE *) t->var)->edit - 1].value;
+return difference(r->k, sum);
+}
+
+/***********************************************************************
+ *
+ * Forward elimination.
+ * The pivot rows are left in piv[], in the order of their variables,
+ * which are left in pvar[].
+ *
+ * returns:	number of pivots, and in *bad, TRUE if inconsistent
+ *
+ ***********************************************************************/
+static int
+forward(rows, nrows, piv, pvar, bad)
+ROW *rows;
+int nrows;
+int *piv;		/* pivot rows, in order */
+NODE **pvar;		/* and their variables */
+int *bad;		/* inconsistent? */
+{
+int *live = (int *) space(nrows * sizeof(int));
+int nlive = 0, npiv = 0;
+register int i, j;
+int best;
+NODE *col;
+
+for (i = 0; i < nrows; i++) live[nlive++] = i;
+*bad = FALSE;
+for (;;) {
+    /* rows with no variables left are redundant or inconsistent */
+    for (i = j = 0; i < nlive; i++) {
+	ROW *r = &rows[live[i]];
+	if (r->n && !((NAME_NODE *) r->t[0].var)->edit) live[j++] = live[i];
+	else if (leftover(r) != 0.0) *bad = TRUE;
+	}
+    if (0 == (nlive = j)) break;
+
+    /* the next variable, and the row with its largest coefficient */
+    best = live[0];
+    col = rows[best].t[0].var;
+    for (i = 1; i < nlive; i++) {
+	ROW *r = &rows[live[i]];
+	if (r->t[0].var != col) {
+	    if (0 > lx_order((NAME_NODE *) r->t[0].var, (NAME_NODE *) col)) {
+		best = live[i];
+		col = r->t[0].var;
+		}
+	    }
+	else if (fabs(r->t[0].coef) > fabs(rows[best].t[0].coef))
+	    best = live[i];
+	}
+
+    /* eliminate it from the other rows */
+    for (i = j = 0; i < nlive; i++) {
+	ROW *r = &rows[live[i]];
+	if (live[i] == best) continue;
+	if (r->t[0].var == col)
+	    eliminate(r, &rows[best], r->t[0].coef / rows[best].t[0].coef);
+	live[j++] = live[i];
+	}
+    nlive = j;
+    pvar[npiv] = col;
+    piv[npiv++] = best;
+    }
+free((char *) live);
+return npiv;
+}
+
+/* the pivot with variable v, or -1 */
+static int
+pivot_of(v, pvar, npiv)
+NODE *v;
+NODE **pvar;
+int npiv;
+{
+register int lo = 0, hi = npiv - 1, mid, c;
+
+while (lo <= hi) {
+    mid = (lo + hi) / 2;
+    if (0 == (c = lx_order((NAME_NODE *) v, (NAME_NODE *) pvar[mid])))
+	return mid;
+    if (c < 0) hi = mid - 1;
+    else lo = mid + 1;
+    }
+return -1;
+}
+
+/***********************************************************************
+ *
+ * Back substitution.  The value of each pivot variable is left in
+ * its row: no terms and the value as the constant if it is
+ * determined, else the terms of the variables it depends on.
+ *
+ ***********************************************************************/
+static void
+back(rows, piv, pvar, npiv)
+ROW *rows;
+int *piv;
+NODE **pvar;
+int npiv;
+{
+register LX_TERM *t;
+ROW *r, *s;
+int i, j, n;
+double p;
+
+for (i = npiv - 1; i >= 0; i--) {
+    r = &rows[piv[i]];
+    p = r->t[0].coef;
+    bert_ctx->lx_nterms = 0;
+    for (t = r->t + 1; t < r->t + r->n; t++) {
+	if (0 > (j = pivot_of(t->var, pvar, npiv))) {
+	    lx_put(t->var, -t->coef / p);
+	    continue;
+	    }
+	s = &rows[piv[j]];	/* already solved */
+	r->k += t->coef * s->k;
+	for (n = 0; n < s->n; n++)
+	    lx_put(s->t[n].var, -t->coef * s->t[n].coef / p);
+	}
+    n = lx_tidy(0);
+    r->k = r->k ? -r->k / p : 0.0;
+    free((char *) r->t);
+    r->t = (LX_TERM *) space(n * sizeof(LX_TERM));
+    memcpy((char *) r->t, (char *) bert_ctx->lx_terms, n * sizeof(LX_TERM));
+    r->n = n;
+    }
+}
+
+/***********************************************************************
+ *
+ * Split an equation 0 = lx that is not ready into
+ * 0 = (linear part) + (the rest).
+ *
+ ***********************************************************************/
+static NODE *
+split(eq, plus, times)
+TERM_NODE *eq;
+OP *plus, *times;
+{
+OP *add = op_find(bert_ctx->single_op, "+", BINARY);
+OP *mult = op_find(bert_ctx->single_op, "*", BINARY);
+register LX_TERM *t;
+NODE *rest = NULL, *x;
+int n, r;
+double k;
+
+if (!add || !mult)
+    error("operator needed to solve linear equations not defined");
+bert_ctx->lx_nterms = 0;
+k = lx_run(eq->right, 1.0, plus, times, &n);
+for (r = 0; r < n && !(bert_ctx->lx_terms[r].var->op->arity & OP_NAME); r++)
+    ;
+for (t = bert_ctx->lx_terms + r - 1; t >= bert_ctx->lx_terms; t--) {
+    x = expr_copy(t->var);
+    if (t->coef != 1.0) x = lx_term(mult, lx_number(t->coef), x);
+    rest = rest ? lx_term(add, x, rest) : x;
+    }
+x = lx_build(bert_ctx->lx_terms + r, n - r, k, plus, times);
+return lx_term(eq->op, expr_copy(eq->left), lx_term(add, x, rest));
+}
+
+/***********************************************************************
+ *
+ * The equation 0 = k + terms - var that a row solved for var is.
+ *
+ ***********************************************************************/
+static NODE *
+solved(r, var, equal, plus, times)
+ROW *r;
+NODE *var;
+OP *equal, *plus, *times;
+{
+register LX_TERM *t;
+int n;
+
+bert_ctx->lx_nterms = 0;
+lx_put(var, -1.0);
+for (t = r->t; t < r->t + r->n; t++) lx_put(t->var, t->coef);
+n = lx_tidy(0);
+return lx_term(equal, lx_number(0.0),
+    lx_build(bert_ctx->lx_terms, n, r->k, plus, times));
+}
+
+/***********************************************************************
+ *
+ * The primitive.  tn is (0 = lx) ; ex.
+ *
+ * The chain can be most of the subject, so the parts of it that are
+ * kept are taken out of the redex instead of being copied: the links
+ * of the conjuncts that are not ready are moved into the answer, and
+ * zeros are left in the places of the other parts, for walk() to free.
+ *
+ ***********************************************************************/
+static NODE *
+take(at)
+NODE **at;		/* a part of the redex */
+{
+NODE *part = *at;
+
+*at = lx_number(0.0);
+return part;
+}
+
+NODE *
+lx_solve(tn)
+TERM_NODE *tn;
+{
+TERM_NODE *eq = (TERM_NODE *) tn->left;
+OP *semi = tn->op;
+OP *equal = eq->op;
+OP *plus = eq->right->op;
+OP *times = ((TERM_NODE *) eq->right)->left->op;
+register TERM_NODE *c;
+ROW *rows;
+int *piv;
+NODE **pvar;
+int nrows, size, npiv, bad, i;
+int pending = FALSE;		/* equations that are not ready yet? */
+NODE *answer, **link, **at;
+
+if (bert_ctx->nedits) edit_attach();
+rows = (ROW *) space((size = 16) * sizeof(ROW));
+if (!ready(&tn->left, &rows[0], equal, plus, times)) {
+    free((char *) rows);
+    return lx_term(semi, split(eq, plus, times), take(&tn->right));
+    }
+
+/* collect the equations that are ready, and take the rest */
+nrows = 1;
+link = &answer;
+for (at = &tn->right; (*at)->op == semi; ) {
+    c = (TERM_NODE *) *at;
+    if (nrows == size) {
+	void *realloc();
+	rows = (ROW *) realloc((char *) rows, (size *= 2) * sizeof(ROW));
+	if (!rows) error("out of memory for linear equations");
+	}
+    if (ready(&c->left, &rows[nrows], equal, plus, times)) {
+	nrows++;
+	at = &c->right;
+	}
+    else {	/* unlinked from the redex, into the answer */
+	if (c->left->op == equal) pending = TRUE;
+	*at = c->right;
+	c->quiet = 0;		/* what follows it has changed */
+	*link = (NODE *) c;
+	link = &c->right;
+	}
+    }
+
+piv = (int *) space(nrows * sizeof(int));
+pvar = (NODE **) space(nrows * sizeof(NODE *));
+npiv = forward(rows, nrows, piv, pvar, &bad);
+back(rows, piv, pvar, npiv);
+
+/*
+ * While other equations are still on their way, bind only the
+ * variables that are fixed.  The others go back at the end of the
+ * chain, solved in terms of the variables that are not fixed yet:
+ * binding a variable to an expression in others, and then binding
+ * those, makes values that grow and grow.
+ */
+for (i = 0; pending && i < npiv; i++)
+    if (rows[piv[i]].n) {
+	*link = lx_term(semi,
+	    solved(&rows[piv[i]], pvar[i], equal, plus, times), (NODE *) NULL);
+	link = &((TERM_NODE *) *link)->right;
+	}
+*link = take(at);
+
+/* bind them all */
+for (i = 0; i < npiv; i++) {
+    ROW *r = &rows[piv[i]];
+    if (!r->n)
+	((NAME_NODE *) pvar[i])->value = lx_number(r->k);
+    else if (!pending)
+	((NAME_NODE *) pvar[i])->value = lx_build(r->t, r->n, r->k, plus, times);
+    else continue;
+    bert_ctx->bondage = TRUE;	/* as bind_primitive does */
+    }
+
+if (bad) {
+    c = (TERM_NODE *) node_new();
+    c->op = bert_ctx->false_op;
+    c->label = (NAME_NODE *) NULL;
+    c->left = c->right = (NODE *) NULL;
+    answer = lx_term(semi, (NODE *) c, answer);
+    }
+for (i = 0; i < nrows; i++) free((char *) rows[i].t);
+free((char *) rows);
+free((char *) piv);
+free((char *) pvar);
+return answer;
+}
+
+/***********************************************************************
+ *
+ * Solve rows t + k = 0 that have been made some other way, for the
+ * steps of Newton's method (newton.c).  The terms of each row are
+ * sorted by lx_order, and the seq of each term is the number of its
+ * variable.  A variable that is not a pivot is taken to be 0.
+ *
+ * returns:	number of pivots, -1 if the rows are inconsistent;
+ *		the value of each pivot variable is left in x[seq]
+ *
+ ***********************************************************************/
+int
+lx_step(t, n, k, nrows, x)
+LX_TERM **t;		/* terms of each row */
+int *n;			/* number of terms of each row */
+double *k;		/* constant of each row */
+int nrows;
+double *x;		/* value of each variable */
+{
+ROW *rows = (ROW *) space(nrows * sizeof(ROW));
+int *piv = (int *) space(nrows * sizeof(int));
+NODE **pvar = (NODE **) space(nrows * sizeof(NODE *));
+int *seq = (int *) space(nrows * sizeof(int));
+int npiv, bad, i;
+
+for (i = 0; i < nrows; i++) {
+    rows[i].at = (NODE **) NULL;
+    rows[i].n = n[i];
+    rows[i].k = k[i];
+    rows[i].t = (LX_TERM *) space(n[i] * sizeof(LX_TERM));
+    memcpy((char *) rows[i].t, (char *) t[i], n[i] * sizeof(LX_TERM));
+    }
+npiv = forward(rows, nrows, piv, pvar, &bad);
+for (i = 0; i < npiv; i++) seq[i] = rows[piv[i]].t[0].seq;
+back(rows, piv, pvar, npiv);
+for (i = 0; i < npiv; i++) x[seq[i]] = rows[piv[i]].k;
+
+for (i = 0; i < nrows; i++) free((char *) rows[i].t);
+free((char *) rows);
+free((char *) piv);
+free((char *) pvar);
+free((char *) seq);
+return bad ? -1 : npiv;
+}
@@ -0,0 +1,382 @@
+/***********************************************************************
+ *
+ * Native arithmetic on linear expressions.
+ *
+ * In beep a linear expression is a chain
+ *
+ *	(c1**v1) ++ (c2**v2) ++ ... ++ (cn**vn) ++ k
+ *
+ * with the variables sorted (by name_compare, as lexc does) and the
+ * c's and the k constants.  Adding two of them with the lx_merge
+ * rules took a rewrite per term.  The primitives here do the same
+ * work in C: each argument is flattened into a run of a sorted array
+ * of (variable, coefficient) pairs plus a constant, the runs are
+ * merged, and the result is built back into a chain.
+ *
+ *	linear_add_primitive		lx1 + lx2
+ *	linear_scale_primitive		k * lx, lx * k
+ *	linear_substitute_primitive	(c ** lx) ++ rest
+ *
+ * A bound variable is replaced by its value while flattening, and a
+ * link (c ** lx) that a binding has put into a chain is multiplied
+ * out, so these work on chains whether or not the subject has been
+ * updated since the last binding.  Anything in a chain that is not
+ * linear (a term that has not been reduced yet, say) is carried
+ * along as a link (c ** x) at the front of the result, for the
+ * rules to deal with once it has been reduced.
+ *
+ * This is what the unfinished ole_* routines in old/mole.c set
+ * out to do.
+ *
+ ***********************************************************************/
+
+#include "def.h"
+
+/* from other modules */
+NODE *node_new();		/* from expr.c */
+NODE *expr_copy();		/* from expr.c */
+int name_compare();		/* from names.c */
+
+/***********************************************************************
+ *
+ * The array of terms.  It lives in the context and is reused, so
+ * that it only grows until it is big enough for the largest chain.
+ *
+ ***********************************************************************/
+static void
+room(n)
+int n;			/* terms to be added */
+{
+void *malloc();
+void *realloc();
+register BERT_CTX *ctx = bert_ctx;
+
+if (ctx->lx_nterms + n > ctx->lx_size) {
+    while (ctx->lx_nterms + n > ctx->lx_size)
+	ctx->lx_size = ctx->lx_size ? 2 * ctx->lx_size : 64;
+    ctx->lx_terms = (LX_TERM *) (ctx->lx_terms ?
+	realloc((char *) ctx->lx_terms, ctx->lx_size * sizeof(LX_TERM)) :
+	malloc(ctx->lx_size * sizeof(LX_TERM)));
+    if (!ctx->lx_terms) error("out of memory for linear expression");
+    }
+}
+
+void
+lx_put(var, coef)
+NODE *var;		/* variable, or something not linear */
+double coef;
+{
+register BERT_CTX *ctx = bert_ctx;
+
+room(1);
+ctx->lx_terms[ctx->lx_nterms].var = var;
+ctx->lx_terms[ctx->lx_nterms].coef = coef;
+ctx->lx_terms[ctx->lx_nterms].seq = ctx->lx_nterms;
+ctx->lx_nterms++;
+}
+
+/* is this the ++ or ** operator of the chain? */
+#define LINK(ex, f)	((ex)->op == (f) && (ex)->op->arity & BINARY)
+
+/***********************************************************************
+ *
+ * Flatten scale times a linear expression onto the end of the array.
+ *
+ * returns:	the constant part, times scale
+ *
+ ***********************************************************************/
+static double
+flatten(ex, scale, plus, times)
+register NODE *ex;
+double scale;
+OP *plus, *times;	/* ++ and ** */
+{
+register TERM_NODE *tn = (TERM_NODE *) ex;
+double k = 0.0;
+
+for (;;) {	/* down the chain */
+    if (ex->op->arity & OP_NUM) return k + scale * ((NUM_NODE *) ex)->value;
+    if (ex->op->arity & OP_NAME) {
+	if (((NAME_NODE *) ex)->value)		/* substitute */
+	    return k + flatten(((NAME_NODE *) ex)->value, scale, plus, times);
+	lx_put(ex, scale);
+	return k;
+	}
+    if (LINK(ex, times) && (tn->left->op->arity & OP_NUM)) {
+	scale *= ((NUM_NODE *) tn->left)->value;
+	ex = tn->right;
+	tn = (TERM_NODE *) ex;
+	continue;
+	}
+    if (!LINK(ex, plus)) {		/* not linear */
+	lx_put(ex, scale);
+	return k;
+	}
+    k += flatten(tn->left, scale, plus, times);
+    ex = tn->right;
+    tn = (TERM_NODE *) ex;
+    }
+}
+
+/***********************************************************************
+ *
+ * Order of terms in a run: things that are not linear first, in the
+ * order they were found, then variables by lx_order.
+ *
+ ***********************************************************************/
+
+/* variables by name_compare, with edit variables (see edit.c) last */
+int
+lx_order(a, b)
+register NAME_NODE *a, *b;
+{
+if (a->edit != b->edit) return a->edit - b->edit;
+return name_compare(a, b);
+}
+
+static int
+lx_compare(a, b)
+register LX_TERM *a, *b;
+{
+int na = (a->var->op->arity & OP_NAME);
+int nb = (b->var->op->arity & OP_NAME);
+
+if (na && nb && a->var != b->var)
+    return lx_order((NAME_NODE *) a->var, (NAME_NODE *) b->var);
+if (na != nb) return na ? 1 : -1;
+return a->seq - b->seq;		/* stable */
+}
+
+/***********************************************************************
+ *
+ * Make the terms from the end of the array back to from into a run:
+ * sorted, with each variable once, and no zero coefficients.  Runs
+ * of chains built by these primitives are already sorted; only
+ * substitution can make a run that has to be sorted.
+ *
+ * returns:	length of the run
+ *
+ ***********************************************************************/
+int
+lx_tidy(from)
+int from;		/* first term of the run */
+{
+void qsort();
+register LX_TERM *t, *to;
+LX_TERM *base, *end;
+int sorted = TRUE;
+
+base = bert_ctx->lx_terms + from;
+end = bert_ctx->lx_terms + bert_ctx->lx_nterms;
+for (t = base; t + 1 < end; t++)
+    if (lx_compare(t, t + 1) >= 0) sorted = FALSE;
+if (!sorted) qsort((char *) base, end - base, sizeof(LX_TERM), lx_compare);
+
+/* add up the coefficients of each variable */
+for (t = to = base; t < end; t++) {
+    if (to > base && t->var == to[-1].var) to[-1].coef += t->coef;
+    else *to++ = *t;
+    }
+/* and drop the ones that cancelled */
+end = to;
+for (t = to = base; t < end; t++)
+    if (t->coef != 0.0) *to++ = *t;
+bert_ctx->lx_nterms = to - bert_ctx->lx_terms;
+return bert_ctx->lx_nterms - from;
+}
+
+/***********************************************************************
+ *
+ * Flatten scale times an argument onto the end of the array as a run.
+ *
+ * returns:	constant part, and the length of the run in *n
+ *
+ ***********************************************************************/
+double
+lx_run(ex, scale, plus, times, n)
+NODE *ex;
+double scale;
+OP *plus, *times;
+int *n;
+{
+int from = bert_ctx->lx_nterms;
+double k = flatten(ex, scale, plus, times);
+
+*n = lx_tidy(from);
+return k;
+}
+
+/***********************************************************************
+ *
+ * Merge two runs, the last two in the array, into one.
+ * This is lx_merge: terms come from whichever run has the lesser
+ * variable, and the coefficients of the same variable are added
+ * (in the order the rules added them), and dropped if they cancel.
+ *
+ * returns:	length of the merged run, which replaces the two
+ *
+ ***********************************************************************/
+static int
+merge(n1, n2)
+int n1, n2;		/* length of first and second run */
+{
+register LX_TERM *a, *b;
+LX_TERM *ea, *eb;
+int from = bert_ctx->lx_nterms - n1 - n2;
+int n, c;
+
+room(n1 + n2);		/* for the result, after the runs */
+a = bert_ctx->lx_terms + from;
+ea = b = a + n1;
+eb = b + n2;
+
+n = 0;
+while (a < ea || b < eb) {
+    if (a < ea && b < eb && a->var == b->var) {
+	if (a->coef + b->coef != 0.0) {
+	    eb[n] = *a;
+	    eb[n++].coef = a->coef + b->coef;
+	    }
+	a++;
+	b++;
+	continue;
+	}
+    c = (a == ea) ? 1 : (b == eb) ? -1 : lx_compare(a, b);
+    if (c < 0) eb[n++] = *a++;
+    else eb[n++] = *b++;
+    }
+if (n)
+    memmove((char *) (bert_ctx->lx_terms + from), (char *) eb,
+	n * sizeof(LX_TERM));
+bert_ctx->lx_nterms = from + n;
+return n;
+}
+
+/***********************************************************************
+ *
+ * Build a run back into a chain.
+ *
+ ***********************************************************************/
+NODE *
+lx_number(value)
+double value;
+{
+register NUM_NODE *num = (NUM_NODE *) node_new();
+
+num->value = value;
+if (value == 0.0) num->op = bert_ctx->znum_prim;
+else num->op = (value > 0.0) ? bert_ctx->pnum_prim : bert_ctx->nnum_prim;
+return (NODE *) num;
+}
+
+NODE *
+lx_term(op, left, right)
+OP *op;
+NODE *left, *right;
+{
+register TERM_NODE *tn = (TERM_NODE *) node_new();
+
+tn->op = op;
+tn->label = (NAME_NODE *) NULL;
+tn->left = left;
+tn->right = right;
+return (NODE *) tn;
+}
+
+NODE *
+lx_build(first, n, k, plus, times)
+LX_TERM *first;		/* the run */
+int n;			/* its length */
+double k;		/* constant part */
+OP *plus, *times;
+{
+NODE *lx = lx_number(k);
+
+while (n-- > 0)		/* first may be NULL when n is 0 */
+    lx = lx_term(plus,
+	lx_term(times, lx_number(first[n].coef), expr_copy(first[n].var)), lx);
+return lx;
+}
+
+/***********************************************************************
+ *
+ * The primitives.  The arguments are checked by the rules in beep
+ * that invoke them; the ++ and ** operators are taken from the chain
+ * that is an argument.  The redex is freed after the primitive
+ * returns, so everything in the answer is built new or copied.
+ *
+ ***********************************************************************/
+
+/* the ++ and ** operators of a chain */
+static void
+chain_ops(ex, plus, times)
+TERM_NODE *ex;		/* a ++ term */
+OP **plus, **times;
+{
+*plus = ex->op;
+*times = ex->left->op;
+}
+
+/* the sum of the two arguments of tn */
+static NODE *
+sum(tn, plus, times)
+TERM_NODE *tn;
+OP *plus, *times;
+{
+int n1, n2, n;
+double k;
+
+bert_ctx->lx_nterms = 0;
+k = lx_run(tn->left, 1.0, plus, times, &n1);
+k += lx_run(tn->right, 1.0, plus, times, &n2);
+n = merge(n1, n2);
+return lx_build(bert_ctx->lx_terms, n, k, plus, times);
+}
+
+/* lx1 + lx2, where one or both are ++ terms */
+NODE *
+lx_add(tn)
+TERM_NODE *tn;
+{
+OP *plus, *times;
+
+if (tn->left->op->arity & BINARY)
+    chain_ops((TERM_NODE *) tn->left, &plus, &times);
+else chain_ops((TERM_NODE *) tn->right, &plus, &times);
+return sum(tn, plus, times);
+}
+
+/* k * lx or lx * k */
+NODE *
+lx_scale(tn)
+TERM_NODE *tn;
+{
+OP *plus, *times;
+NODE *k, *lx;
+int n;
+double c;
+
+if (tn->left->op->arity & OP_NUM) {
+    k = tn->left;
+    lx = tn->right;
+    }
+else {
+    k = tn->right;
+    lx = tn->left;
+    }
+chain_ops((TERM_NODE *) lx, &plus, &times);
+bert_ctx->lx_nterms = 0;
+c = lx_run(lx, ((NUM_NODE *) k)->value, plus, times, &n);
+return lx_build(bert_ctx->lx_terms, n, c, plus, times);
+}
+
+/* (c ** x) ++ rest, where x is a constant or a chain */
+NODE *
+lx_substitute(tn)
+TERM_NODE *tn;
+{
+OP *plus, *times;
+
+chain_ops(tn, &plus, &times);
+return sum(tn, plus, times);
+}
@@ -1,85 +1,314 @@
 #include "def.h"
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <unistd.h>
 
-int verbose;
 char *libdir;	/* where #included files are found */
 
 static char* copyright = "copyright (c) 1988 Wm Leler";
 
+#define TOPRULES 5	/* busiest rules printed when a limit is hit */
+
+/*********************************************************************
+ *
+ * Run one program on top of the libraries in ctx, replacing the
+ * program before it.  A program that runs into a limit has its
+ * partial result and busiest rules printed.
+ *
+ * returns:	exit status for the program, 0, 1, or BERT_LIMIT
+ *
+ *********************************************************************/
+int
+run_program(ctx, fp, name)
+BERT_CTX *ctx;
+FILE *fp;			/* program file */
+char *name;			/* program file name */
+{
+int ctx_load();			/* from ctx.c */
+int ctx_solve();		/* from ctx.c */
+void ctx_print();		/* from ctx.c */
+void ctx_report();		/* from ctx.c */
+void graphics_close();		/* from graphics.c */
+extern int graphics;		/* from graphics.c */
+void stats_print();		/* from stats.c */
+int status = 0;
+int rc;
+
+rc = ctx_load(ctx, fp, name);		/* call parser */
+if (BERT_OK == rc) rc = ctx_solve(ctx);	/* apply rules to subject */
+if (BERT_OK == rc) {
+    ctx_print(ctx);
+    if (statistics) stats_print(name);
+    }
+else {
+    fprintf(stderr, "%s\n", ctx->error_msg);
+    status = 1;
+    }
+if (BERT_LIMIT == rc) {
+    ctx_report(ctx, TOPRULES);
+    if (statistics) stats_print(name);
+    status = BERT_LIMIT;
+    }
+
+if (graphics) {
+    fprintf(stderr, "Zap output window to continue...\n");
+    graphics_close();
+    }
+return status;
+}
+
+/*********************************************************************
+ *
+ * Run one program in a child process, which gets a copy of the
+ * libraries already loaded into ctx and exits when done, so that
+ * ctx itself is left as it was.
+ * If the fork fails, the program is run in this process.
+ *
+ * returns:	exit status for the program
+ *
+ *********************************************************************/
+static int
+fork_program(ctx, fp, name)
+BERT_CTX *ctx;
+FILE *fp;			/* program file */
+char *name;			/* program file name */
+{
+pid_t pid;
+int status;
+
+fflush(stdout);		/* or the child would write it again */
+fflush(stderr);
+pid = fork();
+if (0 == pid) {
+    status = run_program(ctx, fp, name);
+    fflush(stdout);
+    _exit(status);
+    }
+if (pid < 0) {
+    perror("bert: fork");
+    return run_program(ctx, fp, name);
+    }
+while (waitpid(pid, &status, 0) < 0)
+    if (EINTR != errno) {
+	perror("bert: waitpid");
+	return 1;
+	}
+if (WIFSIGNALED(status)) {
+    fprintf(stderr, "program %s killed by signal %d\n",
+	name, WTERMSIG(status));
+    return 1;
+    }
+return WEXITSTATUS(status);
+}
+
 /*********************************************************************
  *
  * Execution shell for Bertrand interpreter.
  * 
  * command line arguments:	names of bertrand programs to be executed 
  *
+ * switches (before any program names):
+ *	--stats		print run statistics for each program
+ *	--bounds	print the bounds found for the variables left in
+ *			each answer (see interval.c)
+ *	--include lib	load library lib once, before any program
+ *	--steps n	stop a program after n rewrites
+ *	--time s	stop a program after s seconds of rewriting
+ *	--nodes n	stop a program after it adds n expression nodes
+ *	--strategy s	reduction strategy: outermost (the default),
+ *			innermost or parallel (see walk in match.c)
+ *	--cycles n	stop a program if its subject comes back to an
+ *			earlier state within n rewrites (see cycle.c)
+ *	--split n	solve the independent parts of a subject in up
+ *			to n child processes (see split.c)
+ *	--agenda	rewrite the cheap conjuncts of the subject first
+ *			(see walk in match.c)
+ *	--serve socket	run as a daemon on a local socket (see serve.c)
+ *	--fork		run each program (or daemon request) in a child
+ *			process forked after the libraries are loaded
+ *	--send socket	send the programs to a daemon, print the replies
+ *	-j n		run the programs n at a time (see batch.c)
+ *	--session	read inputs from stdin one at a time, keeping
+ *			the rules and bindings of each (see session.c)
+ *
+ * exit status:	0 if every program ran, BERT_LIMIT (3) if any ran into
+ *		a limit, else 1 if any failed
+ *
  *********************************************************************/
 int
 main(argc, argv)
 int argc;
 char *argv[];
 {
-void parse();			/* from parse.c */
-extern FILE *infile;		/* from scanner.c */
-extern char *infilename;	/* from scanner.c */
-extern int lineno;		/* from scanner.c */
-NODE *init();			/* from util.c */
-extern int learn;		/* from match.c */
-NODE *walk();			/* from match.c */
-void expr_print();		/* from expr.c */
-void name_space_print();	/* from names.c */
-extern NAME_NODE *global_names;	/* from names.c */
-void graphics_close();		/* from graphics.c */
-extern int graphics;		/* from graphics.c */
-void st_mem_free();		/* from util.c */
+BERT_CTX *ctx_new();		/* from ctx.c */
+int ctx_include();		/* from ctx.c */
+void ctx_free();		/* from ctx.c */
+int serve();			/* from serve.c */
+int send_program();		/* from serve.c */
+int batch();			/* from batch.c */
+int strategy_named();		/* from prep.c */
+int session();			/* from session.c */
 char *getenv();			/* UNIX system routine */
 void exit(int);			/* UNIX system routine */
+double atof();			/* UNIX system routine */
+long atol();			/* UNIX system routine */
+int atoi();			/* UNIX system routine */
 
 int argno = 1;			/* command line argument */
-NODE *subject;			/* subject expression */
+int status = 0;			/* exit status */
+int rc;
+BERT_CTX *ctx;			/* engine context */
+FILE *fp;			/* program file */
+char *name;			/* program file name */
+char *libs[MAXINCLUDES];	/* libraries to preload */
+int nlibs = 0;
+int i;
+char *socket = NULL;		/* --serve */
+char *server = NULL;		/* --send */
+int forking = FALSE;		/* --fork */
+int jobs = 0;			/* -j */
+int incremental = FALSE;	/* --session */
+long steps = 0;			/* --steps */
+double seconds = 0.0;		/* --time */
+long nodes = 0;			/* --nodes */
+int window = 0;			/* --cycles */
+int strategy = 0;		/* --strategy */
+int parts = 0;			/* --split */
+int agenda = FALSE;		/* --agenda */
 
 /* check for BERTRAND environment variable */
 if (!(libdir = getenv("BERTRAND"))) libdir = LIBDIR;
 
-do {
-    subject = init();		/* init constant operators */
-    if (argc==1) {
-	infilename = "stdin";
-	infile = stdin;
-	parse();
+/* command line switches */
+for (; argno < argc && '-' == argv[argno][0]; argno++) {
+    if (0 == strcmp(argv[argno], "--stats")) statistics = TRUE;
+    else if (0 == strcmp(argv[argno], "--bounds")) bounds = TRUE;
+    else if (0 == strcmp(argv[argno], "--include") && argno+1 < argc) {
+	if (nlibs >= MAXINCLUDES) {
+	    fprintf(stderr, "too many libraries\n");
+	    exit(1);
+	    }
+	libs[nlibs++] = argv[++argno];
 	}
-    else {
-	infilename = argv[argno];
-	infile = fopen(infilename, "r");
-	if (NULL==infile) {
-	    fprintf(stderr, "can't open program file %s\n", infilename);
+    else if (0 == strcmp(argv[argno], "--steps") && argno+1 < argc)
+	steps = atol(argv[++argno]);
+    else if (0 == strcmp(argv[argno], "--time") && argno+1 < argc)
+	seconds = atof(argv[++argno]);
+    else if (0 == strcmp(argv[argno], "--nodes") && argno+1 < argc)
+	nodes = atol(argv[++argno]);
+    else if (0 == strcmp(argv[argno], "--strategy") && argno+1 < argc) {
+	if (!(strategy = strategy_named(argv[++argno]))) {
+	    fprintf(stderr, "--strategy must be outermost, innermost or parallel\n");
 	    exit(1);
 	    }
-	parse();	/* call parser */
-	fclose(infile);
 	}
-
-    lineno = 0;	/* to supress error message line numbers */
-    if (verbose) fprintf(stderr, "\n");
-
-    do {	/* apply rules to subject expression */
-	subject = walk(subject);
-	} while (learn);
-
-    if (verbose && global_names->child) {
-	fprintf(stderr, "\nglobal name space is: ");
-	name_space_print(global_names);
+    else if (0 == strcmp(argv[argno], "--cycles") && argno+1 < argc) {
+	window = atoi(argv[++argno]);
+	if (window < 3 || window > MAXWINDOW) {
+	    fprintf(stderr, "--cycles needs a window of 3 to %d rewrites\n",
+		MAXWINDOW);
+	    exit(1);
+	    }
+	}
+    else if (0 == strcmp(argv[argno], "--split") && argno+1 < argc) {
+	parts = atoi(argv[++argno]);
+	if (parts < 1) {
+	    fprintf(stderr, "--split needs a number of processes\n");
+	    exit(1);
+	    }
 	}
-    if (verbose) fprintf(stderr, "\nfinal expression is: ");
-    expr_print(subject);
-    fprintf(stderr, "\n");
+    else if (0 == strcmp(argv[argno], "--agenda")) agenda = TRUE;
+    else if (0 == strcmp(argv[argno], "--serve") && argno+1 < argc)
+	socket = argv[++argno];
+    else if (0 == strcmp(argv[argno], "--fork")) forking = TRUE;
+    else if (0 == strcmp(argv[argno], "--session")) incremental = TRUE;
+    else if (0 == strcmp(argv[argno], "--send") && argno+1 < argc)
+	server = argv[++argno];
+    else if (0 == strcmp(argv[argno], "-j") && argno+1 < argc) {
+	jobs = atoi(argv[++argno]);
+	if (jobs < 1) {
+	    fprintf(stderr, "-j needs a number of jobs\n");
+	    exit(1);
+	    }
+	}
+    else {
+	fprintf(stderr, "unknown switch (or missing argument) %s\n", argv[argno]);
+	exit(1);
+	}
+    }
 
-    st_mem_free();	/* free stack memory */
+if (server) {		/* client only, nothing to load */
+    do {
+	if (argno==argc) status |= send_program(server, stdin);
+	else if (NULL == (fp = fopen(argv[argno], "r"))) {
+	    fprintf(stderr, "can't open program file %s\n", argv[argno]);
+	    status = 1;
+	    }
+	else {
+	    status |= send_program(server, fp);
+	    fclose(fp);
+	    }
+	} while(++argno<argc);
+    return status;
+    }
 
-    if (graphics) {
-	fprintf(stderr, "Zap output window to continue...\n");
-	graphics_close();
+ctx = ctx_new();
+ctx->step_limit = steps;
+ctx->time_limit = seconds;
+ctx->node_limit = nodes;
+ctx->cycle_window = window;
+ctx->strategy = strategy;
+ctx->parts = parts;
+ctx->agenda = agenda;
+for (i = 0; i < nlibs; i++) {
+    if (BERT_OK != ctx_include(ctx, libs[i])) {
+	fprintf(stderr, "%s\n", ctx->error_msg);
+	exit(1);
 	}
+    }
+if (socket) {
+    status = serve(ctx, socket, forking);
+    ctx_free(ctx);
+    return status;
+    }
+if (incremental) {
+    status = session(ctx);
+    ctx_free(ctx);
+    return status;
+    }
+if (jobs) {
+    if (argno == argc) {
+	fprintf(stderr, "-j needs program files\n");
+	exit(1);
+	}
+    status = batch(ctx, argc - argno, &argv[argno], jobs);
+    ctx_free(ctx);
+    return status;
+    }
 
+do {
+    if (argno==argc) {
+	name = "stdin";
+	fp = stdin;
+	}
+    else {
+	name = argv[argno];
+	fp = fopen(name, "r");
+	if (NULL==fp) {
+	    fprintf(stderr, "can't open program file %s\n", name);
+	    if (!status) status = 1;
+	    continue;
+	    }
+	}
+    /* each program is loaded on top of the libraries,
+       replacing the program before it */
+    if (forking) rc = fork_program(ctx, fp, name);
+    else rc = run_program(ctx, fp, name);
+    if (rc > status) status = rc;
+    if (fp != stdin) fclose(fp);
     } while(++argno<argc);
 
-    return 0;
+ctx_free(ctx);
+return status;
 }
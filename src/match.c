@@ -3,9 +3,6 @@
 
 #define MAXP 32		/* maximum number of parameters in a rule */
 NODE *param_val[MAXP];	/* array of parameter values */
-int learn;		/* did I learn anything? */
-int bondage;		/* did a variable get bound? */
-static SNODE *stack;	/* stack for walking tree */
 
 #define WR  1		/* walk right next */
 #define POP 2		/* pop stack next */
@@ -15,7 +12,6 @@ typedef struct sub_stack {
     struct sub_stack *next;
     NODE *exp;
     } SUB_STACK;
-static SUB_STACK *sub_top = NULL;
 
 /******************************************************************
  *
@@ -30,8 +26,10 @@ void *malloc();
 register SUB_STACK *node;
 
 node = (SUB_STACK *) malloc(sizeof(SUB_STACK));
-node->next = sub_top;
+if (!node) error("out of memory for subject stack");
+node->next = bert_ctx->sub_top;
 node->exp = old;
+bert_ctx->sub_top = node;
 }
 
 /******************************************************************
@@ -46,9 +44,9 @@ void free();
 register SUB_STACK *node;
 register NODE *exp;
 
-if (!sub_top) return NULL;
-node = sub_top;
-sub_top = node->next;
+if (!bert_ctx->sub_top) return NULL;
+node = bert_ctx->sub_top;
+bert_ctx->sub_top = node->next;
 exp = node->exp;
 free(node);
 return exp;
@@ -70,13 +68,19 @@ match(exp)
 NODE *exp;	/* the expression to match */
 {
 int match_sub(register NODE *, register NODE *);	/* forward reference */
+int ac_match();			/* from ac.c */
+void ac_temp_free();		/* from ac.c */
 register RULE *rtt;	/* rule to try */
 
 /* this assumes that the root of all rule heads are terms */
 if (!(exp->op->arity & OP_TERM)) return (RULE *) NULL; 
 
 for(rtt = exp->op->hash; rtt; rtt = rtt->next) {
-    if (match_sub(rtt->head, exp)) return rtt;
+    if (exp->op->ac) {		/* modulo AC, see ac.c */
+	if (ac_match(rtt->head, exp, TRUE)) return rtt;
+	if (bert_ctx->ac_ntemps) ac_temp_free();
+	}
+    else if (match_sub(rtt->head, exp)) return rtt;
     }
 return (RULE *) NULL;	/* no rule matched */
 }
@@ -109,7 +113,7 @@ register NODE *head;		/* pattern to match against */
 register NODE *exp;		/* subexpression to match */
 {
 char *arity_name();		/* from ops.c */
-extern OP *untyped_prim;	/* from primitive.c */
+int ac_match();			/* from ac.c */
 
 if (head->op->arity == OP_STR) {
     return (exp->op->arity == OP_STR && 0 == strcmp(
@@ -120,7 +124,7 @@ if (head->op->arity == OP_NUM) {
 	((NUM_NODE *) head)->value == ((NUM_NODE *) exp)->value);
     }
 if (head->op->arity == OP_NAME) {	/* parameter */
-    if (head->op == untyped_prim || match_types(head->op, exp)) {
+    if (head->op == bert_ctx->untyped_prim || match_types(head->op, exp)) {
 	/* bind value to parameter */
 	((NAME_NODE *) head)->value = exp;
 	return TRUE;
@@ -144,6 +148,7 @@ if (head->op->arity & BINARY) {
 	match_sub(((TERM_NODE *) head)->left, ((TERM_NODE *) exp)->left) &&
 	match_sub(((TERM_NODE *) head)->right,((TERM_NODE *) exp)->right)); */
     if ((!(exp->op->arity & BINARY)) || (head->op != exp->op)) return FALSE;
+    if (head->op->ac) return ac_match(head, exp, FALSE);
     if (!match_sub(((TERM_NODE *) head)->left, ((TERM_NODE *) exp)->left))
 	return FALSE;
     if (!match_sub(((TERM_NODE *) head)->right,((TERM_NODE *) exp)->right))
@@ -155,14 +160,191 @@ error("Unknown arity during pattern match!");
 return FALSE;	/* will never execute */
 }
 
+/*************************************************************
+ *
+ * Free a redex, except for the parameters instantiate moved into
+ * the body that replaces it.
+ *
+ *************************************************************/
+static void
+redex_free(fn)
+register NODE *fn;
+{
+void expr_free();		/* from expr.c */
+void node_free();		/* from expr.c */
+void name_free();		/* from names.c */
+register int i;
+
+for (i = 0; i < bert_ctx->nmoved; i++)
+    if (fn == bert_ctx->moved[i]) return;
+if (fn->op->arity & HAS_ARG) {
+    if (((TERM_NODE *) fn)->label) name_free(((TERM_NODE *) fn)->label);
+    if ((fn->op->arity & BINARY) || (fn->op->arity == POSTFIX))
+	redex_free(((TERM_NODE *) fn)->left);
+    if (fn->op->arity != POSTFIX) redex_free(((TERM_NODE *) fn)->right);
+    node_free(fn);
+    }
+else expr_free(fn);
+}
+
+/*************************************************************
+ *
+ * Replace the bound variables in a rule body just instantiated.
+ * The parameters moved into it came from the subject, which has
+ * none, so they are not walked again.
+ *
+ *************************************************************/
+static NODE *
+fresh_update(tree)
+register NODE *tree;
+{
+NODE *expr_update();		/* from expr.c */
+register int i;
+
+for (i = 0; i < bert_ctx->nmoved; i++)
+    if (tree == bert_ctx->moved[i]) return tree;
+if (tree->op->arity & OP_TERM) {
+    register TERM_NODE *tn = (TERM_NODE *) tree;
+    if (tn->left) tn->left = fresh_update(tn->left);
+    if (tn->right) tn->right = fresh_update(tn->right);
+    return tree;
+    }
+return expr_update(tree);
+}
+
 /*************************************************************
  *
  * Walk the tree, looking for subexpressions that match a rule
  *
+ * The tree is walked left to right.  A term is tried before its
+ * arguments (outermost), unless its operator or the default
+ * strategy of the run says innermost, when its arguments are
+ * walked first.  The walk stops at the first rewrite, except
+ * with the PARALLEL strategy, where it goes on past the
+ * replacement to the rest of the subject (but stops if a
+ * variable gets bound).
+ *
+ * A term whose arguments have been walked, and that has been tried
+ * itself, without a rewrite, is quiet: it is stamped with
+ * bert_ctx->quiet, and later passes skip it, instead of matching
+ * every term in it again, as they would every constraint that is
+ * stuck.  It stays quiet until a variable in it gets bound, when
+ * expr_update wakes it and the terms it is in.  Anything else that
+ * could make a rule match it (a new rule, a name getting a type when
+ * the term it labels is rewritten, ac terms being rearranged in
+ * place) changes the stamp, which wakes every term.
+ *
+ * A parameter used just once in the body of a regular rule is moved
+ * there from the redex, rather than copied (see instantiate), so
+ * the rest of a ; chain is relinked, quiet as it was, instead of
+ * being copied, updated and freed on every rewrite at its head.
+ *
  * exit:	possibly transformed expression
  *		sets global variable "learn" if transformed.
  *
  *************************************************************/
+
+/* are the arguments of cn walked before cn itself is tried? */
+#define INNER(cn, s)	((cn)->op->arity & HAS_ARG && (cn)->op->eval != -4 \
+			&& INNERMOST == ((cn)->op->strategy ? (cn)->op->strategy : (s)))
+
+/* is cn inside an ac chain, rather than its root? */
+#define AC_INSIDE(cn)	((cn)->op->ac & AC_ASSOC && bert_ctx->stack && \
+			bert_ctx->stack->node->op == (cn)->op && \
+			!((TERM_NODE *) (cn))->label)
+
+/* is cn a term known not to match anywhere? */
+#define QUIET(cn)	((cn)->op->arity & OP_TERM && \
+			((TERM_NODE *) (cn))->quiet == bert_ctx->quiet)
+
+/***********************************************************************
+ *
+ * The agenda (--agenda).  A pass of walk() stops at its first
+ * rewrite, so a binding n = k far down the top level ; chain waits
+ * until every conjunct before it is stuck.  With the agenda, a pass
+ * first looks down the chain (as far as the first quiet link, past
+ * which nothing matches) for a cheap conjunct that a rule matches
+ * now: true, or a relation between two names or numbers, which binds
+ * a variable or tests constants.  The first one found is rewritten,
+ * at its link (n = k ; rest) or by itself; other conjuncts wait for
+ * the walk in order, as before.
+ *
+ * returns:	the node to rewrite, its rule in *rule, and the links
+ *		above it on the stack; or subject, if there is none
+ *
+ ***********************************************************************/
+#define AGENDA	64	/* links of the chain looked down */
+
+static int
+cheap(x)
+register NODE *x;
+{
+register char *p;
+
+if (x->op == bert_ctx->true_op) return TRUE;
+if (!(x->op->arity & BINARY) || ((TERM_NODE *) x)->label ||
+  ((TERM_NODE *) x)->left->op->arity & OP_TERM) return FALSE;
+if (0 == strcmp(x->op->pname, "is")) return TRUE;
+if (((TERM_NODE *) x)->right->op->arity & OP_TERM) return FALSE;
+p = x->op->pname;
+if (p[0] == '~') p++;
+if (p[0] != '=' && p[0] != '<' && p[0] != '>') return FALSE;
+return !p[1] || (p[0] != '=' && p[1] == '=' && !p[2]);
+}
+
+static NODE *
+agenda(subject, strategy, rule)
+NODE *subject;
+int strategy;
+RULE **rule;
+{
+SNODE *st_get();		/* from util.c */
+register NODE *cn;
+register SNODE *stn;
+OP *semi = subject->op;
+NODE *x;
+int n = 0;
+
+if (!(semi->arity & BINARY) || strcmp(semi->pname, ";") || semi->ac ||
+  INNER(subject, strategy)) return subject;
+for (cn = subject; cn->op == semi && !QUIET(cn) && n++ < AGENDA;
+  cn = ((TERM_NODE *) cn)->right) {
+    x = ((TERM_NODE *) cn)->left;
+    if (cheap(x) && !QUIET(x)) {
+	if ((*rule = match(cn))) break;
+	if (!INNER(x, strategy)) {
+	    if ((*rule = match(x))) {
+		stn = st_get();
+		stn->next = bert_ctx->stack;
+		bert_ctx->stack = stn;
+		stn->node = cn;
+		stn->info = WR;
+		cn = x;
+		break;
+		}
+	    /* a relation of two leaves: nothing in it matches till it changes */
+	    if (x->op->arity & BINARY &&
+	      !(((TERM_NODE *) x)->right->op->arity & OP_TERM))
+		((TERM_NODE *) x)->quiet = bert_ctx->quiet;
+	    }
+	}
+    stn = st_get();		/* went right */
+    stn->next = bert_ctx->stack;
+    bert_ctx->stack = stn;
+    stn->node = cn;
+    stn->info = POP;
+    }
+if (*rule) {
+    bert_ctx->stats.agenda++;
+    return cn;
+    }
+while ((stn = bert_ctx->stack)) {
+    bert_ctx->stack = stn->next;
+    st_free(stn);
+    }
+return subject;
+}
+
 NODE *
 walk(subject)
 NODE *subject;		/* subject expression */
@@ -175,16 +357,36 @@ NAME_NODE *name_space_insert();	/* from names.c */
 void name_free();		/* from names.c */
 NODE *expr_copy();		/* from expr.c */
 NODE *expr_update();		/* from expr.c */
-extern OP *untyped_prim;	/* from primitive.c */
+void cycle_out();		/* from cycle.c */
+void cycle_in();		/* from cycle.c */
+void cycle_rehash();		/* from cycle.c */
+void cycle_note();		/* from cycle.c */
+NODE *ac_redex();		/* from ac.c */
+NODE *ac_extend();		/* from ac.c */
+void ac_normal();		/* from ac.c */
+void ac_temp_free();		/* from ac.c */
+int ac_up();			/* from ac.c */
+OP *op_find();			/* from ops.c */
 
 register NODE *cn = subject;	/* current node */
 register SNODE *stn;		/* a stack node */
 NAME_NODE *ts;			/* temp name space pointer */
 RULE *mrule;			/* the rule that matched */
+RULE *again = NULL;		/* a rule already matched at cn */
+OP *semi = NULL;		/* ; once it is needed */
 NODE *ib;			/* instantiated body */
+int strategy = bert_ctx->reduction;	/* default strategy */
+int done = FALSE;		/* nothing more to do below cn? */
+int bound;			/* did this rewrite bind a variable? */
+int reshaped;			/* were ac terms above it rearranged? */
 
-learn = FALSE;			/* haven't learned anything yet */
-stack = (SNODE *) NULL;		/* initially empty */
+bert_ctx->learn = FALSE;			/* haven't learned anything yet */
+bert_ctx->moving = FALSE;
+bert_ctx->nmoved = 0;
+bert_ctx->stack = (SNODE *) NULL;		/* initially empty */
+bert_ctx->stats.passes++;
+if (bert_ctx->agenda && OUTERMOST == strategy)
+    cn = agenda(subject, strategy, &again);
 
 for (;;) {	/* for ever */
     if (cn->op->arity == OP_NAME && ((NAME_NODE *)cn)->value) {
@@ -193,9 +395,18 @@ for (;;) {	/* for ever */
 	fprintf(stderr, "\n");
 	error("Found loose bound variable in subject expression!");
 	}
-    else if (mrule = match(cn)) {	/* found a match */
-	learn = TRUE;
-	if ((mrule->verbose + verbose)>1) {
+    else if (!again && QUIET(cn))
+	bert_ctx->stats.skipped++;	/* back up, nothing to do in it */
+    /* the inside of an ac chain is tried as part of the whole chain */
+    else if ((mrule = again) ||
+      ((done || !INNER(cn, strategy)) && !AC_INSIDE(cn) &&
+      (mrule = match(cn)))) {
+	again = (RULE *) NULL;
+	bert_ctx->learn = TRUE;
+	bert_ctx->stats.rewrites++;
+	mrule->fired++;
+	if (bert_ctx->cycle_window) cycle_out(cn);
+	if ((mrule->verbose + bert_ctx->verbose)>1) {
 	    fprintf(stderr, "\nMATCH: ");
 	    rule_print(mrule);
 	    fprintf(stderr, "  REWRITE: ");
@@ -205,77 +416,131 @@ for (;;) {	/* for ever */
 	    }
 	/* if rule has a tag, and redex is labeled, then type the label */
 	if ((cn->op->arity & OP_TERM) && (((TERM_NODE *) cn)->label)) {
-	    ((TERM_NODE *) cn)->label->op = (mrule->tag) ?
-		(mrule->tag) : untyped_prim;
+	    OP *type = (mrule->tag) ? (mrule->tag) : bert_ctx->untyped_prim;
+	    if (((TERM_NODE *) cn)->label->op != type) bert_ctx->quiet++;
+	    ((TERM_NODE *) cn)->label->op = type;
 	    ts = name_space_insert(mrule->space, ((TERM_NODE *) cn)->label);
 	    }
 	else {		/* create new (disjoint) name space */
 	    ts = name_space_insert(mrule->space, (NAME_NODE *) NULL);
 	    name_free(ts);	/* root of space is dummy node */
 	    }
-	if (mrule->body->op->eval > 0) {
-	    ib = primitive_execute(mrule->body->op->eval, cn);	/* primitive */
+	if (mrule->body->op->eval > 0) {	/* primitive */
+	    /* on an ac redex, just the arguments matched, in order */
+	    ib = primitive_execute(mrule->body->op->eval,
+		cn->op->ac ? ac_redex(cn) : cn);
+	    }
+	else {		/* regular rule */
+	    /* not if a parameter may be a node made while matching */
+	    bert_ctx->moving = !cn->op->ac && !bert_ctx->ac_ntemps;
+	    ib = instantiate(mrule->body);
+	    bert_ctx->moving = FALSE;
 	    }
-	else ib = instantiate(mrule->body);	/* regular rule */
-	expr_free(cn);
-	ib = expr_update(ib);	/* remove any bound variables */
-	if (stack) {
-	    if ((stack->info == WR) || (stack->node->op->arity == POSTFIX))
-		((TERM_NODE *) stack->node)->left = ib;
-	    else ((TERM_NODE *) stack->node)->right = ib;
+	if (bert_ctx->ac_ntemps) ac_temp_free();
+	if (cn->op->ac && bert_ctx->ac_extra) ib = ac_extend(cn, ib);
+	else if (bert_ctx->nmoved) redex_free(cn);
+	else expr_free(cn);
+	/* remove any bound variables, unless all of the subject */
+	/* is to be updated below, because a primitive bound some */
+	if (bert_ctx->nmoved) ib = fresh_update(ib);
+	else if (!bert_ctx->bondage || bert_ctx->ac_ops ||
+	  !(ib->op->arity & OP_TERM)) ib = expr_update(ib);
+	bert_ctx->nmoved = 0;
+	if (bert_ctx->ac_ops) ac_normal(ib);
+	if (bert_ctx->stack) {
+	    if ((bert_ctx->stack->info == WR) || (bert_ctx->stack->node->op->arity == POSTFIX))
+		((TERM_NODE *) bert_ctx->stack->node)->left = ib;
+	    else ((TERM_NODE *) bert_ctx->stack->node)->right = ib;
 	    }
 	else subject = ib;
-	if (bondage) {	/* a variable was bound */
+	reshaped = bert_ctx->ac_ops && ac_up();
+	if (bert_ctx->ac_ops) bert_ctx->quiet++;	/* rearranged in place */
+	if ((bound = bert_ctx->bondage)) {	/* a variable was bound */
+	    bert_ctx->stats.updates++;
 	    subject = expr_update(subject);
-	    bondage = FALSE;
+	    bert_ctx->bondage = FALSE;
+	    if (bert_ctx->ac_ops) ac_normal(subject);
 	    }
-	if ((mrule->verbose + verbose)>1) {
+	if (bert_ctx->cycle_window) {
+	    if (bound || reshaped) cycle_rehash(subject);
+	    else cycle_in(ib);
+	    }
+	if (bert_ctx->cycle_window) cycle_note(mrule);
+	if ((mrule->verbose + bert_ctx->verbose)>1) {
 	    expr_print(ib);
 	    fprintf(stderr, "\n  SUBJECT: ");
 	    expr_print(subject);
 	    fprintf(stderr, "\n");
 	    }
-	return subject;
-	}
-    else {	/* walk children */
-	/* do not walk children if eval function = -4 (usually []) */
-	if (cn->op->arity & HAS_ARG && cn->op->eval != -4) {
-	    stn = st_get();
-	    stn->next = stack;	/* push on stack */
-	    stack = stn;
-	    stn->node = cn;
-	    if (cn->op->arity & BINARY) {
-	 	stn->info = WR;		/* next action is walk right */
-		cn = ((TERM_NODE *) cn)->left;
-		}
-	    else {	/* unary */
-		stn->info = POP;	/* next action is pop */
-		if (cn->op->arity == POSTFIX) cn = ((TERM_NODE *) cn)->left;
-		else cn = ((TERM_NODE *) cn)->right;
-		}
+	/* a conjunct that became true: if the ; it is in matches now */
+	/* (true ; a { a }), rewrite that now rather than in a new pass */
+	if (ib->op == bert_ctx->true_op && OUTERMOST == strategy &&
+	  !bound && !reshaped && (stn = bert_ctx->stack) &&
+	  stn->info == WR && (semi || (semi = op_find(bert_ctx->single_op,
+	  ";", BINARY))) && stn->node->op == semi &&
+	  !semi->ac && !INNER(stn->node, strategy) &&
+	  (again = match(stn->node))) {
+	    cn = stn->node;
+	    bert_ctx->stack = stn->next;
+	    st_free(stn);
+	    continue;
 	    }
-	else {		/* terminal node, walk back up stack */
-	    stn = NULL;
-	    do {
-		if (stn) st_free(stn);
-		stn = stack;
-		if (!stn) return subject;
-		cn = stn->node;
-		stack = stn->next;
-		} while (stn->info == POP);
-	    stack = stn;	/* push back, walk right */
-	    cn = ((TERM_NODE *) cn)->right;
-	    stn->info = POP;	/* next move will be a pop */
+	if (PARALLEL != strategy || bound || reshaped) return subject;
+	}		/* else go on after the replacement */
+    /* do not walk children if eval function = -4 (usually []) */
+    else if (!done && cn->op->arity & HAS_ARG && cn->op->eval != -4) {
+	stn = st_get();		/* walk children */
+	stn->next = bert_ctx->stack;	/* push on stack */
+	bert_ctx->stack = stn;
+	stn->node = cn;
+	if (cn->op->arity & BINARY) {
+	    stn->info = WR;		/* next action is walk right */
+	    cn = ((TERM_NODE *) cn)->left;
 	    }
-	}	/* end of no match at this node */
+	else {	/* unary */
+	    stn->info = POP;	/* next action is pop */
+	    if (cn->op->arity == POSTFIX) cn = ((TERM_NODE *) cn)->left;
+	    else cn = ((TERM_NODE *) cn)->right;
+	    }
+	continue;
+	}
+    /* tried, and nothing below it was rewritten */
+    else if (!bert_ctx->learn && cn->op->arity & OP_TERM)
+	((TERM_NODE *) cn)->quiet = bert_ctx->quiet;
+
+    /* nothing more below cn, walk back up stack */
+    done = FALSE;
+    stn = NULL;
+    for (;;) {
+	if (stn) st_free(stn);
+	stn = bert_ctx->stack;
+	if (!stn) return subject;
+	cn = stn->node;
+	bert_ctx->stack = stn->next;
+	if (stn->info != POP) break;
+	/* arguments walked, now try the term itself (not if */
+	/* they may have changed in a parallel pass) */
+	if (!bert_ctx->learn && INNER(cn, strategy)) {
+	    st_free(stn);
+	    done = TRUE;
+	    break;
+	    }
+	if (!bert_ctx->learn) ((TERM_NODE *) cn)->quiet = bert_ctx->quiet;
+	}
+    if (done) continue;
+    bert_ctx->stack = stn;	/* push back, walk right */
+    cn = ((TERM_NODE *) cn)->right;
+    stn->info = POP;	/* next move will be a pop */
     }		/* end of forever */
 }
-
+
 /*************************************************************
  *
  * Instantiate the body of a rule
  * Make a copy of the expression, insert parameters,
  *  put other names into name space.
+ * While walk() sets moving, a parameter used once in the body
+ *  is put in itself, not a copy, and noted in moved.
  *
  * exit:	new expression to be inserted into subject expression
  *
@@ -320,6 +585,10 @@ if (body->op->arity == OP_STR) {
     return (NODE *) se;
     }
 if (body->op->arity == OP_NAME) {	/* parameter or local name */
+    if (bert_ctx->moving && ((NAME_NODE *) body)->uses == 2 &&
+      bert_ctx->nmoved < MAXMOVED)	/* its only use: move it */
+	return bert_ctx->moved[bert_ctx->nmoved++] =
+	    ((NAME_NODE *) body)->value;
     return expr_copy(((NAME_NODE *) body)->value);
     }
 /* if we get here, then there is an error */
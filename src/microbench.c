@@ -0,0 +1,343 @@
+/***********************************************************************
+ *
+ * Microbenchmarks for the engine primitives.
+ *
+ * Links against every interpreter object except main.o, builds
+ * synthetic rules and subjects directly in memory, and times the
+ * low level routines in isolation:
+ *
+ *	match_sub		match.c
+ *	instantiate		match.c
+ *	expr_copy		expr.c
+ *	name_space_insert	names.c (with the name_free walk() does)
+ *	name_put		names.c (lookup of an existing name)
+ *	scan			scanner.c (per token)
+ *	primitive_execute	primitive.c (addition_primitive)
+ *
+ * usage: micro [-r repetitions] [-n operations] [benchmark ...]
+ *
+ * Each benchmark runs one untimed warmup batch of n operations,
+ * then r timed batches.  Output is one tab separated line per
+ * benchmark:  name, ns/op of the fastest batch, ns/op of the median
+ * batch.
+ *
+ ***********************************************************************/
+
+#include "def.h"
+#include <stdlib.h>
+
+char *libdir = LIBDIR;	/* normally from main.c */
+
+/* from other modules */
+BERT_CTX *ctx_new();		/* from ctx.c */
+BERT_CTX *ctx_select();		/* from ctx.c */
+OP *primitive();		/* from util.c */
+double stats_clock();		/* from stats.c */
+NODE *node_new();		/* from expr.c */
+NODE *expr_copy();		/* from expr.c */
+void expr_free();		/* from expr.c */
+NODE *name_put();		/* from names.c */
+void name_free();		/* from names.c */
+NAME_NODE *name_space_insert();	/* from names.c */
+int match_sub();		/* from match.c */
+NODE *instantiate();		/* from match.c */
+NODE *primitive_execute();	/* from primitive.c */
+int scan();			/* from scanner.c */
+
+#define MAXREPS 100
+#define MAXBATCH 30000	/* results kept per batch */
+
+static long batch = 10000;	/* operations per batch */
+static int reps = 7;		/* timed batches */
+static NODE **results;		/* results kept until batch is timed */
+
+static OP *plus_op, *times_op, *lplus_op, *ltimes_op;
+static NAME_NODE *rule_space;	/* name space of the synthetic rule */
+static NODE *head, *body;	/* the synthetic rule */
+static NODE *subject;		/* matches head */
+static NODE *big;		/* a larger expression, for expr_copy */
+static NAME_NODE *names;	/* a name space with many names */
+static NAME_NODE *locals;	/* rule space with local names */
+static NODE *sum;		/* 3 + 4, for addition_primitive */
+static short add_eval;		/* eval number of addition_primitive */
+
+/***********************************************************************
+ *
+ * Build expression nodes.
+ *
+ ***********************************************************************/
+static NODE *
+term(op, left, right)
+OP *op;
+NODE *left, *right;
+{
+TERM_NODE *t = (TERM_NODE *) node_new();
+t->op = op;
+t->label = (NAME_NODE *) NULL;
+t->left = left;
+t->right = right;
+return (NODE *) t;
+}
+
+static NODE *
+num(v)
+double v;
+{
+NUM_NODE *n = (NUM_NODE *) node_new();
+n->op = bert_ctx->pnum_prim;
+n->value = v;
+return (NODE *) n;
+}
+
+static NAME_NODE *
+space_new()
+{
+NAME_NODE *s = (NAME_NODE *) node_new();
+s->op = bert_ctx->undeclared_prim;
+s->next = s->parent = s->child = (NAME_NODE *) NULL;
+s->pval = NULL;
+s->value = (NODE *) NULL;
+s->refs = 1;
+s->domain = 0;
+s->edit = 0;
+s->uses = 0;
+return s;
+}
+
+/***********************************************************************
+ *
+ * Set up operators, the synthetic rule
+ *	((c'constant ** v) ++ r) + k'constant { (c ** v) ++ (k + r) }
+ * and the subjects it is used on.
+ *
+ ***********************************************************************/
+static void
+setup()
+{
+NODE *c, *v, *r, *k;
+char buf[32];
+int i;
+FILE *fp;
+
+ctx_select(ctx_new());
+plus_op = primitive("+", LEFT, (OP *) NULL, &bert_ctx->single_op, 0);
+times_op = primitive("*", LEFT, (OP *) NULL, &bert_ctx->single_op, 0);
+lplus_op = primitive("++", RIGHT, (OP *) NULL, &bert_ctx->double_op, 0);
+ltimes_op = primitive("**", NONASSOC, (OP *) NULL, &bert_ctx->double_op, 0);
+plus_op->precedence = 620;
+times_op->precedence = 640;
+lplus_op->precedence = 1010;
+ltimes_op->precedence = 1020;
+
+rule_space = space_new();
+c = name_put("c", rule_space, bert_ctx->constant_type);
+v = name_put("v", rule_space, bert_ctx->untyped_prim);
+r = name_put("r", rule_space, bert_ctx->untyped_prim);
+k = name_put("k", rule_space, bert_ctx->constant_type);
+head = term(plus_op, term(lplus_op, term(ltimes_op, c, v), r), k);
+body = term(lplus_op, term(ltimes_op, c, v), term(plus_op, k, r));
+
+/* subject: ((2 ** x) ++ ((3 ** y) ++ 5)) + 7 */
+names = space_new();
+subject = term(plus_op,
+    term(lplus_op, term(ltimes_op, num(2.0), name_put("x", names, bert_ctx->untyped_prim)),
+	term(lplus_op, term(ltimes_op, num(3.0),
+	    name_put("y", names, bert_ctx->untyped_prim)), num(5.0))),
+    num(7.0));
+
+/* a 64 term linear expression */
+big = num(1.0);
+for (i = 0; i < 64; i++) {
+    sprintf(buf, "v%d", i);
+    big = term(lplus_op, term(ltimes_op, num((double) i + 1),
+	name_put(buf, names, bert_ctx->untyped_prim)), big);
+    }
+
+/* a rule name space with eight local names, some qualified */
+locals = space_new();
+for (i = 0; i < 8; i++) {
+    sprintf(buf, "l%d", i);
+    c = name_put(buf, locals, bert_ctx->undeclared_prim);
+    if (i % 2) {
+	name_put("x", (NAME_NODE *) c, bert_ctx->undeclared_prim);
+	name_put("y", (NAME_NODE *) c, bert_ctx->undeclared_prim);
+	}
+    }
+
+sum = term(plus_op, num(3.0), num(4.0));
+for (c = (NODE *) bert_ctx->name_op; c; c = (NODE *) ((OP *) c)->next)
+    if (0 == strcmp(((OP *) c)->pname, "addition_primitive"))
+	add_eval = ((OP *) c)->eval;
+
+/* scanner input: 1000 lines of tokens */
+fp = tmpfile();
+if (!fp) error("cannot create scanner input file");
+for (i = 0; i < 1000; i++)
+    fprintf(fp, "x%d + 2.5 * y ++ 3 ** z .. comment\n", i);
+bert_ctx->infile = fp;
+bert_ctx->infilename = "scanner input";
+}
+
+/***********************************************************************
+ *
+ * The benchmarks.  Each runs n operations.
+ * Results that must be freed are kept in results[] and freed
+ * afterwards, outside of the timed region.
+ *
+ ***********************************************************************/
+static void
+b_match(n)
+long n;
+{
+while (n--) if (!match_sub(head, subject)) error("match failed");
+}
+
+static void
+b_instantiate(n)
+long n;
+{
+long i;
+match_sub(head, subject);	/* bind the parameters */
+for (i = 0; i < n; i++) results[i] = instantiate(body);
+}
+
+static void
+b_copy(n)
+long n;
+{
+long i;
+for (i = 0; i < n; i++) results[i] = expr_copy(big);
+}
+
+static void
+b_space(n)
+long n;
+{
+while (n--) name_free(name_space_insert(locals, (NAME_NODE *) NULL));
+}
+
+static void
+b_name_put(n)
+long n;
+{
+static char *which[] = { "v0", "v17", "v42", "v63", "x", "y" };
+NAME_NODE *nn;
+long i;
+for (i = 0; i < n; i++) {
+    nn = (NAME_NODE *) name_put(which[i % 6], names, bert_ctx->untyped_prim);
+    nn->refs--;		/* undo the reference */
+    }
+}
+
+static void
+b_scan(n)
+long n;
+{
+long i;
+for (i = 0; i < n; i++) {
+    if (EOF == scan()) {
+	rewind(bert_ctx->infile);
+	bert_ctx->lineno = 1;
+	}
+    }
+}
+
+static void
+b_primitive(n)
+long n;
+{
+long i;
+for (i = 0; i < n; i++) results[i] = primitive_execute(add_eval, sum);
+}
+
+struct bench {
+    char *name;
+    void (*run)();
+    int frees;		/* results[] must be freed */
+    } benches[] = {
+    { "match_sub",		b_match,	FALSE },
+    { "instantiate",		b_instantiate,	TRUE },
+    { "expr_copy",		b_copy,		TRUE },
+    { "name_space_insert",	b_space,	FALSE },
+    { "name_put",		b_name_put,	FALSE },
+    { "scan",			b_scan,		FALSE },
+    { "primitive_execute",	b_primitive,	TRUE },
+    { NULL, NULL, FALSE }
+    };
+
+static void
+release(b, n)
+struct bench *b;
+long n;
+{
+long i;
+if (b->frees) for (i = 0; i < n; i++) expr_free(results[i]);
+}
+
+static int
+compare(a, b)
+double *a, *b;
+{
+return (*a < *b) ? -1 : (*a > *b);
+}
+
+static void
+run(b)
+struct bench *b;
+{
+double t[MAXREPS], start;
+int i;
+
+(*b->run)(batch);		/* warmup */
+release(b, batch);
+for (i = 0; i < reps; i++) {
+    start = stats_clock();
+    (*b->run)(batch);
+    t[i] = (stats_clock() - start) * 1e9 / batch;
+    release(b, batch);
+    }
+qsort(t, reps, sizeof(double), compare);
+printf("%s\t%.1f\t%.1f\n", b->name, t[0], t[reps/2]);
+fflush(stdout);
+}
+
+int
+main(argc, argv)
+int argc;
+char *argv[];
+{
+struct bench *b;
+int argno, found;
+
+for (argno = 1; argno < argc && argv[argno][0] == '-'; argno++) {
+    if (0 == strcmp(argv[argno], "-r") && argno+1 < argc)
+	reps = atoi(argv[++argno]);
+    else if (0 == strcmp(argv[argno], "-n") && argno+1 < argc)
+	batch = atol(argv[++argno]);
+    else {
+	fprintf(stderr,
+	    "usage: micro [-r repetitions] [-n operations] [benchmark ...]\n");
+	return 1;
+	}
+    }
+if (reps < 1 || reps > MAXREPS || batch < 1 || batch > MAXBATCH) {
+    fprintf(stderr, "repetitions must be 1..%d, operations 1..%d\n",
+	MAXREPS, MAXBATCH);
+    return 1;
+    }
+results = (NODE **) malloc(batch * sizeof(NODE *));
+if (!results) error("out of memory");
+
+setup();
+printf("benchmark\tns/op min\tns/op median\n");
+for (b = benches; b->name; b++) {
+    if (argno < argc) {		/* only the named benchmarks */
+	int i;
+	for (found = FALSE, i = argno; i < argc; i++)
+	    if (0 == strcmp(argv[i], b->name)) found = TRUE;
+	if (!found) continue;
+	}
+    run(b);
+    }
+return 0;
+}
@@ -6,7 +6,6 @@
 
 #include "def.h"
 
-NAME_NODE *global_names;	/* root of global name space */
 
 /***********************************************************************
  *
@@ -27,7 +26,6 @@ char *name;		/* identifier name */
 NAME_NODE *space;	/* parent name space node */
 OP *type;		/* type field for this name */
 {
-extern OP *undeclared_prim;	/* from primitive.c */
 char *char_copy();		/* from util.c */
 NODE *node_new();		/* from expr.c */
 
@@ -56,8 +54,8 @@ while(curr) {
     val = strcmp(curr->pval, name);
     if (val == 0) {		/* name already exists */
 	curr->refs++;
-	if (curr->op == undeclared_prim) curr->op = type;
-	else if (type != undeclared_prim && curr->op != type) {
+	if (curr->op == bert_ctx->undeclared_prim) curr->op = type;
+	else if (type != bert_ctx->undeclared_prim && curr->op != type) {
 	    fprintf(stderr, "name: %s, types: %s & %s\n",
 		name, curr->op->pname, type->pname);
 	    error("name with two different types!");
@@ -81,7 +79,9 @@ nn->pval = char_copy(name);
 nn->refs = 2;		/* One reference to this name */
 			/* plus parent reference */
 nn->value = (NODE *) NULL;
-nn->interest = 0;	/* Of no interest, yet */
+nn->domain = 0;		/* no interval, yet */
+nn->edit = 0;
+nn->uses = 0;
 
 return((NODE *) nn);
 }
@@ -150,7 +150,6 @@ NAME_NODE *space;	/* name space to insert into */
 {
 NODE *node_new();		/* from expr.c */
 NODE *expr_copy();		/* from expr.c */
-extern OP *undeclared_prim;	/* from primitive.c */
 void name_print();		/* forward reference */
 register NAME_NODE *in, *sn;
 register NAME_NODE *pn = (NAME_NODE *) NULL;	/* previous */
@@ -168,7 +167,9 @@ if (!space) {	/* create dummy parent */
 /*  space->value = ins->value; */
     space->value = (NODE *) NULL;
     space->refs = 1;
-    space->interest = ins->interest;
+    space->domain = 0;
+    space->edit = 0;
+    space->uses = 0;
     }
 sn = space->child;
 
@@ -180,7 +181,7 @@ while (in) {	/* more nodes to insert */
 	sn = sn->next;
 	}
     else if (cmpval > 0) {	/* insert here */
-	if (in->op != undeclared_prim) {	/* parameter */
+	if (in->op != bert_ctx->undeclared_prim) {	/* parameter */
 	    if (in->value->op->arity & OP_NAME)	/* set value fields */
 		name_space_insert(in, in->value);
 	    }
@@ -196,7 +197,7 @@ while (in) {	/* more nodes to insert */
 	in = in->next;
 	}
     else {			/* name exists in both spaces */
-	if (in->op != undeclared_prim) {	/* parameter */
+	if (in->op != bert_ctx->undeclared_prim) {	/* parameter */
 	    if (sn->value) {
 		fprintf(stderr, "parameter: ");
 		name_print(in);
@@ -221,6 +222,32 @@ while (in) {	/* more nodes to insert */
 return space;
 }
 
+/***********************************************************************
+ *
+ * Take the names of a region (see ctx.c) back out of a name space.
+ * Names allocated in the region are unlinked (their memory goes
+ * with the region), and values bound to older names are dropped.
+ *
+ ******************************************************************/
+void
+name_space_release(space, r)
+NAME_NODE *space;
+REGION *r;
+{
+int node_in_region();		/* from expr.c */
+register NAME_NODE **pn;
+
+if (space->value && node_in_region(space->value, r))
+    space->value = (NODE *) NULL;
+for (pn = &space->child; *pn; ) {
+    if (node_in_region((NODE *) *pn, r)) *pn = (*pn)->next;
+    else {
+	name_space_release(*pn, r);
+	pn = &(*pn)->next;
+	}
+    }
+}
+
 /***********************************************************************
  *
  * Print out names.
@@ -235,9 +262,9 @@ NAME_NODE *qn;		/* a single qualified name */
 {
 if (qn->parent) {
     qname_print(qn->parent);
-    if (qn->parent->pval) fprintf(stderr, ".");
+    if (qn->parent->pval) fprintf(bert_ctx->out, ".");
     }
-if (qn->pval) fprintf(stderr, "%s", qn->pval);
+if (qn->pval) fprintf(bert_ctx->out, "%s", qn->pval);
 }
 
 void
@@ -245,7 +272,7 @@ name_print(fn)
 NAME_NODE *fn;	/* a full name */
 {
 qname_print(fn);
-if (fn->op->pname[0]) fprintf(stderr, "'%s", fn->op->pname);
+if (fn->op->pname[0]) fprintf(bert_ctx->out, "'%s", fn->op->pname);
 }
 
 name_space_print(ns)
@@ -254,16 +281,16 @@ NAME_NODE *ns;
 void expr_print();	/* from expr.c */
 register NAME_NODE *nn = ns;
 while(nn) {
-    if (nn->pval) fprintf(stderr, " %s", nn->pval);
-    if (nn->op->pname[0]) fprintf(stderr, "'%s", nn->op->pname);
+    if (nn->pval) fprintf(bert_ctx->out, " %s", nn->pval);
+    if (nn->op->pname[0]) fprintf(bert_ctx->out, "'%s", nn->op->pname);
     if (nn->value) {
-	fprintf(stderr, "=");
+	fprintf(bert_ctx->out, "=");
 	expr_print(nn->value);
 	}
     if (nn->child) {
-	fprintf(stderr, "(");
+	fprintf(bert_ctx->out, "(");
 	name_space_print(nn->child);
-	fprintf(stderr, ")");
+	fprintf(bert_ctx->out, ")");
 	}
     nn = nn->next;
     }
@@ -0,0 +1,611 @@
+/***********************************************************************
+ *
+ * Nonlinear equations, by Newton's method.
+ *
+ * The rules of beep solve linear equations, and a few nonlinear ones
+ * that can be turned into linear ones.  Others, like those of
+ * examples/nonlinear, are left in the answer.  Here, once no rule
+ * matches the subject any more (and simplex.c has nothing to do),
+ * the equations a = b of its top level ; chain whose sides are built
+ * of numbers, numvars, linear expressions of beep, and
+ *
+ *	a + b	a - b	a * b	a / b	a ^ b	- a
+ *	sin a	cos a	tan a	atan a
+ *
+ * are solved numerically, if there is one that is not linear:
+ *
+ *	- each equation is compiled into a tape, a list of steps that
+ *	  computes b - a from the values of the variables;
+ *	- the equations are split into sets that share no variables,
+ *	  and a set with as many equations as variables is solved by
+ *	  damped Newton iteration from 1 for each variable: the tape
+ *	  is run forward with the derivative of each step (forward
+ *	  mode automatic differentiation) for each variable of an
+ *	  equation, which gives the sparse rows of the Jacobian, and
+ *	  the step is found by the sparse elimination of linsolve.c;
+ *	  it is halved until the residual gets smaller;
+ *	- if the residual vanishes, and the Jacobian there is not
+ *	  singular, the variables are bound to the solution and the
+ *	  equations are replaced by true, and rewriting goes on;
+ *	- if a step could not be found because the Jacobian was
+ *	  singular, as it is at 1 for x*y = 1; x*x + y*y = 4, where
+ *	  both variables start alike, the set is tried again from
+ *	  values that differ from one variable to the next, up to
+ *	  STARTS times in all.
+ *
+ * A set with fewer equations than variables (such as the golden
+ * ratio in examples/nonlinear, which only fixes y/x) has many
+ * solutions, and is left alone, as is one that Newton's method does
+ * not solve.  Where there are several solutions, the one found is
+ * the one nearest to 1 in Newton's sense, not necessarily the one
+ * wanted: 1/z = z/2 gives the positive root.
+ *
+ ***********************************************************************/
+
+#include "def.h"
+#include <math.h>
+
+#define TOLERANCE	1e-12	/* residual taken as zero, relative */
+#define ITERATIONS	100	/* Newton steps before giving up */
+#define HALVINGS	30	/* times a step can be halved */
+#define STARTS		8	/* start points tried for a singular set */
+#define GOLDEN		0.6180339887498949	/* spreads the start values */
+
+/* from other modules */
+int lx_step();			/* from linsolve.c */
+int lx_order();			/* from lx.c */
+OP *op_find();			/* from ops.c */
+void lp_satisfied();		/* from simplex.c */
+void lp_bind();			/* from simplex.c */
+double stats_clock();		/* from stats.c */
+void free();
+
+/* steps of a tape */
+#define S_CONST	0	/* c */
+#define S_VAR	1	/* variable number var */
+#define S_ADD	2	/* a + b */
+#define S_SUB	3	/* a - b */
+#define S_MUL	4	/* a * b */
+#define S_DIV	5	/* a / b */
+#define S_POW	6	/* a ^ b */
+#define S_NEG	7	/* - a */
+#define S_SIN	8
+#define S_COS	9
+#define S_TAN	10
+#define S_ATAN	11
+
+typedef struct step {
+	int code;
+	int a, b;		/* steps that are its arguments */
+	int var;		/* variable, for S_VAR */
+	double c;		/* constant, for S_CONST */
+	} STEP;
+
+/* an equation: the steps from first to last compute b - a */
+typedef struct eqn {
+	NODE **at;		/* the conjunct it was made from */
+	int first, last;
+	int *vars;		/* its variables, in order */
+	int nvars;
+	int set;		/* set of equations it is in */
+	int linear;		/* only + - and constants times? */
+	} EQN;
+
+/* the operators of beep and bops it knows */
+typedef struct ops {
+	OP *equal, *semi, *plus, *times, *numvar;
+	OP *add, *sub, *mul, *div, *pow, *neg;
+	OP *sin, *cos, *tan, *atan;
+	} OPS;
+
+/* what is being built */
+typedef struct tape {
+	STEP *s;
+	int n, size;
+	NODE **vars;		/* variables */
+	int nv, vsize;
+	} TAPE;
+
+#define space(n)	mem_get((size_t) (n), "nonlinear equations")
+#define more(p, n)	mem_grow((void *) (p), (size_t) (n), "nonlinear equations")
+
+/***********************************************************************
+ *
+ * Compile an expression onto the end of the tape.
+ *
+ * returns:	its step, -1 if it cannot be compiled
+ *
+ ***********************************************************************/
+static int
+emit(tp, code, a, b)
+register TAPE *tp;
+int code, a, b;
+{
+if (tp->n == tp->size) {
+    tp->size = tp->size ? 2 * tp->size : 64;
+    tp->s = (STEP *) more((char *) tp->s, tp->size * sizeof(STEP));
+    }
+tp->s[tp->n].code = code;
+tp->s[tp->n].a = a;
+tp->s[tp->n].b = b;
+return tp->n++;
+}
+
+/* the number of a variable, added if it is new */
+static int
+variable(tp, v)
+register TAPE *tp;
+NODE *v;
+{
+register int i;
+
+for (i = tp->nv - 1; i >= 0; i--)	/* most likely recent */
+    if (tp->vars[i] == v) return i;
+if (tp->nv == tp->vsize) {
+    tp->vsize = tp->vsize ? 2 * tp->vsize : 16;
+    tp->vars = (NODE **) more((char *) tp->vars, tp->vsize * sizeof(NODE *));
+    }
+tp->vars[tp->nv] = v;
+return tp->nv++;
+}
+
+static int
+compile(tp, ex, ops, linear)
+register TAPE *tp;
+register NODE *ex;
+register OPS *ops;
+int *linear;		/* set to FALSE if it is not linear */
+{
+register TERM_NODE *tn = (TERM_NODE *) ex;
+register OP *op = ex->op;
+int a, b, s, code;
+
+if (op->arity & OP_NUM) {
+    s = emit(tp, S_CONST, -1, -1);
+    tp->s[s].c = ((NUM_NODE *) ex)->value;
+    return s;
+    }
+if (op->arity & OP_NAME) {
+    if (op != ops->numvar || ((NAME_NODE *) ex)->value) return -1;
+    s = emit(tp, S_VAR, -1, -1);
+    tp->s[s].var = variable(tp, ex);
+    return s;
+    }
+if ((op->arity & BINARY) == BINARY) {
+    if (op == ops->add || op == ops->plus) code = S_ADD;
+    else if (op == ops->sub) code = S_SUB;
+    else if (op == ops->mul || op == ops->times) code = S_MUL;
+    else if (op == ops->div) code = S_DIV;
+    else if (op == ops->pow) code = S_POW;
+    else return -1;
+    if (0 > (a = compile(tp, tn->left, ops, linear))) return -1;
+    if (0 > (b = compile(tp, tn->right, ops, linear))) return -1;
+    if (code == S_DIV || code == S_POW ||
+      (code == S_MUL && tp->s[a].code != S_CONST &&
+      tp->s[b].code != S_CONST))
+	*linear = FALSE;
+    return emit(tp, code, a, b);
+    }
+if (op->arity == PREFIX) {
+    if (op == ops->neg) code = S_NEG;
+    else if (op == ops->sin) code = S_SIN;
+    else if (op == ops->cos) code = S_COS;
+    else if (op == ops->tan) code = S_TAN;
+    else if (op == ops->atan) code = S_ATAN;
+    else return -1;
+    if (0 > (a = compile(tp, tn->right, ops, linear))) return -1;
+    if (code != S_NEG) *linear = FALSE;
+    return emit(tp, code, a, -1);
+    }
+return -1;
+}
+
+/***********************************************************************
+ *
+ * Run the steps of an equation, with the derivative of each by one
+ * of the variables (wrt), or none if wrt is -1.
+ *
+ * returns:	its residual, and the derivative in *dr
+ *
+ ***********************************************************************/
+static double
+run(s, e, x, v, d, wrt, dr)
+STEP *s;		/* the tape */
+EQN *e;
+double *x;		/* value of each variable */
+double *v, *d;		/* room for the value and derivative of each step */
+int wrt;
+double *dr;
+{
+register int i;
+register STEP *p;
+double a, b, da, db;
+
+for (i = e->first; i <= e->last; i++) {
+    p = &s[i];
+    a = (p->a >= 0) ? v[p->a] : 0.0;
+    b = (p->b >= 0) ? v[p->b] : 0.0;
+    da = (p->a >= 0) ? d[p->a] : 0.0;
+    db = (p->b >= 0) ? d[p->b] : 0.0;
+    switch (p->code) {
+     case S_CONST:	v[i] = p->c;	d[i] = 0.0;			break;
+     case S_VAR:	v[i] = x[p->var]; d[i] = (p->var == wrt);	break;
+     case S_ADD:	v[i] = a + b;	d[i] = da + db;			break;
+     case S_SUB:	v[i] = a - b;	d[i] = da - db;			break;
+     case S_MUL:	v[i] = a * b;	d[i] = da * b + a * db;		break;
+     case S_DIV:
+	v[i] = a / b;
+	d[i] = (da - v[i] * db) / b;
+	break;
+     case S_POW:
+	v[i] = pow(a, b);
+	if (db == 0.0) d[i] = (da == 0.0) ? 0.0 : b * pow(a, b - 1.0) * da;
+	else d[i] = v[i] * (db * log(a) + b * da / a);
+	break;
+     case S_NEG:	v[i] = -a;	d[i] = -da;			break;
+     case S_SIN:	v[i] = sin(a);	d[i] = cos(a) * da;		break;
+     case S_COS:	v[i] = cos(a);	d[i] = -sin(a) * da;		break;
+     case S_TAN:
+	v[i] = tan(a);
+	d[i] = (1.0 + v[i] * v[i]) * da;
+	break;
+     case S_ATAN:	v[i] = atan(a);	d[i] = da / (1.0 + a * a);	break;
+     }
+    }
+*dr = d[e->last];
+return v[e->last];
+}
+
+/* the largest residual of a set, HUGE_VAL if one is not a number */
+static double
+residual(s, eqs, neqs, set, x, v, d, r)
+STEP *s;
+EQN *eqs;
+int neqs, set;
+double *x, *v, *d;
+double *r;		/* residual of each equation */
+{
+register EQN *e;
+double most = 0.0, dr;
+
+for (e = eqs; e < eqs + neqs; e++) {
+    if (e->set != set) continue;
+    r[e - eqs] = run(s, e, x, v, d, -1, &dr);
+    if (r[e - eqs] != r[e - eqs]) return HUGE_VAL;	/* NaN */
+    if (fabs(r[e - eqs]) > most) most = fabs(r[e - eqs]);
+    }
+return most;
+}
+
+/***********************************************************************
+ *
+ * Solve a set of equations.
+ *
+ * returns:	TRUE if it was solved, with the solution in x,
+ *		-1 if not, and the Jacobian was singular on the way
+ *
+ ***********************************************************************/
+static int
+solve(tp, eqs, neqs, set, x)
+TAPE *tp;
+EQN *eqs;
+int neqs, set;
+double *x;		/* values of all the variables, 1 to start */
+{
+register EQN *e;
+register int i, j;
+int nrows = 0, nvars = 0, iter, half, npiv = -1, done = FALSE;
+int singular = FALSE;
+double *v, *d, *r, *dx, *xt, *k, norm, next, dr;
+LX_TERM **t;
+int *n;
+
+for (e = eqs; e < eqs + neqs; e++)
+    if (e->set == set) {
+	nrows++;
+	nvars += e->nvars;
+	}
+v = (double *) space(tp->n * sizeof(double));
+d = (double *) space(tp->n * sizeof(double));
+r = (double *) space(neqs * sizeof(double));
+dx = (double *) space(tp->nv * sizeof(double));
+xt = (double *) space(tp->nv * sizeof(double));
+k = (double *) space(nrows * sizeof(double));
+n = (int *) space(nrows * sizeof(int));
+t = (LX_TERM **) space(nrows * sizeof(LX_TERM *));
+for (i = 0, e = eqs; e < eqs + neqs; e++)
+    if (e->set == set) t[i++] = (LX_TERM *) space(e->nvars * sizeof(LX_TERM));
+for (j = 0; j < tp->nv; j++) dx[j] = 0.0;	/* of the other sets too */
+
+norm = residual(tp->s, eqs, neqs, set, x, v, d, r);
+for (iter = 0; iter < ITERATIONS && norm != HUGE_VAL; iter++) {
+    /* the Jacobian, a row of (variable, derivative) for each equation */
+    for (i = 0, e = eqs; e < eqs + neqs; e++) {
+	if (e->set != set) continue;
+	for (n[i] = j = 0; j < e->nvars; j++) {
+	    run(tp->s, e, x, v, d, e->vars[j], &dr);
+	    if (dr == 0.0) continue;
+	    t[i][n[i]].var = tp->vars[e->vars[j]];
+	    t[i][n[i]].coef = dr;
+	    t[i][n[i]++].seq = e->vars[j];
+	    }
+	k[i++] = r[e - eqs];
+	}
+    if (done) break;	/* the Jacobian at the solution */
+
+    /* the step, J dx + r = 0, and as much of it as makes r smaller */
+    for (e = eqs; e < eqs + neqs; e++)
+	if (e->set == set)
+	    for (j = 0; j < e->nvars; j++) dx[e->vars[j]] = 0.0;
+    if (nrows > (npiv = lx_step(t, n, k, nrows, dx))) singular = TRUE;
+    if (0 > npiv) break;
+    for (half = 0; half < HALVINGS; half++) {
+	for (j = 0; j < tp->nv; j++) xt[j] = x[j] + dx[j];
+	next = residual(tp->s, eqs, neqs, set, xt, v, d, r);
+	if (next < norm || next == 0.0) break;
+	for (j = 0; j < tp->nv; j++) dx[j] *= 0.5;
+	}
+    if (half == HALVINGS) break;
+    for (j = 0; j < tp->nv; j++) x[j] = xt[j];
+    norm = next;
+
+    /* small enough for the values that went into it? */
+    for (next = 1.0, i = 0; i < tp->n; i++)
+	if (tp->s[i].code == S_CONST && fabs(tp->s[i].c) > next)
+	    next = fabs(tp->s[i].c);
+    for (j = 0; j < tp->nv; j++)
+	if (fabs(x[j]) > next) next = fabs(x[j]);
+    if (norm <= TOLERANCE * next) done = TRUE;
+    }
+/* solved, and the solution is not one of many */
+if (done) {
+    for (j = 0; j < tp->nv; j++) dx[j] = 0.0;
+    npiv = lx_step(t, n, k, nrows, dx);
+    }
+
+for (i = 0; i < nrows; i++) free((char *) t[i]);
+free((char *) t);
+free((char *) n);
+free((char *) k);
+free((char *) xt);
+free((char *) dx);
+free((char *) r);
+free((char *) d);
+free((char *) v);
+if (done && npiv == nrows) return TRUE;
+return singular || done ? -1 : FALSE;
+}
+
+/***********************************************************************
+ *
+ * Start the variables of a set for a try: at 1 for the first, then
+ * at values that differ from one variable to the next, and in size
+ * and sign from one try to the next.
+ *
+ ***********************************************************************/
+static void
+start_at(eqs, neqs, set, x, try)
+EQN *eqs;
+int neqs, set;
+double *x;
+int try;		/* 0 for the first */
+{
+static double scale[] = { 1.0, -1.0, 2.0, -2.0, 0.5, -0.5, 4.0 };
+register EQN *e;
+register int a;
+double f;
+
+for (e = eqs; e < eqs + neqs; e++)
+    if (e->set == set)
+	for (a = 0; a < e->nvars; a++) {
+	    if (!try) {
+		x[e->vars[a]] = 1.0;
+		continue;
+		}
+	    f = (e->vars[a] + 1) * GOLDEN;
+	    x[e->vars[a]] = scale[(try - 1) % 7] * (1.0 + f - floor(f));
+	    }
+}
+
+/***********************************************************************
+ *
+ * The sets of equations that share variables, by union-find over
+ * the variables.
+ *
+ ***********************************************************************/
+static int
+root(up, i)
+register int *up;
+register int i;
+{
+while (up[i] != i) i = up[i] = up[up[i]];	/* halving */
+return i;
+}
+
+static void
+sets(eqs, neqs, nv)
+EQN *eqs;
+int neqs, nv;
+{
+int *up = (int *) space(nv * sizeof(int));
+register EQN *e;
+register int j;
+
+for (j = 0; j < nv; j++) up[j] = j;
+for (e = eqs; e < eqs + neqs; e++)
+    for (j = 1; j < e->nvars; j++)
+	up[root(up, e->vars[j])] = root(up, e->vars[0]);
+for (e = eqs; e < eqs + neqs; e++)
+    e->set = e->nvars ? root(up, e->vars[0]) : -1;
+free((char *) up);
+}
+
+/* the variables of an equation, sorted by lx_order */
+static void
+vars_of(tp, e)
+register TAPE *tp;
+register EQN *e;
+{
+register int i, j, v;
+
+e->vars = (int *) space((e->last - e->first + 1) * sizeof(int));
+e->nvars = 0;
+for (i = e->first; i <= e->last; i++) {
+    if (tp->s[i].code != S_VAR) continue;
+    v = tp->s[i].var;
+    for (j = e->nvars; j > 0; j--) {	/* insertion */
+	int c = lx_order((NAME_NODE *) tp->vars[v],
+	    (NAME_NODE *) tp->vars[e->vars[j - 1]]);
+	if (c >= 0) break;
+	e->vars[j] = e->vars[j - 1];
+	}
+    if (j > 0 && e->vars[j - 1] == v) {		/* already there */
+	for (; j < e->nvars; j++) e->vars[j] = e->vars[j + 1];
+	continue;
+	}
+    e->vars[j] = v;
+    e->nvars++;
+    }
+}
+
+/***********************************************************************
+ *
+ * Solve the nonlinear equations of the subject.
+ *
+ * returns:	TRUE if the subject was changed
+ *
+ ***********************************************************************/
+int
+newton()
+{
+register BERT_CTX *ctx = bert_ctx;
+register EQN *e;
+OPS ops;
+TAPE tp;
+EQN *eqs;
+NODE **at, *x, **bound;
+double *val, *xv, start;
+int *neq, *nvar, *nonlinear, *solved;
+int neqs = 0, size = 16, a, b, first, j, nb, linear, any = FALSE;
+
+if (!ctx->subject || (ctx->nedits && !ctx->solved)) return FALSE;
+ops.equal = op_find(ctx->single_op, "=", BINARY);
+ops.semi = op_find(ctx->single_op, ";", BINARY);
+ops.numvar = op_find(ctx->type_op, "numvar", 0);
+if (!ops.equal || !ops.semi || !ops.numvar) return FALSE;
+ops.plus = op_find(ctx->double_op, "++", BINARY);
+ops.times = op_find(ctx->double_op, "**", BINARY);
+ops.add = op_find(ctx->single_op, "+", BINARY);
+ops.sub = op_find(ctx->single_op, "-", BINARY);
+ops.mul = op_find(ctx->single_op, "*", BINARY);
+ops.div = op_find(ctx->single_op, "/", BINARY);
+ops.pow = op_find(ctx->single_op, "^", BINARY);
+ops.neg = op_find(ctx->single_op, "-", PREFIX);
+ops.sin = op_find(ctx->name_op, "sin", PREFIX);
+ops.cos = op_find(ctx->name_op, "cos", PREFIX);
+ops.tan = op_find(ctx->name_op, "tan", PREFIX);
+ops.atan = op_find(ctx->name_op, "atan", PREFIX);
+
+/* compile the equations of the chain */
+start = stats_clock();
+tp.s = (STEP *) NULL;
+tp.vars = (NODE **) NULL;
+tp.n = tp.size = tp.nv = tp.vsize = 0;
+eqs = (EQN *) space(size * sizeof(EQN));
+for (at = &ctx->subject; ; at = &((TERM_NODE *) *at)->right) {
+    NODE **conj = ((*at)->op == ops.semi) ? &((TERM_NODE *) *at)->left : at;
+    x = *conj;
+    if (x->op == ctx->false_op) break;
+    if (x->op == ops.equal) {
+	first = tp.n;
+	linear = TRUE;
+	if (0 <= (a = compile(&tp, ((TERM_NODE *) x)->left, &ops, &linear)) &&
+	  0 <= (b = compile(&tp, ((TERM_NODE *) x)->right, &ops, &linear))) {
+	    if (neqs == size)
+		eqs = (EQN *) more((char *) eqs, (size *= 2) * sizeof(EQN));
+	    e = &eqs[neqs++];
+	    e->at = conj;
+	    e->first = first;
+	    e->last = emit(&tp, S_SUB, b, a);
+	    e->linear = linear;
+	    if (!linear) any = TRUE;
+	    }
+	else tp.n = first;
+	}
+    if ((*at)->op != ops.semi) break;
+    }
+if (x->op == ctx->false_op || !any) {
+    free((char *) tp.s);
+    free((char *) tp.vars);
+    free((char *) eqs);
+    return FALSE;
+    }
+
+/* the sets with as many equations as variables, and one not linear */
+for (e = eqs; e < eqs + neqs; e++) vars_of(&tp, e);
+sets(eqs, neqs, tp.nv);
+neq = (int *) space(tp.nv * sizeof(int));
+nvar = (int *) space(tp.nv * sizeof(int));
+nonlinear = (int *) space(tp.nv * sizeof(int));
+solved = (int *) space(tp.nv * sizeof(int));
+for (j = 0; j < tp.nv; j++) neq[j] = nvar[j] = nonlinear[j] = solved[j] = 0;
+for (e = eqs; e < eqs + neqs; e++)
+    if (e->set >= 0) {
+	neq[e->set]++;
+	if (!e->linear) nonlinear[e->set] = TRUE;
+	}
+xv = (double *) space(tp.nv * sizeof(double));
+for (j = 0; j < tp.nv; j++) xv[j] = 1.0;
+for (e = eqs; e < eqs + neqs; e++)	/* count each variable once */
+    if (e->set >= 0)
+	for (a = 0; a < e->nvars; a++)
+	    if (xv[e->vars[a]] == 1.0) {
+		xv[e->vars[a]] = 0.0;
+		nvar[e->set]++;
+		}
+for (j = 0; j < tp.nv; j++) xv[j] = 1.0;
+
+for (j = nb = 0; j < tp.nv; j++) {
+    if (!nonlinear[j] || neq[j] != nvar[j]) continue;
+    ctx->stats.newton++;
+    for (a = 0; a < STARTS; a++) {
+	start_at(eqs, neqs, j, xv, a);
+	if (0 <= (solved[j] = solve(&tp, eqs, neqs, j, xv))) break;
+	}
+    if (solved[j] < 0) solved[j] = FALSE;
+    if (solved[j]) nb += nvar[j];
+    }
+
+/* bind the variables of the sets that were solved */
+if (nb) {
+    bound = (NODE **) space(nb * sizeof(NODE *));
+    val = (double *) space(nb * sizeof(double));
+    for (j = 0; j < tp.nv; j++) neq[j] = FALSE;		/* bound yet? */
+    nb = 0;
+    for (e = eqs; e < eqs + neqs; e++) {
+	if (e->set < 0 || !solved[e->set]) continue;
+	lp_satisfied(e->at);
+	for (a = 0; a < e->nvars; a++)
+	    if (!neq[j = e->vars[a]]) {
+		neq[j] = TRUE;
+		bound[nb] = tp.vars[j];
+		val[nb++] = xv[j];
+		}
+	}
+    lp_bind(bound, val, nb);
+    free((char *) val);
+    free((char *) bound);
+    }
+
+for (e = eqs; e < eqs + neqs; e++) free((char *) e->vars);
+free((char *) xv);
+free((char *) solved);
+free((char *) nonlinear);
+free((char *) nvar);
+free((char *) neq);
+free((char *) eqs);
+free((char *) tp.vars);
+free((char *) tp.s);
+ctx->stats.newton_time += stats_clock() - start;
+return nb > 0;
+}
@@ -4,24 +4,25 @@
  *
  * Entry points are "op_new" to allocate an operator node,
  * and "op_mem_free" to free all operator memory.
+ * "op_mark" and "op_release" take the operators and rules of
+ * a region (see ctx.c) back out again, and "op_rules_apply" visits
+ * every rule.
  * Other entry points are for debugging.
  *
  ********************************************************************/
 
 #include "def.h"
 
-/* linked lists that hold operators definitions */
-OP *single_op = NULL;	/* list of single-character operators */
-OP *double_op = NULL;	/* list of double-character operators */
-OP *name_op = NULL;	/* list of alphanumeric operators */
-OP *type_op = NULL;	/* list of types */
-
 #define OP_BYTES 1024	/* number of operator bytes to allocate */
-static char *op_mem = NULL;		/* operator memory */
-static int free_byte = OP_BYTES;	/* next free byte */
 
 /* VERY MACHINE DEPENDENT */
-#define ALIGN 4		/* align op nodes on 4 byte boundaries */
+#define ALIGN (sizeof(char *))	/* align op nodes for their pointers */
+
+/* Each block of operator memory begins with a header holding a
+   pointer to the previous block, and the number of bytes of that
+   block that are in use (filled in when the block fills up). */
+#define OP_HEAD (2 * sizeof(char *))	/* size of header */
+#define HEAD_USED (sizeof(char *) / sizeof(int))	/* index of count */
 
 /********************************************************************
  *
@@ -51,20 +52,29 @@ printf("allocating operator node of %d bytes\n", asize);
 fflush(stdout);
 #endif
 
-if (asize > OP_BYTES - free_byte) {
-    char *old_op_mem = op_mem;
-    op_mem = malloc(OP_BYTES); 
-    if (!op_mem) error("out of memory");
-    ((char **) op_mem)[0] = old_op_mem;	/* first word points to old memory */
-    free_byte = sizeof(char *);		/* skip first word */
+if (!bert_ctx->op_mem || asize > OP_BYTES - bert_ctx->free_byte) {
+    char *old_op_mem = bert_ctx->op_mem;
+    if (old_op_mem) ((int *) old_op_mem)[HEAD_USED] = bert_ctx->free_byte;
+    bert_ctx->op_mem = malloc(OP_BYTES); 
+    if (!bert_ctx->op_mem) error("out of memory");
+    ((char **) bert_ctx->op_mem)[0] = old_op_mem;	/* first word points to old memory */
+    bert_ctx->free_byte = OP_HEAD;		/* skip header */
+    bert_ctx->stats.op_bytes += OP_BYTES;
+    bert_ctx->stats.op_used += OP_HEAD;
 #   ifdef DEBUG
     printf("allocated operator node memory\n");
 #   endif
     }
-op = (OP *) (op_mem + free_byte);
-free_byte += asize;
+op = (OP *) (bert_ctx->op_mem + bert_ctx->free_byte);
+bert_ctx->free_byte += asize;
+bert_ctx->stats.op_used += asize;
 op->length = (unsigned char) pl;
+op->next = (OP *) NULL;
+op->arity = 0;
+op->precedence = 0;
 op->eval = 0;
+op->strategy = 0;
+op->ac = 0;
 op->hash = (RULE *) NULL;
 op->super = (OP *) NULL;
 op->other = (OP *) NULL;
@@ -85,33 +95,189 @@ char *next_op_mem;
 void rule_free();	/* from rules.c */
 void free();
 int asize;
+int used = bert_ctx->free_byte;	/* bytes in use in this block */
 
 register int fpos;
-register RULE *rr;
+register RULE *rr, *nr;
 
-while (op_mem) {
-    next_op_mem = *((char **) op_mem);
-    fpos = sizeof(char *);
-    while (fpos<free_byte) {
-	rr = ((OP *)(op_mem+fpos))->hash;
+while (bert_ctx->op_mem) {
+    next_op_mem = *((char **) bert_ctx->op_mem);
+    fpos = OP_HEAD;
+    while (fpos<used) {
+	rr = ((OP *)(bert_ctx->op_mem+fpos))->hash;
 	while(rr) {
+	    nr = rr->next;
 	    rule_free(rr);
-	    rr = rr->next;
+	    rr = nr;
 	    }
-	asize = sizeof(OP) + ((OP *)(op_mem+fpos))->length;
+	asize = sizeof(OP) + ((OP *)(bert_ctx->op_mem+fpos))->length;
 	if ((asize % ALIGN) != 0) asize += ALIGN - (asize % ALIGN);
 	fpos += asize;
 	}
-    free(op_mem);
-    op_mem = next_op_mem;
+    free(bert_ctx->op_mem);
+    bert_ctx->op_mem = next_op_mem;
+    if (next_op_mem) used = ((int *) next_op_mem)[HEAD_USED];
     }
-free_byte = OP_BYTES;	/* to indicate no memory allocated */
-single_op = NULL;	/* no single-character operators */
-double_op = NULL;	/* no double-character operators */
-name_op = NULL;		/* no alphanumeric operators */
-type_op = NULL;		/* no types */
+bert_ctx->stats.op_bytes = bert_ctx->stats.op_used = 0;
+bert_ctx->single_op = NULL;	/* no single-character operators */
+bert_ctx->double_op = NULL;	/* no double-character operators */
+bert_ctx->name_op = NULL;		/* no alphanumeric operators */
+bert_ctx->type_op = NULL;		/* no types */
 }
 
+/********************************************************************
+ *
+ * Operator memory for regions (see ctx.c).
+ *
+ * A region's operators are the ones allocated after the mark.
+ * Its rules are the ones of its load level or higher, which may
+ * also hang off of older operators.
+ *
+ ********************************************************************/
+void
+op_mark(r)
+REGION *r;
+{
+r->op_mem = bert_ctx->op_mem;
+r->free_byte = bert_ctx->free_byte;
+r->op_used = bert_ctx->stats.op_used;
+r->op_bytes = bert_ctx->stats.op_bytes;
+}
+
+/* bytes in use in block of operator memory */
+static int
+op_block_used(block)
+char *block;
+{
+if (block == bert_ctx->op_mem) return bert_ctx->free_byte;
+return ((int *) block)[HEAD_USED];
+}
+
+/* was op allocated before region r was marked? */
+static int
+op_old(op, r)
+OP *op;
+REGION *r;
+{
+register char *block;
+register char *p = (char *) op;
+
+for (block = r->op_mem; block; block = *((char **) block)) {
+    if (p >= block + OP_HEAD &&
+      p < block + (block == r->op_mem ? r->free_byte : op_block_used(block)))
+	return TRUE;
+    }
+return FALSE;
+}
+
+/* free rules of operators from fpos to used in block */
+static void
+op_rules_free(block, fpos, used, level)
+char *block;
+int fpos, used;
+int level;		/* free rules of this level or higher, 0 for all */
+{
+void rule_free();	/* from rules.c */
+register RULE *rr, **pr;
+register OP *op;
+int asize;
+
+while (fpos < used) {
+    op = (OP *) (block + fpos);
+    for (pr = &op->hash; (rr = *pr); ) {
+	if (rr->level >= level) {
+	    *pr = rr->next;
+	    rule_free(rr);
+	    }
+	else pr = &rr->next;
+	}
+    asize = sizeof(OP) + op->length;
+    if ((asize % ALIGN) != 0) asize += ALIGN - (asize % ALIGN);
+    fpos += asize;
+    }
+}
+
+/* remove operators of region r from an operator list */
+static void
+op_list_release(list, r)
+OP **list;
+REGION *r;
+{
+while (*list) {
+    if (op_old(*list, r)) list = &(*list)->next;
+    else *list = (*list)->next;
+    }
+}
+
+void
+op_release(r)
+REGION *r;
+{
+void free();
+register char *block, *next;
+register OP *op;
+int fpos, used, asize;
+
+/* unlink new operators, while their memory is still there */
+op_list_release(&bert_ctx->single_op, r);
+op_list_release(&bert_ctx->double_op, r);
+op_list_release(&bert_ctx->name_op, r);
+op_list_release(&bert_ctx->type_op, r);
+
+/* free blocks allocated in the region, and rules of their operators */
+while (bert_ctx->op_mem != r->op_mem) {
+    block = bert_ctx->op_mem;
+    next = *((char **) block);
+    op_rules_free(block, OP_HEAD, op_block_used(block), 0);
+    free(block);
+    bert_ctx->op_mem = next;
+    if (next) bert_ctx->free_byte = ((int *) next)[HEAD_USED];
+    }
+if (!bert_ctx->op_mem) return;
+op_rules_free(bert_ctx->op_mem, r->free_byte, bert_ctx->free_byte, 0);
+bert_ctx->free_byte = r->free_byte;
+bert_ctx->stats.op_used = r->op_used;
+bert_ctx->stats.op_bytes = r->op_bytes;
+
+/* remove new rules and links to new operators from old operators */
+for (block = bert_ctx->op_mem; block; block = *((char **) block)) {
+    used = op_block_used(block);
+    op_rules_free(block, OP_HEAD, used, r->level);
+    for (fpos = OP_HEAD; fpos < used; fpos += asize) {
+	op = (OP *) (block + fpos);
+	if (op->other && !op_old(op->other, r)) op->other = (OP *) NULL;
+	if (op->super && !op_old(op->super, r)) op->super = (OP *) NULL;
+	asize = sizeof(OP) + op->length;
+	if ((asize % ALIGN) != 0) asize += ALIGN - (asize % ALIGN);
+	}
+    }
+}
+
+/********************************************************************
+ *
+ * Call a function on every rule of every operator.
+ *
+ ********************************************************************/
+void
+op_rules_apply(fn)
+void (*fn)();		/* called with each rule */
+{
+register char *block;
+register OP *op;
+register RULE *rr;
+int fpos, used, asize;
+
+for (block = bert_ctx->op_mem; block; block = *((char **) block)) {
+    used = op_block_used(block);
+    for (fpos = OP_HEAD; fpos < used; fpos += asize) {
+	op = (OP *) (block + fpos);
+	for (rr = op->hash; rr; rr = rr->next) (*fn)(rr);
+	asize = sizeof(OP) + op->length;
+	if ((asize % ALIGN) != 0) asize += ALIGN - (asize % ALIGN);
+	}
+    }
+}
+
 /********************************************************************
  *
  * Depending on the type of operator, insert node into appropriate 
@@ -223,6 +389,34 @@ op->next = NULL;
  *
  ********************************************************************/
 
+/********************************************************************
+ *
+ * Find an operator by name, for the modules that work on the terms
+ * the libraries build (simplex.c, newton.c).
+ *
+ * entry:	list to look in, name, and arity (BINARY or PREFIX),
+ *		or 0 for a type.
+ *
+ * exit:	the operator, NULL if it is not defined.
+ *
+ ********************************************************************/
+OP *
+op_find(list, name, arity)
+OP *list;
+char *name;
+int arity;
+{
+register OP *op;
+
+for (op = list; op; op = op->next)
+    if (0 == strcmp(op->pname, name)) {
+	if (!arity) return op;
+	if ((op->arity & arity) == arity) return op;
+	if (op->other && (op->other->arity & arity) == arity) return op->other;
+	}
+return (OP *) NULL;
+}
+
 /********************************************************************
  *
  * Format an arity field for printing.
@@ -237,7 +431,7 @@ char *
 arity_name(arity)
 short arity;
 {
-static char buf[80];
+static CTX_LOCAL char buf[80];
 
 switch(arity) {
  case NONASSOC:	return("binary nonassociative");
@@ -296,17 +490,17 @@ ops_print()
 
     /* Print single_op list */
     fprintf(stderr, "\nsingle special character operators:\n\n");
-    op_list_print(single_op);
+    op_list_print(bert_ctx->single_op);
 
     /* Print double_op list */
     fprintf(stderr, "\ndouble special character operators:\n\n");
-    op_list_print(double_op);
+    op_list_print(bert_ctx->double_op);
 
     /* Print name_op list */
     fprintf(stderr, "\nalphanumeric operators:\n\n");
-    op_list_print(name_op);
+    op_list_print(bert_ctx->name_op);
 
     /* Print list of types */
     fprintf(stderr, "\ntypes (missing single quotes):\n\n");
-    op_list_print(type_op);
+    op_list_print(bert_ctx->type_op);
     }		/* end of ops_print */
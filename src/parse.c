@@ -14,16 +14,8 @@
 #define HEAD	   501		/* head of rule */
 #define BODY	   502		/* body of rule */
 
-static SNODE *pstack = NULL;		/* (top of) parse stack */
 
-static NODE *boe;		/* beginning of expression */
 
-static int next_token;		/* next token (for lookahead) */
-static int token;		/* token identifier returned from scanner.c */
-extern double token_val;	/* numeric value of token, from scanner.c */
-extern char token_prval[];	/* print value of token, from scanner.c */
-extern OP *token_op;		/* oper ptr from scanner.c */
-static NAME_NODE *rule_names = NULL;	/* local names for this rule */
 
 /***********************************************************************
  *
@@ -66,16 +58,14 @@ void
 reduce(rop)
 register SNODE *rop;	/* operator (on parse stack) to be reduced */
 {
-extern OP *undeclared_prim;	/* from primitive.c */
 char *arity_name();		/* from ops.c */
 void st_free();			/* from util.c */
-extern int label_count;		/* from rules.c */
 
 SNODE *q;			/* temp parse stack pointer */
 
 #ifdef DEBUG
 fprintf(stderr, "reducing operator: %s, parse stack:\n", rop->node->op->pname);
-ps_print(pstack);
+ps_print(bert_ctx->pstack);
 #endif
 
 /* handle special parser reduce functions */
@@ -90,11 +80,11 @@ if (rop->node->op->eval < 0) {
 		rop->node->op->pname, arity_name(rop->node->op->arity));
 	    error("special reduce function 1 requires unary operator");
 	    }
-	if (rop == pstack || pstack->info != EXPR_TYPE) {
+	if (rop == bert_ctx->pstack || bert_ctx->pstack->info != EXPR_TYPE) {
   	    fprintf(stderr, "unary operator: %s\n", rop->node->op->pname);
 	    error("unary operator has no argument");
 	    }
-	pstack->next = pstack->next->next;	/* delete rop */
+	bert_ctx->pstack->next = bert_ctx->pstack->next->next;	/* delete rop */
 	st_free(rop);
 	break;
      case 2:	/* label operator, typically for ":" */
@@ -103,7 +93,7 @@ if (rop->node->op->eval < 0) {
 		rop->node->op->pname, arity_name(rop->node->op->arity));
 	    error("special label operator must be binary operator");
 	    }
-	if (rop == pstack || pstack->info != EXPR_TYPE) {
+	if (rop == bert_ctx->pstack || bert_ctx->pstack->info != EXPR_TYPE) {
 	    fprintf(stderr, "binary operator: %s\n", rop->node->op->pname);
 	    error("binary operator has no right argument");
 	    }
@@ -117,27 +107,27 @@ if (rop->node->op->eval < 0) {
 		arity_name(rop->next->node->op->arity));
 	    error("special label operator requires name for left argument");
 	    }
-	if (rop->next->node->op != undeclared_prim) {
+	if (rop->next->node->op != bert_ctx->undeclared_prim) {
 	    fprintf(stderr, "parameter: %s\n",
 		((NAME_NODE *)rop->next->node)->pval);
 	    error("parameter may not be used as a label name");
 	    }
-	if (!(pstack->node->op->arity & OP_TERM)) {
+	if (!(bert_ctx->pstack->node->op->arity & OP_TERM)) {
 	    fprintf(stderr, "right argument is: %s, of type: %s\n",
-		arity_name(pstack->node->op->arity),  pstack->node->op->pname);
+		arity_name(bert_ctx->pstack->node->op->arity),  bert_ctx->pstack->node->op->pname);
 	    error("special label operator requires term for right argument");
 	    }
-	if (((TERM_NODE *)(pstack->node))->label) {
+	if (((TERM_NODE *)(bert_ctx->pstack->node))->label) {
 	    /* eventually should allow multiple labels */
 	    fprintf(stderr, "new label: %s, old label: %s, operator: %s\n",
 		((NAME_NODE *)(rop->next->node))->pval,
-		((TERM_NODE *)(pstack->node))->label->pval,
-		pstack->node->op->pname);
+		((TERM_NODE *)(bert_ctx->pstack->node))->label->pval,
+		bert_ctx->pstack->node->op->pname);
 	    error("multiple labels on single expression");
 	    }
-	label_count++;		/* number of label names in a rule */
-	((TERM_NODE *)(pstack->node))->label = (NAME_NODE *) rop->next->node;
-	pstack->next = pstack->next->next->next;	/* delete : and name */
+	bert_ctx->label_count++;		/* number of label names in a rule */
+	((TERM_NODE *)(bert_ctx->pstack->node))->label = (NAME_NODE *) rop->next->node;
+	bert_ctx->pstack->next = bert_ctx->pstack->next->next->next;	/* delete : and name */
 	st_free(rop->next);
 	st_free(rop);
 	break;
@@ -147,17 +137,17 @@ if (rop->node->op->eval < 0) {
 		rop->node->op->pname, arity_name(rop->node->op->arity));
 	    error("special negation operator must be unary operator");
 	    }
-	if (rop == pstack || pstack->info != EXPR_TYPE) {
+	if (rop == bert_ctx->pstack || bert_ctx->pstack->info != EXPR_TYPE) {
   	    fprintf(stderr, "unary operator: %s\n", rop->node->op->pname);
 	    error("unary operator has no argument");
 	    }
-	if (!(pstack->node->op->arity & OP_NUM)) {
+	if (!(bert_ctx->pstack->node->op->arity & OP_NUM)) {
 	    fprintf(stderr, "right argument is: %s, of type: %s\n",
-		arity_name(pstack->node->op->arity),  pstack->node->op->pname);
+		arity_name(bert_ctx->pstack->node->op->arity),  bert_ctx->pstack->node->op->pname);
 	    error("special negation operator requires constant for argument");
 	    }
-	((NUM_NODE *)(pstack->node))->value *= -1;
-	pstack->next = pstack->next->next;	/* delete rop */
+	((NUM_NODE *)(bert_ctx->pstack->node))->value *= -1;
+	bert_ctx->pstack->next = bert_ctx->pstack->next->next;	/* delete rop */
 	st_free(rop);
 	break;
      case 4:	/* don't evaluate (typically []) */
@@ -172,7 +162,7 @@ if (rop->node->op->eval < 0) {
 	}	/* end switch */
 #   ifdef DEBUG
     fprintf(stderr, "result expr is: ");
-    expr_print(pstack->node);
+    expr_print(bert_ctx->pstack->node);
     fprintf(stderr, "\n");
 #   endif
     }	/* end of special parser reduce functions */
@@ -182,7 +172,7 @@ if (rop->node->op->eval < 0) {
 
 /* binary infix operator */
 else if (rop->node->op->arity & BINARY) {
-    if (rop == pstack || pstack->info != EXPR_TYPE) {
+    if (rop == bert_ctx->pstack || bert_ctx->pstack->info != EXPR_TYPE) {
 	fprintf(stderr, "binary operator: %s\n", rop->node->op->pname);
 	error("binary operator has no right argument");
 	}
@@ -190,7 +180,7 @@ else if (rop->node->op->arity & BINARY) {
 	fprintf(stderr, "binary operator: %s\n", rop->node->op->pname);
 	error("binary operator has no left argument");
 	}
-    ((TERM_NODE *)(rop->node))->right = pstack->node;
+    ((TERM_NODE *)(rop->node))->right = bert_ctx->pstack->node;
     ((TERM_NODE *)(rop->node))->left = rop->next->node;
 #   ifdef DEBUG
     fprintf(stderr, "reduce BINARY\n");
@@ -200,8 +190,8 @@ else if (rop->node->op->arity & BINARY) {
 	((TERM_NODE *)(rop->node))->left->op->pname);
 #   endif
     rop->info = EXPR_TYPE;
-    st_free(pstack);	/* free right child parse stack node */
-    pstack = rop;
+    st_free(bert_ctx->pstack);	/* free right child parse stack node */
+    bert_ctx->pstack = rop;
     q = rop->next;
     rop->next = rop->next->next;	/* pop expr nodes, leave oper node */
     st_free(q);		/* free left child parse stack node */
@@ -209,19 +199,19 @@ else if (rop->node->op->arity & BINARY) {
 
 /* unary prefix operator */
 else if (rop->node->op->arity == PREFIX) {
-    if (rop == pstack || pstack->info != EXPR_TYPE) {
+    if (rop == bert_ctx->pstack || bert_ctx->pstack->info != EXPR_TYPE) {
   	fprintf(stderr, "prefix operator: %s\n", rop->node->op->pname);
 	error("prefix operator has no argument");
 	}
     ((TERM_NODE *)(rop->node))->left = NULL;
-    ((TERM_NODE *)(rop->node))->right = pstack->node;
+    ((TERM_NODE *)(rop->node))->right = bert_ctx->pstack->node;
 #   ifdef DEBUG
     fprintf(stderr, "reduce PREFIX\n");
     fprintf(stderr, "right child is: %s\n",
 	((TERM_NODE *)(rop->node))->right->op->pname);
 #   endif    
-    st_free(pstack);	/* free right child parse stack node */
-    pstack = rop;		/* pop off top node */
+    st_free(bert_ctx->pstack);	/* free right child parse stack node */
+    bert_ctx->pstack = rop;		/* pop off top node */
     rop->info = EXPR_TYPE;
     }
 
@@ -249,20 +239,20 @@ else if (rop->node->op->arity == POSTFIX) {
 
 /* unary outfix (matchfix) operator */
 else if (rop->node->op->arity == OUTFIX1) {
-    if (rop == pstack || pstack->info != EXPR_TYPE) {
+    if (rop == bert_ctx->pstack || bert_ctx->pstack->info != EXPR_TYPE) {
   	fprintf(stderr, "outfix operator: %s\n", rop->node->op->pname);
 	error("outfix operator has no argument");
 	}
     ((TERM_NODE *)(rop->node))->left = NULL;
-    ((TERM_NODE *)(rop->node))->right = pstack->node;
+    ((TERM_NODE *)(rop->node))->right = bert_ctx->pstack->node;
 #   ifdef DEBUG
     fprintf(stderr, "OUTFIX1\n");
     fprintf(stderr, "right child is: %s\n",
 	((TERM_NODE *)(rop->node))->right->op->pname);
 #   endif
     rop->info = EXPR_TYPE;
-    st_free(pstack);		/* free right child parse stack node */
-    pstack = rop;
+    st_free(bert_ctx->pstack);		/* free right child parse stack node */
+    bert_ctx->pstack = rop;
     }
 else {	/* unknown type of operator */
     fprintf(stderr, "can't reduce %s, arity: %s\n", rop->node->op,
@@ -272,7 +262,7 @@ else {	/* unknown type of operator */
 
 #ifdef DEBUG
 fprintf(stderr, "leaving reduce with parse stack:\n");
-ps_print(pstack);
+ps_print(bert_ctx->pstack);
 #endif
 
 }
@@ -307,10 +297,10 @@ else fprintf(stderr, "shifting unknown %s onto pstack\n",
 #endif
 
 temp = st_get();
-temp->next = pstack;	/* push onto parse stack */
-pstack = temp;
-pstack->node = p;	/* assign pointer to expression tree node */
-pstack->info = type;	/* assign type of node */
+temp->next = bert_ctx->pstack;	/* push onto parse stack */
+bert_ctx->pstack = temp;
+bert_ctx->pstack->node = p;	/* assign pointer to expression tree node */
+bert_ctx->pstack->info = type;	/* assign type of node */
 }
 
 /***********************************************************************
@@ -340,45 +330,38 @@ void st_free();		/* from util.c */
 char *char_copy();	/* from util.c */
 NODE *node_new();	/* from expr.c */
 NODE *name_put();	/* from names.c */
-extern OP *pnum_prim;	/* positive constants, from primitive.c */
-extern OP *znum_prim;	/* the constant zero, from primitive.c */
-extern OP *nnum_prim;	/* negative constants, from primitive.c */
-extern OP *str_prim;	/* string constants, from primitive.c */
-extern OP *undeclared_prim;	/* from primitive.c */
-extern OP *untyped_prim;	/* from primitive.c */
-extern NAME_NODE *global_names;	/* from names.c */
 
 #ifdef DEBUG
 if (part==HEAD) fprintf(stderr, "parsing HEAD\n");
 else if (part==BODY) fprintf(stderr, "parsing BODY\n");
 else fprintf(stderr, "parsing unknown = %d\n", part);
 
-if (pstack) fprintf(stderr, "nodes left on parse stack!\n");
+if (bert_ctx->pstack) fprintf(stderr, "nodes left on parse stack!\n");
 #endif
 
-pstack = NULL;		/* reinitialize */
+bert_ctx->pstack = NULL;		/* reinitialize */
 
 /* Push a beginning-of-expression oper onto the parse stack. */
-shift(boe, OPER_TYPE);	
+shift(bert_ctx->boe, OPER_TYPE);	
 
 while (!done) {
     if (holdtoken) {
 #	ifdef DEBUG
-    	fprintf(stderr, "holdtoken is true, using next_token = %s\n", token_prval);
+    	fprintf(stderr, "holdtoken is true, using next_token = %s\n", bert_ctx->token_prval);
 #	endif 
-	token = next_token;	/* prev token -> current token */
+	bert_ctx->token = bert_ctx->next_token;	/* prev token -> current token */
 	holdtoken = FALSE;	/* reset */
 	}
     else {
-	token = scan();
+	bert_ctx->token = scan();
 #	ifdef DEBUG
-    	fprintf(stderr, "called scanner, token = %s\n", token_prval);
-	if (token == OPER) fprintf(stderr, "OPER precedence = %ld\n",
-		token_op->precedence);
+    	fprintf(stderr, "called scanner, token = %s\n", bert_ctx->token_prval);
+	if (bert_ctx->token == OPER) fprintf(stderr, "OPER precedence = %ld\n",
+		bert_ctx->token_op->precedence);
 #	endif 
 	}
 
-    switch(token) {
+    switch(bert_ctx->token) {
      case EOF: error("EOF encountered before end of expression");
 	break;
      case '{':	/* end of head expression */
@@ -391,27 +374,27 @@ while (!done) {
 	break;
      case IDENT: 	/* identifier, put in name space */
 	/* an identifier must follow an operator */
-	if (pstack->info != OPER_TYPE) {
+	if (bert_ctx->pstack->info != OPER_TYPE) {
 	    fprintf(stderr, "for tokens: ");
-	    expr_print(pstack->node);
-	    fprintf(stderr, " and %s\n", token_prval);
+	    expr_print(bert_ctx->pstack->node);
+	    fprintf(stderr, " and %s\n", bert_ctx->token_prval);
 	    error("missing operator");
 	    }
-	strcpy(prev_prval, token_prval);	/* save token_prval */
-	next_token = scan();		 	/* look ahead */
+	strcpy(prev_prval, bert_ctx->token_prval);	/* save token_prval */
+	bert_ctx->next_token = scan();		 	/* look ahead */
 #	ifdef DEBUG
-	fprintf(stderr, "lookahead next_token = %s\n", token_prval);
+	fprintf(stderr, "lookahead next_token = %s\n", bert_ctx->token_prval);
 #	endif
 	if (part == HEAD) {	/* must be a parameter */
-	    if (next_token == '.') {
+	    if (bert_ctx->next_token == '.') {
 		fprintf(stderr, "name beginning with: %s\n", prev_prval);
 		error("qualified names illegal in head of rule");
 		}
-	    if (next_token == TYPE) {
-		cnode = name_put(prev_prval, rule_names, token_op);
+	    if (bert_ctx->next_token == TYPE) {
+		cnode = name_put(prev_prval, bert_ctx->rule_names, bert_ctx->token_op);
 		}
 	    else {
-		cnode = name_put(prev_prval, rule_names, untyped_prim);
+		cnode = name_put(prev_prval, bert_ctx->rule_names, bert_ctx->untyped_prim);
 		holdtoken = TRUE;
 		}
 	    if (((NAME_NODE *) cnode)->refs != 2) {
@@ -423,57 +406,57 @@ while (!done) {
 	    }
 
 	/* if we get here, then we must be in the body of the rule */
-	if (next_token == TYPE) {
-	    fprintf(stderr, "ident: %s, type: %s\n", prev_prval, token_prval);
+	if (bert_ctx->next_token == TYPE) {
+	    fprintf(stderr, "ident: %s, type: %s\n", prev_prval, bert_ctx->token_prval);
 	    error("types not allowed in body of rule");
 	    }
 
 	/* insert name into local name space */
-	cspace = rule_names;
-	while (next_token == '.') {
-	    cspace = (NAME_NODE *) name_put(prev_prval, cspace, undeclared_prim);
-	    next_token = scan();	/* look ahead for ident */
-	    if (next_token != IDENT) {	
-		if (next_token == OPER)
-		    fprintf(stderr, "token: %s is an operator\n", token_prval);
-		else fprintf(stderr, "token: %s\n", token_prval);
+	cspace = bert_ctx->rule_names;
+	while (bert_ctx->next_token == '.') {
+	    cspace = (NAME_NODE *) name_put(prev_prval, cspace, bert_ctx->undeclared_prim);
+	    bert_ctx->next_token = scan();	/* look ahead for ident */
+	    if (bert_ctx->next_token != IDENT) {	
+		if (bert_ctx->next_token == OPER)
+		    fprintf(stderr, "token: %s is an operator\n", bert_ctx->token_prval);
+		else fprintf(stderr, "token: %s\n", bert_ctx->token_prval);
 		error("expected identifier following '.'");
 		}
-	    strcpy(prev_prval, token_prval);
-	    next_token = scan();	/* look ahead for '.' */
+	    strcpy(prev_prval, bert_ctx->token_prval);
+	    bert_ctx->next_token = scan();	/* look ahead for '.' */
 	    }	/* end of qualified name */
 	holdtoken = TRUE;
-	cnode = name_put(prev_prval, cspace, undeclared_prim);
+	cnode = name_put(prev_prval, cspace, bert_ctx->undeclared_prim);
 	shift(cnode, EXPR_TYPE);	/* shift as expression */
 	break;
 
      case '.':	/* global variable */
 	if (part == HEAD) {
-	    fprintf(stderr, "token: %s\n", token_prval);
+	    fprintf(stderr, "token: %s\n", bert_ctx->token_prval);
 	    error("global names illegal in head of rule");
 	    }
 	/* an identifier must follow an operator */
-	if (pstack->info != OPER_TYPE) {
+	if (bert_ctx->pstack->info != OPER_TYPE) {
 	    fprintf(stderr, "for tokens: ");
-	    expr_print(pstack->node);
-	    fprintf(stderr, " and %s\n", token_prval);
+	    expr_print(bert_ctx->pstack->node);
+	    fprintf(stderr, " and %s\n", bert_ctx->token_prval);
 	    error("missing operator");
 	    }
-	cspace = global_names;
-	while (next_token == '.') {
-	    cspace = (NAME_NODE *) name_put(prev_prval, cspace, undeclared_prim);
-	    next_token = scan();	/* look ahead for ident */
-	    if (next_token != IDENT) {
-		if (next_token == OPER)
-		    fprintf(stderr, "token: %s is an operator\n", token_prval);
-		else fprintf(stderr, "token: %s\n", token_prval);
+	cspace = bert_ctx->global_names;
+	while (bert_ctx->next_token == '.') {
+	    cspace = (NAME_NODE *) name_put(prev_prval, cspace, bert_ctx->undeclared_prim);
+	    bert_ctx->next_token = scan();	/* look ahead for ident */
+	    if (bert_ctx->next_token != IDENT) {
+		if (bert_ctx->next_token == OPER)
+		    fprintf(stderr, "token: %s is an operator\n", bert_ctx->token_prval);
+		else fprintf(stderr, "token: %s\n", bert_ctx->token_prval);
 		error("expected identifier following '.'");
 		}
-	    strcpy(prev_prval, token_prval);
-	    next_token = scan();	/* look ahead for '.' */
+	    strcpy(prev_prval, bert_ctx->token_prval);
+	    bert_ctx->next_token = scan();	/* look ahead for '.' */
  	    }	/* end of global name */
 	holdtoken = TRUE;
-	cnode = name_put(prev_prval, cspace, undeclared_prim);
+	cnode = name_put(prev_prval, cspace, bert_ctx->undeclared_prim);
 	shift(cnode, EXPR_TYPE);	/* shift as expression */
 	break;
 
@@ -482,13 +465,13 @@ while (!done) {
 	fprintf(stderr, "type is number\n");
 #	endif
 	cnode = node_new();
-	cnode->op = (token_val > 0.0) ? pnum_prim :
-	    ((token_val < 0.0) ? nnum_prim : znum_prim );
-	((NUM_NODE *) cnode)->value = token_val;
-	if (pstack->info != OPER_TYPE) {
+	cnode->op = (bert_ctx->token_val > 0.0) ? bert_ctx->pnum_prim :
+	    ((bert_ctx->token_val < 0.0) ? bert_ctx->nnum_prim : bert_ctx->znum_prim );
+	((NUM_NODE *) cnode)->value = bert_ctx->token_val;
+	if (bert_ctx->pstack->info != OPER_TYPE) {
 	    fprintf(stderr, "for tokens: ");
-	    expr_print(pstack->node);
-	    fprintf(stderr, " and %s\n", token_prval);
+	    expr_print(bert_ctx->pstack->node);
+	    fprintf(stderr, " and %s\n", bert_ctx->token_prval);
 	    error("missing operator");
 	    }
 	shift(cnode, EXPR_TYPE);	/* shift onto parse stack */
@@ -499,12 +482,12 @@ while (!done) {
 	fprintf(stderr, "type is string\n");
 #	endif
 	cnode = node_new();
-	cnode->op = str_prim;	/* constant oper for strings */
-	((STR_NODE *) cnode)->value = char_copy(token_prval);
-	if (pstack->info != OPER_TYPE) {
+	cnode->op = bert_ctx->str_prim;	/* constant oper for strings */
+	((STR_NODE *) cnode)->value = char_copy(bert_ctx->token_prval);
+	if (bert_ctx->pstack->info != OPER_TYPE) {
 	    fprintf(stderr, "for tokens: ");
-	    expr_print(pstack->node);
-	    fprintf(stderr, " and %s\n", token_prval);
+	    expr_print(bert_ctx->pstack->node);
+	    fprintf(stderr, " and %s\n", bert_ctx->token_prval);
 	    error("missing operator");
 	    }
 	shift(cnode, EXPR_TYPE);	/* shift onto parse stack */
@@ -512,11 +495,11 @@ while (!done) {
 
      case OPER:
 #	ifdef DEBUG
-	fprintf(stderr, "type of %s is oper\n", token_prval);
+	fprintf(stderr, "type of %s is oper\n", bert_ctx->token_prval);
 #	endif
 
 	cnode = node_new();		/* to hold this operator */
-	cnode->op = token_op;		/* oper ptr from scanner */
+	cnode->op = bert_ctx->token_op;		/* oper ptr from scanner */
 	((TERM_NODE *) cnode)->label = (NAME_NODE *) NULL;
 	((TERM_NODE *) cnode)->left = (NODE *) NULL;
 	((TERM_NODE *) cnode)->right = (NODE *) NULL;
@@ -538,7 +521,7 @@ while (!done) {
 	for (;;) {		/* for ever */
 
 	    /* the top or next node on the stack must be an operator */
-	    lop = pstack;
+	    lop = bert_ctx->pstack;
 	    if (lop && lop->info != OPER_TYPE) lop = lop->next;
 	    if (!lop || lop->info != OPER_TYPE)
 		error("syntax error: missing operator!");
@@ -550,7 +533,7 @@ while (!done) {
 		operator of the same name in the "other" field),
 		or else there is an error. */
 
-	    if (lop == pstack && (lop->node->op->arity & BINARY) && 
+	    if (lop == bert_ctx->pstack && (lop->node->op->arity & BINARY) && 
        		cnode->op->arity & BINARY) {
 
 		/* first check if cnode could be prefix */
@@ -608,7 +591,7 @@ while (!done) {
 		prefix or outfix1 operator on top of the parse stack,
 		see if the current operator can be changed to unary */
 
-       	    if (cnode->op->arity & BINARY && lop == pstack && (lop->node->op->arity
+       	    if (cnode->op->arity & BINARY && lop == bert_ctx->pstack && (lop->node->op->arity
 		== PREFIX || lop->node->op->arity == OUTFIX1)) {
 		if (cnode->op->other && cnode->op->other->arity == PREFIX) {
 		    cnode->op = cnode->op->other; 	/* to unary */
@@ -676,12 +659,12 @@ while (!done) {
 	break;
 
      case TYPE:
-	fprintf(stderr,"type: %s\n", token_prval);
+	fprintf(stderr,"type: %s\n", bert_ctx->token_prval);
 	if (part == BODY) error("types not allowed in body of rule");
 	else error("type with no parameter");
 
      default: 				/* reserved character */
-	fprintf(stderr,"token: %s\n", token_prval);
+	fprintf(stderr,"token: %s\n", bert_ctx->token_prval);
 	error("illegal token in rule");
 
 	}		/* end switch */
@@ -692,25 +675,25 @@ while (!done) {
     }	/* end of do until done (end of expression) */
 
 #ifdef DEBUG
-ps_print(pstack);
+ps_print(bert_ctx->pstack);
 #endif
 
 /* have encountered end of expression, reduce everything */
-for (lop = pstack; lop; lop = lop->next) {
+for (lop = bert_ctx->pstack; lop; lop = lop->next) {
     if (lop->info == OPER_TYPE) {
-	if (lop->node == boe) break;	/* found bottom of parse stack */
+	if (lop->node == bert_ctx->boe) break;	/* found bottom of parse stack */
 	else {
 	    reduce(lop);	/* reduce this operator */
-	    lop = pstack;	/* start from the top */
+	    lop = bert_ctx->pstack;	/* start from the top */
 	    }
 	}
     }
 if (!lop) error("empty parse stack!");
 if (lop->next) error("nodes left on parse stack!");
 st_free(lop);	/* free boe parse stack node */
-cnode = pstack->node;	/* save expression */
-st_free(pstack);
-pstack = (SNODE *) NULL;
+cnode = bert_ctx->pstack->node;	/* save expression */
+st_free(bert_ctx->pstack);
+bert_ctx->pstack = (SNODE *) NULL;
 return(cnode);
 }
 
@@ -729,51 +712,57 @@ RULE *rule_build();		/* from rules.c */
 NODE *node_new();		/* from expr.c */
 OP *op_new();			/* from ops.c */
 void st_mem_free();		/* from util.c */
-extern int label_count;		/* from rules.c */
-extern OP *undeclared_prim;	/* from primitive.c */
+double stats_clock();		/* from stats.c */
 
 NODE *head;		/* pointer to root of head's expression tree */
 NODE *body;		/* pointer to root of body's expression tree */
 OP *rule_tag;		/* pointer to root of tag's expression tree */
 
-pstack = NULL;		/* parse stack is empty */
+bert_ctx->pstack = NULL;		/* parse stack is empty */
 
 /* initialize boe psuedo operator */
-boe = node_new();
-boe->op = op_new(3);
-strcpy(boe->op->pname,"BOE");
-boe->op->arity = OUTFIX1;
-boe->op->other = (OP *) NULL;	/* no operator matches boe */
-((TERM_NODE *) boe)->label = (NAME_NODE *) NULL;
-((TERM_NODE *) boe)->left = (NODE *) NULL;
-((TERM_NODE *) boe)->right = (NODE *) NULL;
-
-for (next_token = scan(); EOF != next_token; ) {
+bert_ctx->boe = node_new();
+bert_ctx->boe->op = op_new(3);
+strcpy(bert_ctx->boe->op->pname,"BOE");
+bert_ctx->boe->op->arity = OUTFIX1;
+bert_ctx->boe->op->other = (OP *) NULL;	/* no operator matches boe */
+((TERM_NODE *) bert_ctx->boe)->label = (NAME_NODE *) NULL;
+((TERM_NODE *) bert_ctx->boe)->left = (NODE *) NULL;
+((TERM_NODE *) bert_ctx->boe)->right = (NODE *) NULL;
+
+for (bert_ctx->next_token = scan(); EOF != bert_ctx->next_token; ) {
     /* initialize namespace for local and parameter names */
-    rule_names = (NAME_NODE *) node_new();
-    rule_names->op = undeclared_prim;
-    rule_names->next = (NAME_NODE *) NULL;
-    rule_names->parent = (NAME_NODE *) NULL;
-    rule_names->child = (NAME_NODE *) NULL;
-    rule_names->pval = NULL;
-    rule_names->refs = 1;
-    rule_names->interest = 0;
-    label_count = 0;		/* number of label names in rule */
+    bert_ctx->rule_names = (NAME_NODE *) node_new();
+    bert_ctx->rule_names->op = bert_ctx->undeclared_prim;
+    bert_ctx->rule_names->next = (NAME_NODE *) NULL;
+    bert_ctx->rule_names->parent = (NAME_NODE *) NULL;
+    bert_ctx->rule_names->child = (NAME_NODE *) NULL;
+    bert_ctx->rule_names->pval = NULL;
+    bert_ctx->rule_names->refs = 1;
+    bert_ctx->rule_names->domain = 0;
+    bert_ctx->rule_names->edit = 0;
+    bert_ctx->rule_names->uses = 0;
+    bert_ctx->label_count = 0;		/* number of label names in rule */
 
     head = exp_parse(HEAD);		/* parse HEAD of rule */
-    next_token = scan();
-    if (next_token == EOF) error("EOF encountered before end of rule");
+    bert_ctx->next_token = scan();
+    if (bert_ctx->next_token == EOF) error("EOF encountered before end of rule");
     body = exp_parse(BODY);		/* parse BODY of rule */
 
-    next_token = scan();
-    if (next_token == TYPE) {	/* optional tag */
-	rule_tag = token_op;
-	next_token = scan();
+    bert_ctx->next_token = scan();
+    if (bert_ctx->next_token == TYPE) {	/* optional tag */
+	rule_tag = bert_ctx->token_op;
+	bert_ctx->next_token = scan();
 	}
     else {
 	rule_tag = (OP *) NULL;
 	}
-    rule_build(head, body, rule_tag, rule_names);
+    if (statistics) {
+	double start = stats_clock();
+	rule_build(head, body, rule_tag, bert_ctx->rule_names);
+	bert_ctx->stats.build_time += stats_clock() - start;
+	}
+    else rule_build(head, body, rule_tag, bert_ctx->rule_names);
     }	/* for all rules in the input */
 st_mem_free();		/* free all parse stack memory */
 }
@@ -16,6 +16,9 @@
  * #line	change line number for error messages
  * #trace	set tracing level
  * #quiet	turn all tracing off
+ * #limit	limit rewriting (see limit_define)
+ * #strategy	default reduction strategy (see strategy_define)
+ * #edit	declare or change an edit variable (see edit_define)
  *
  * Other statements, including other C preprocessor statements,
  * may be added in the future.
@@ -26,8 +29,6 @@
 
 #include "def.h"
 
-extern char token_prval[];	/* preprocessor statement from scanner */
-static int token_pos;		/* position in statement */
 
 /* Character input class translation */
 extern char *trans;	/* from scanner.c */
@@ -58,7 +59,7 @@ extern char *trans;	/* from scanner.c */
 static char *
 token_get()
 {
-register char *pos = token_prval + token_pos;
+register char *pos = bert_ctx->token_prval + bert_ctx->token_pos;
 char *tpos = NULL;		/* starting position of token */
 
 while (C_WS == trans[*pos]) pos++;	/* skip whitespace */
@@ -76,7 +77,7 @@ else {			/* unquoted token */
     while (C_WS != trans[*pos] && C_NL != trans[*pos]) pos++;
     *pos++ = '\0';	/* null terminate token */
     }
-token_pos = pos - token_prval;
+bert_ctx->token_pos = pos - bert_ctx->token_prval;
 return tpos;
 }
 
@@ -127,7 +128,6 @@ return tpos;
 #define DEFAULT_PREC 0
 
 /* lists of operator definitions, from ops.c */
-extern OP *single_op, *double_op, *name_op, *type_op;
 
 /********************************************************************
  * 
@@ -167,7 +167,7 @@ if (C_ALPH == class) {		/* alphanumeric operator */
     op = op_new(l);		/* allocate operator node */
     strcpy(op->pname, opn);	/* copy operator name */
     op->arity = arity;
-    op_put(&name_op, op);	/* insert into linked list */
+    op_put(&bert_ctx->name_op, op);	/* insert into linked list */
     }
 else if (C_SPC == class) {
     class = trans[opn[1]];
@@ -175,7 +175,7 @@ else if (C_SPC == class) {
 	op = op_new(1);		/* allocate operator node */
 	strcpy(op->pname, opn);	/* copy operator name */
 	op->arity = arity;
-	op_put(&single_op, op);	/* insert into linked list */
+	op_put(&bert_ctx->single_op, op);	/* insert into linked list */
 	}
     else if (C_SPC == class) {
 	class = trans[opn[2]];
@@ -183,7 +183,7 @@ else if (C_SPC == class) {
 	    op = op_new(2);		/* allocate operator node */
 	    strcpy(op->pname, opn);	/* copy operator name */
 	    op->arity = arity;
-	    op_put(&double_op, op);	/* insert into linked list */
+	    op_put(&bert_ctx->double_op, op);	/* insert into linked list */
 	    }
 	else {
 	    fprintf(stderr, "operator: %s\n", opn);
@@ -251,6 +251,8 @@ char *prfun = NULL;	/* parser reduce function number */
 short arity = -1;	/* number of arguments (see def.h) */
 short kind = -1;	/* i.e., postfix vs. prefix */
 short precedence = -1;
+int strategy = 0;	/* innermost or outermost, if given */
+int ac = 0;		/* ac or commutative, if given */
 OP *op;
 char *arity_name();	/* from ops.c */
 
@@ -344,6 +346,10 @@ for ( ; NULL != (tok = token_get()); ) {	/* do until end of statement */
 	    error("bad operator specification");
 	    }
 	}
+    else if (0==strcmp(tok, "ac")) ac = AC_COMM | AC_ASSOC;
+    else if (0==strcmp(tok, "commutative")) ac = AC_COMM;
+    else if (0==strcmp(tok, "innermost")) strategy = INNERMOST;
+    else if (0==strcmp(tok, "outermost")) strategy = OUTERMOST;
     else if (0==strcmp(tok, "associative")) ; 	/* no-op */
     else if (0==strcmp(tok, "precedence")) ;	/* no-op */
     else if (0==strcmp(tok, "supertype")) ;	/* no-op */
@@ -369,6 +375,10 @@ if (precedence != -1 && arity == NULLARY) {
     fprintf(stderr, "operator: %s, precedence: %d\n", op_name, precedence);
     error("a nullary operator may not have a precedence");
     }
+if (ac && !(arity & BINARY)) {
+    fprintf(stderr, "operator: %s\n", op_name);
+    error("only an infix operator can be ac or commutative");
+    }
 if (precedence != -1 && arity == OUTFIX1) {
     fprintf(stderr, "operators: %s %s, precedence: %d\n",
 	op_name, other_op_name, precedence);
@@ -400,7 +410,7 @@ else if (precedence == -1) op->precedence = DEFAULT_PREC;
 else op->precedence = precedence;
 if (supertype) {
     OP *sop;
-    for (sop = type_op; sop; sop = sop->next) {
+    for (sop = bert_ctx->type_op; sop; sop = sop->next) {
 	if (0==strcmp(sop->pname, supertype+1)) break;
 	}
     if (sop) op->super = sop;
@@ -409,6 +419,9 @@ if (supertype) {
 	error("supertype is invalid type");
 	}
     }
+op->strategy = strategy;
+op->ac = ac;
+if (ac) bert_ctx->ac_ops++;
 if (prfun) {
     int snum;
     snum = atoi(prfun+1);
@@ -461,7 +474,7 @@ ty->arity = OP_NAME;
 ty->precedence = 0;
 ty->other = (OP *) NULL;
 ty->super = (OP *) NULL;
-op_put(&type_op, ty);
+op_put(&bert_ctx->type_op, ty);
 
 tok = token_get();
 if (tok) {	/* supertype */
@@ -475,7 +488,7 @@ if (tok) {	/* supertype */
 	fprintf(stderr,"supertype: %s\n", tok);
 	error("supertype must begin with a single quote");
 	}
-    for (sop = type_op; sop; sop = sop->next) {
+    for (sop = bert_ctx->type_op; sop; sop = sop->next) {
 	if (0==strcmp(sop->pname, tok+1)) break;
 	}
     if (sop) ty->super = sop;
@@ -519,7 +532,7 @@ register OP *sop;	/* supertype */
 
 tok = token_get();
 if (tok[0] == '\'') {
-    for (prim = type_op; prim; prim = prim->next) {
+    for (prim = bert_ctx->type_op; prim; prim = prim->next) {
 	if (0==strcmp(prim->pname, tok+1)) break;
 	}
     if (!prim) {
@@ -528,7 +541,7 @@ if (tok[0] == '\'') {
 	}
     }
 else if (C_ALPH == trans[tok[0]]) {
-    for (prim = name_op; prim; prim = prim->next) {
+    for (prim = bert_ctx->name_op; prim; prim = prim->next) {
 	if (0==strcmp(prim->pname, tok)) break;
 	}
     if (!prim) {
@@ -537,7 +550,7 @@ else if (C_ALPH == trans[tok[0]]) {
 	}
     }
 else if (tok[1] == '\0') {
-    for (prim = single_op; prim; prim = prim->next) {
+    for (prim = bert_ctx->single_op; prim; prim = prim->next) {
 	if (0==strcmp(prim->pname, tok)) break;
 	}
     if (!prim) {
@@ -546,7 +559,7 @@ else if (tok[1] == '\0') {
 	}
     }
 else if (tok[2] == '\0') {
-    for (prim = double_op; prim; prim = prim->next) {
+    for (prim = bert_ctx->double_op; prim; prim = prim->next) {
 	if (0==strcmp(prim->pname, tok)) break;
 	}
     if (!prim) {
@@ -576,7 +589,7 @@ if (tok) {	/* supertype */
 	fprintf(stderr,"supertype: %s\n", tok);
 	error("supertype must begin with a single quote");
 	}
-    for (sop = type_op; sop; sop = sop->next) {
+    for (sop = bert_ctx->type_op; sop; sop = sop->next) {
 	if (0==strcmp(sop->pname, tok+1)) break;
 	}
     if (sop) prim->super = sop;
@@ -620,50 +633,82 @@ else printf("\n");
  * #include /root/dir/file
  * #include "a file"	.. not a typical UNIX file name
  *
+ * A file is only included once into a context; later includes
+ * of the same name (say, of a library that has been preloaded)
+ * are ignored.
+ *
  ********************************************************************/
+FILE *
+lib_open(name)
+char *name;
+{
+extern char *libdir;		/* from main.c */
+FILE *fp;
+char fbuf[256];
+
+fp = fopen(name, "r");
+if (NULL == fp) {
+    strcpy(fbuf, libdir);
+    strcat(fbuf, name);
+    fp = fopen(fbuf, "r");
+    if (NULL == fp) {
+	strcpy(fbuf, "libraries/");
+	strcat(fbuf, name);
+	fp = fopen(fbuf, "r");
+	}
+    }
+return fp;
+}
+
+/********************************************************************
+ *
+ * Remember that a file has been included.
+ * Returns the saved copy of its name, or NULL if it was
+ * already included.
+ *
+ ********************************************************************/
+char *
+include_note(name)
+char *name;
+{
+char *char_copy();		/* from util.c */
+register int i;
+
+for (i = 0; i < bert_ctx->included; i++)
+    if (0 == strcmp(bert_ctx->includes[i], name)) return NULL;
+if (bert_ctx->included >= MAXINCLUDES) error("too many included files");
+return bert_ctx->includes[bert_ctx->included++] = char_copy(name);
+}
+
 void
 file_push()
 {
-extern int filespushed;		/* all from scanner.c */
-extern FILE *infiles[];
-extern FILE *infile;
-extern char *infilenames[];
-extern char *infilename;
-extern int inlinenos[];
-extern int verboses[];
-extern int lineno;
 char *tok;
-char *char_copy();		/* from util.c */
-extern char *libdir;		/* from main.c */
+FILE *fp;
 
 tok = token_get();
 if (!tok) error("no include file name specified");
-infiles[filespushed] = infile;
-infilenames[filespushed] = infilename;
-inlinenos[filespushed] = lineno;
-verboses[filespushed] = verbose;
-infile = fopen(tok, "r");
-if (NULL == infile) {
-    char fbuf[256];
-    strcpy(fbuf, libdir);
-    strcat(fbuf, tok);
-    infile = fopen(fbuf, "r");
-    if (NULL == infile) {
-	strcpy(fbuf, "libraries/");
-	strcat(fbuf, tok);
-	infile = fopen(fbuf, "r");
-	if (NULL == infile) {
-	    fprintf(stderr, "include file: %s\n", tok);
-	    error("file not found");
-	    }
-	}
+if (bert_ctx->filespushed >= MAXFILES) error("includes nested too deeply");
+fp = lib_open(tok);
+if (NULL == fp) {
+    fprintf(stderr, "include file: %s\n", tok);
+    error("file not found");
     }
-infilename = char_copy(tok);
-verbose = FALSE;
-lineno = 1;
-filespushed++;
+if (!(tok = include_note(tok))) {	/* already included */
+    fclose(fp);
+    return;
+    }
+bert_ctx->infiles[bert_ctx->filespushed] = bert_ctx->infile;
+bert_ctx->infilenames[bert_ctx->filespushed] = bert_ctx->infilename;
+bert_ctx->inlinenos[bert_ctx->filespushed] = bert_ctx->lineno;
+bert_ctx->verboses[bert_ctx->filespushed] = bert_ctx->verbose;
+bert_ctx->infile = fp;
+bert_ctx->infilename = tok;
+bert_ctx->verbose = FALSE;
+bert_ctx->lineno = 1;
+bert_ctx->filespushed++;
 #ifdef DEBUG
-printf("now reading from file %s\n", infilename);
+printf("now reading from file %s\n", bert_ctx->infilename);
 #endif
 }
 
@@ -674,6 +719,100 @@ load_file()
 error("#load not implemented");
 }
 
+/********************************************************************
+ *
+ * Limits on rewriting the program, e.g.
+ *	#limit steps 100000 time 2.5 nodes 50000
+ * stops the program after 100000 rewrites, 2.5 seconds of rewriting,
+ * or when rewriting has added 50000 expression nodes, whichever comes
+ * first.  A limit of 0 takes the limit off again.  A limit given by
+ * the caller (see ctx_solve) still applies if it is smaller.
+ *
+ ********************************************************************/
+static void
+limit_define()
+{
+double atof();
+long atol();
+char *tok, *val;
+
+while ((tok = token_get())) {
+    val = token_get();
+    if (!val || C_NUM != trans[(int) val[0]]) {
+	fprintf(stderr, "limit: %s\n", tok);
+	error("#limit needs a number");
+	}
+    if (0 == strcmp(tok, "steps")) bert_ctx->pragma_steps = atol(val);
+    else if (0 == strcmp(tok, "time")) bert_ctx->pragma_time = atof(val);
+    else if (0 == strcmp(tok, "nodes")) bert_ctx->pragma_nodes = atol(val);
+    else {
+	fprintf(stderr, "limit: %s\n", tok);
+	error("#limit must be steps, time or nodes");
+	}
+    }
+}
+
+/********************************************************************
+ *
+ * Look up a reduction strategy by name.
+ *
+ * returns:	OUTERMOST, INNERMOST or PARALLEL, 0 if no such strategy
+ *
+ ********************************************************************/
+int
+strategy_named(name)
+char *name;
+{
+if (0 == strcmp(name, "outermost")) return OUTERMOST;
+if (0 == strcmp(name, "innermost")) return INNERMOST;
+if (0 == strcmp(name, "parallel")) return PARALLEL;
+return 0;
+}
+
+/********************************************************************
+ *
+ * Default reduction strategy of the program, e.g.
+ *	#strategy innermost
+ * for the terms whose operators were not defined innermost or
+ * outermost (see op_define).  A strategy given by the caller (see
+ * ctx_solve) takes precedence.
+ *
+ ********************************************************************/
+static void
+strategy_define()
+{
+char *tok = token_get();
+
+if (!tok || !(bert_ctx->pragma_strategy = strategy_named(tok))) {
+    if (tok) fprintf(stderr, "strategy: %s\n", tok);
+    error("#strategy must be outermost, innermost or parallel");
+    }
+if (token_get()) error("#strategy takes one strategy");
+}
+
+/********************************************************************
+ *
+ * An edit variable and its value (see edit.c), e.g.
+ *	#edit width 3
+ * Another #edit of the same name changes its value.
+ *
+ ********************************************************************/
+static void
+edit_define()
+{
+double atof();
+void edit_set();		/* from edit.c */
+char *tok = token_get();
+char *val = token_get();
+
+if (!tok || !val || C_NUM != trans[(int) val[val[0] == '-']]) {
+    if (tok) fprintf(stderr, "edit: %s\n", tok);
+    error("#edit needs a name and a number");
+    }
+if (token_get()) error("#edit takes one name and one number");
+edit_set(tok, atof(val));
+}
+
 /********************************************************************
  *
  * preprocess:  Interpret preprocessor statements.
@@ -689,9 +828,8 @@ void
 preprocess()
 {
 char *tok;
-extern int lineno;	/* from scanner.c */
 
-token_pos = 0;
+bert_ctx->token_pos = 0;
 tok = token_get();
 if (!tok) return;	/* null statement, ignore */
 if (0 == strcmp(tok, "op") || 0 == strcmp(tok, "operator")) op_define();
@@ -702,15 +840,18 @@ else if (0 == strcmp(tok, "load")) load_file();
 else if (0 == strcmp(tok, "line")) {
     tok = token_get();
     if (tok) {
-	if (C_NUM == trans[tok[0]]) lineno = atoi(tok);
+	if (C_NUM == trans[tok[0]]) bert_ctx->lineno = atoi(tok);
 	}
     }
 else if (0 == strcmp(tok, "trace")) {
     tok = token_get();
-    if (tok && (C_NUM == trans[tok[0]])) verbose = atoi(tok);
-    else verbose = 1;
+    if (tok && (C_NUM == trans[tok[0]])) bert_ctx->verbose = atoi(tok);
+    else bert_ctx->verbose = 1;
     }
-else if (0 == strcmp(tok, "quiet")) verbose = 0;
+else if (0 == strcmp(tok, "quiet")) bert_ctx->verbose = 0;
+else if (0 == strcmp(tok, "limit")) limit_define();
+else if (0 == strcmp(tok, "strategy")) strategy_define();
+else if (0 == strcmp(tok, "edit")) edit_define();
 else {
     fprintf(stderr, "preprocessor statement keyword: #%s\n", tok);
     error("invalid preprocessor statement");
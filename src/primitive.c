@@ -63,21 +63,9 @@ void graphics_init();
 void draw_line();
 void draw_string();
 
-OP *pnum_prim;		/* a particular positive numeric constant */
-OP *nnum_prim;		/* a particular negative numeric constant */
-OP *znum_prim;		/* the numeric constant zero */
-OP *str_prim;		/* a particular string constant */
-OP *undeclared_prim;	/* not declared yet ('?) */
-OP *untyped_prim;	/* declared, but untyped */
 
-OP *positive_type;	/* numeric constants greater than zero */
-OP *nonzero_type;	/* numeric constants not equal to zero */
-OP *constant_type;	/* any numeric constant */
-OP *literal_type;	/* string constants */
 /* true and false would not need to be primitives operators, except */
 /* that the relational primitives need to return them. */
-OP *true_op;		/* boolean true operator */
-OP *false_op;		/* boolean false operator */
 
 /*************************************************************
  *
@@ -85,10 +73,6 @@ OP *false_op;		/* boolean false operator */
  *
  *************************************************************/
 /* linked lists to put operators and types -- from ops.c */
-extern OP *single_op;	/* list of single-character operators */
-extern OP *double_op;	/* list of double-character operators */
-extern OP *name_op;	/* list of alphanumeric operators */
-extern OP *type_op;	/* list of types */
 
 /* used for a type or operator with no supertype */
 #define NOSUPER (OP *) NULL
@@ -99,47 +83,52 @@ primitive_init()
 OP *primitive();		/* from util.c */
 
 /* primitive types and operators */
-constant_type = primitive("constant", OP_NAME, NOSUPER, &type_op, 0);
-nonzero_type = primitive("nonzero", OP_NAME, constant_type, &type_op, 0);
-positive_type = primitive("positive", OP_NAME, nonzero_type, &type_op, 0);
-literal_type = primitive("literal", OP_NAME, NOSUPER, &type_op, 0);
-true_op = primitive("true", NULLARY, NOSUPER, &name_op, 0);
-false_op = primitive("false", NULLARY, NOSUPER, &name_op, 0);
+bert_ctx->constant_type = primitive("constant", OP_NAME, NOSUPER, &bert_ctx->type_op, 0);
+bert_ctx->nonzero_type = primitive("nonzero", OP_NAME, bert_ctx->constant_type, &bert_ctx->type_op, 0);
+bert_ctx->positive_type = primitive("positive", OP_NAME, bert_ctx->nonzero_type, &bert_ctx->type_op, 0);
+bert_ctx->literal_type = primitive("literal", OP_NAME, NOSUPER, &bert_ctx->type_op, 0);
+bert_ctx->true_op = primitive("true", NULLARY, NOSUPER, &bert_ctx->name_op, 0);
+bert_ctx->false_op = primitive("false", NULLARY, NOSUPER, &bert_ctx->name_op, 0);
 
-pnum_prim = primitive("positive constants", OP_NUM, positive_type, NULL, 0);
-znum_prim = primitive("zero", OP_NUM, constant_type, NULL, 0);
-nnum_prim = primitive("negative constants", OP_NUM, nonzero_type, NULL, 0);
-str_prim = primitive("string constant", OP_STR, literal_type, NULL, 0);
-undeclared_prim = primitive("?", OP_NAME, NOSUPER, NULL, 0);
-untyped_prim = primitive("", OP_NAME, NOSUPER, NULL, 0);
+bert_ctx->pnum_prim = primitive("positive constants", OP_NUM, bert_ctx->positive_type, NULL, 0);
+bert_ctx->znum_prim = primitive("zero", OP_NUM, bert_ctx->constant_type, NULL, 0);
+bert_ctx->nnum_prim = primitive("negative constants", OP_NUM, bert_ctx->nonzero_type, NULL, 0);
+bert_ctx->str_prim = primitive("string constant", OP_STR, bert_ctx->literal_type, NULL, 0);
+bert_ctx->undeclared_prim = primitive("?", OP_NAME, NOSUPER, NULL, 0);
+bert_ctx->untyped_prim = primitive("", OP_NAME, NOSUPER, NULL, 0);
 
 /* machine primitives, to execute. */
 /* All primitives are NULLARY, despite the fact that they take arguments. */
 /* Note typical usage in bops. */
-primitive("bind_primitive", NULLARY, NOSUPER, &name_op, 1);
+primitive("bind_primitive", NULLARY, NOSUPER, &bert_ctx->name_op, 1);
 
-primitive("addition_primitive", NULLARY, NOSUPER, &name_op, 16);
-primitive("subtraction_primitive", NULLARY, NOSUPER, &name_op, 17);
-primitive("multiplication_primitive", NULLARY, NOSUPER, &name_op, 18);
-primitive("division_primitive", NULLARY, NOSUPER, &name_op, 19);
-primitive("equality_primitive", NULLARY, NOSUPER, &name_op, 20);
-primitive("lessthan_primitive", NULLARY, NOSUPER, &name_op, 21);
-primitive("lessorequal_primitive", NULLARY, NOSUPER, &name_op, 22);
-primitive("power_primitive", NULLARY, NOSUPER, &name_op, 23);
-primitive("sin_primitive", NULLARY, NOSUPER, &name_op, 24);
-primitive("cos_primitive", NULLARY, NOSUPER, &name_op, 25);
-primitive("tan_primitive", NULLARY, NOSUPER, &name_op, 26);
-primitive("atan_primitive", NULLARY, NOSUPER, &name_op, 27);
-primitive("round_primitive", NULLARY, NOSUPER, &name_op, 28);
-primitive("floor_primitive", NULLARY, NOSUPER, &name_op, 29);
-primitive("lexcompare_primitive", NULLARY, NOSUPER, &name_op, 30);
-primitive("trace_primitive", NULLARY, NOSUPER, &name_op, 31);
+primitive("addition_primitive", NULLARY, NOSUPER, &bert_ctx->name_op, 16);
+primitive("subtraction_primitive", NULLARY, NOSUPER, &bert_ctx->name_op, 17);
+primitive("multiplication_primitive", NULLARY, NOSUPER, &bert_ctx->name_op, 18);
+primitive("division_primitive", NULLARY, NOSUPER, &bert_ctx->name_op, 19);
+primitive("equality_primitive", NULLARY, NOSUPER, &bert_ctx->name_op, 20);
+primitive("lessthan_primitive", NULLARY, NOSUPER, &bert_ctx->name_op, 21);
+primitive("lessorequal_primitive", NULLARY, NOSUPER, &bert_ctx->name_op, 22);
+primitive("power_primitive", NULLARY, NOSUPER, &bert_ctx->name_op, 23);
+primitive("sin_primitive", NULLARY, NOSUPER, &bert_ctx->name_op, 24);
+primitive("cos_primitive", NULLARY, NOSUPER, &bert_ctx->name_op, 25);
+primitive("tan_primitive", NULLARY, NOSUPER, &bert_ctx->name_op, 26);
+primitive("atan_primitive", NULLARY, NOSUPER, &bert_ctx->name_op, 27);
+primitive("round_primitive", NULLARY, NOSUPER, &bert_ctx->name_op, 28);
+primitive("floor_primitive", NULLARY, NOSUPER, &bert_ctx->name_op, 29);
+primitive("lexcompare_primitive", NULLARY, NOSUPER, &bert_ctx->name_op, 30);
+primitive("trace_primitive", NULLARY, NOSUPER, &bert_ctx->name_op, 31);
 
-primitive("line_primitive", NULLARY, NOSUPER, &name_op, 40);
-primitive("string_primitive", NULLARY, NOSUPER, &name_op, 41);
+primitive("line_primitive", NULLARY, NOSUPER, &bert_ctx->name_op, 40);
+primitive("string_primitive", NULLARY, NOSUPER, &bert_ctx->name_op, 41);
 
 /* USER DEFINED PRIMITIVES GO HERE */
 /* You might want to number your primitives starting with 64 */
+primitive("linear_add_primitive", NULLARY, NOSUPER, &bert_ctx->name_op, 64);
+primitive("linear_scale_primitive", NULLARY, NOSUPER, &bert_ctx->name_op, 65);
+primitive("linear_substitute_primitive", NULLARY, NOSUPER, &bert_ctx->name_op, 66);
+primitive("linsolve_primitive", NULLARY, NOSUPER, &bert_ctx->name_op, 67);
+primitive("int_domain_primitive", NULLARY, NOSUPER, &bert_ctx->name_op, 68);
 
 /* End of user defined primitives */
 }
@@ -167,10 +156,15 @@ NODE *node_new();	/* from expr.c */
 char *arity_name();	/* from ops.c */
 NODE *expr_copy();	/* from expr.c */
 int name_compare();	/* from names.c */
+void node_free();	/* from expr.c */
+NODE *lx_add();		/* from lx.c */
+NODE *lx_scale();	/* from lx.c */
+NODE *lx_substitute();	/* from lx.c */
+NODE *lx_solve();	/* from linsolve.c */
+NODE *fd_declare();	/* from fd.c */
 
 /* Should be set if a variable gets bound. */
 /* Causes all bound variables to be replaced by their value */
-extern int bondage;	/* from match.c */
 
 register TERM_NODE *tn = (TERM_NODE *) ex;
 register NODE *answer = node_new();
@@ -184,7 +178,7 @@ answer->op = (OP *) NULL;
 
 switch(which) {
  case 1:		/* bind */
-    answer->op = true_op;
+    answer->op = bert_ctx->true_op;
     if (tn->left->op->arity != OP_NAME) {
 	fprintf(stderr, "operator: %s, arity %s\n", tn->left->op->pname,
 	    arity_name(tn->left->op->arity));
@@ -200,7 +194,7 @@ switch(which) {
 	error("\nbound expression contains variable to which it is being bound");
 	}
     ((NAME_NODE *)(tn->left))->value = expr_copy(tn->right);
-    bondage = TRUE;	/* need to replace bound variable */
+    bert_ctx->bondage = TRUE;	/* need to replace bound variable */
     break;
  case 16:		/* addition */
     ((NUM_NODE *)answer)->value = ((NUM_NODE *)(tn->left))->value +
@@ -220,15 +214,15 @@ switch(which) {
     break;
  case 20:		/* numeric equality */
     answer->op = (((NUM_NODE *)tn->left)->value ==
-	((NUM_NODE *)tn->right)->value) ? true_op : false_op ;
+	((NUM_NODE *)tn->right)->value) ? bert_ctx->true_op : bert_ctx->false_op ;
     break;
  case 21:		/* numeric less than */
     answer->op = (((NUM_NODE *)tn->left)->value <
-	((NUM_NODE *)tn->right)->value) ? true_op : false_op ;
+	((NUM_NODE *)tn->right)->value) ? bert_ctx->true_op : bert_ctx->false_op ;
     break;
  case 22:		/* numeric less or equal */
     answer->op = (((NUM_NODE *)tn->left)->value <=
-	((NUM_NODE *)tn->right)->value) ? true_op : false_op ;
+	((NUM_NODE *)tn->right)->value) ? bert_ctx->true_op : bert_ctx->false_op ;
     break;
  case 23:		/* raise to power */
     ((NUM_NODE *)answer)->value = pow(((NUM_NODE *)tn->left)->value,
@@ -257,11 +251,11 @@ switch(which) {
 	(NAME_NODE *)(tn->left), (NAME_NODE *)(tn->right));
     break;
  case 31:		/* trace */
-    ((NUM_NODE *)answer)->value = verbose;
-    verbose = (((NUM_NODE *)tn->right)->value);
+    ((NUM_NODE *)answer)->value = bert_ctx->verbose;
+    bert_ctx->verbose = (((NUM_NODE *)tn->right)->value);
     break;
  case 40:		/* draw a line */
-    answer->op = true_op;
+    answer->op = bert_ctx->true_op;
     draw_line(
      ((NUM_NODE *)((TERM_NODE *)((TERM_NODE *)tn->left)->left)->left)->value,
      ((NUM_NODE *)((TERM_NODE *)((TERM_NODE *)tn->left)->left)->right)->value,
@@ -269,7 +263,7 @@ switch(which) {
      ((NUM_NODE *)((TERM_NODE *)((TERM_NODE *)tn->left)->right)->right)->value);
     break;
  case 41:		/* draw a string centered at a location */
-    answer->op = true_op;
+    answer->op = bert_ctx->true_op;
     draw_string(
      ((STR_NODE *)((TERM_NODE *)tn->left)->left)->value,
      ((NUM_NODE *)((TERM_NODE *)((TERM_NODE *)tn->left)->right)->left)->value,
@@ -277,6 +271,21 @@ switch(which) {
     break;
 
 /* USER DEFINED PRIMITIVES GO HERE */
+ case 64:		/* add linear expressions */
+    node_free(answer);
+    return lx_add(tn);
+ case 65:		/* multiply a linear expression by a constant */
+    node_free(answer);
+    return lx_scale(tn);
+ case 66:		/* replace a bound variable in a linear expression */
+    node_free(answer);
+    return lx_substitute(tn);
+ case 67:		/* solve the linear equations in a ; chain */
+    node_free(answer);
+    return lx_solve(tn);
+ case 68:		/* record the domain of an intvar */
+    node_free(answer);
+    return fd_declare(tn);
 
 /* End of user defined primitives */
 
@@ -290,9 +299,9 @@ switch(which) {
 /* If a answer->op has not been assigned, assume that the answer is */
 /* a number, and set answer->op depending upon its sign. */
 if (NULL == answer->op) {	/* if null, then must be numeric */
-    if (((NUM_NODE *)answer)->value == 0.0) answer->op = znum_prim;
+    if (((NUM_NODE *)answer)->value == 0.0) answer->op = bert_ctx->znum_prim;
     else answer->op = (((NUM_NODE *)answer)->value > 0.0) ?
-	pnum_prim : nnum_prim ;
+	bert_ctx->pnum_prim : bert_ctx->nnum_prim ;
     }
 
 return answer;
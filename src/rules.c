@@ -5,7 +5,6 @@
  ************************************************************/
 
 #include "def.h"
-int label_count;		/* number of label names in a rule */
 
 /*****************************************************************
  *
@@ -36,16 +35,13 @@ static int
 more_specific(A, B)
 NODE *A, *B;
 {
-extern OP *untyped_prim;	/* from primitive.c */
-extern OP *undeclared_prim;	/* from primitive.c */
-extern OP *positive_type, *nonzero_type;	/* from primitive.c */
 register OP *opa = A->op;
 register OP *opb = B->op;
 register OP *sop;
 
 if (opa != opb) {
-    if (opb == untyped_prim) return 1;
-    if (opa == untyped_prim) return -1;
+    if (opb == bert_ctx->untyped_prim) return 1;
+    if (opa == bert_ctx->untyped_prim) return -1;
     for (sop = opa->super; sop; sop = sop->super) if (sop == opb) return 1;
     for (sop = opb->super; sop; sop = sop->super) if (sop == opa) return -1;
     if (opb->arity == OP_NAME && opa->arity != OP_NAME) return 1;
@@ -66,6 +62,30 @@ if ((opa->arity & BINARY) || (opa->arity & UNARY)) {
 return 0;
 }
 
+/************************************************************
+ *
+ * Count the uses of the parameters of a rule in its body: each
+ * name in the head is marked with uses 1, and then each time it
+ * is found in the body adds 1.  A parameter with uses 2 is moved
+ * into the body by instantiate (match.c), rather than copied.
+ *
+ ************************************************************/
+static void
+uses_count(exp, head)
+register NODE *exp;
+int head;		/* marking the head, not counting the body */
+{
+while (exp->op->arity & (BINARY | UNARY)) {
+    if (exp->op->arity & BINARY) uses_count(((TERM_NODE *) exp)->left, head);
+    exp = (exp->op->arity == POSTFIX) ? ((TERM_NODE *) exp)->left :
+	((TERM_NODE *) exp)->right;
+    }
+if (exp->op->arity == OP_NAME) {
+    if (head) ((NAME_NODE *) exp)->uses = 1;
+    else if (((NAME_NODE *) exp)->uses) ((NAME_NODE *) exp)->uses++;
+    }
+}
+
 /************************************************************
  *
  * Build a rule, and insert it as the hash value of the
@@ -87,7 +107,6 @@ void rule_print();		/* forward reference */
 register RULE *rr;
 RULE *cr, *pr = NULL;		/* used to insert rule into list */
 int cmp;
-static int rule_verbose = -1;
 
 if (!(head->op->arity & OP_TERM)) {
     error("head of rule must be an expression");
@@ -97,15 +116,19 @@ rr->head = head;
 rr->body = body;
 rr->tag = tag;
 rr->space = names;
-rr->size = label_count;		/* number of label names */
+rr->size = bert_ctx->label_count;		/* number of label names */
+rr->level = bert_ctx->level;		/* for region_release */
+rr->fired = 0;
+uses_count(head, TRUE);
+uses_count(body, FALSE);
 
-if (rule_verbose == -1) rule_verbose = verbose;
-if (rule_verbose) {
+if (bert_ctx->rule_verbose == -1) bert_ctx->rule_verbose = bert_ctx->verbose;
+if (bert_ctx->rule_verbose) {
     rr->verbose = 1;
     rule_print(rr);
     }
 else rr->verbose = 0;
-rule_verbose = verbose;
+bert_ctx->rule_verbose = bert_ctx->verbose;
 
 cr = head->op->hash;
 if (cr == NULL) {	/* no rules for this op */
@@ -131,16 +154,14 @@ return rr;
 /************************************************************
  *
  * Free a rule.
+ * The head, body and name space are expression nodes, which are
+ * reclaimed all at once with the rest of the node memory of the
+ * context (the name space may still point into the subject).
  *
  ************************************************************/
 void rule_free(rr)
 RULE *rr;
 {
-void expr_free();	/* from expr.c */
-
-expr_free(rr->head);
-expr_free(rr->body);
-name_free(rr->space);
 free((char *)rr);
 }
 
@@ -165,3 +186,65 @@ fprintf(stderr, " NAMESPACE: ");
 name_space_print(rp->space);
 fprintf(stderr, "\n");
 }
+
+/************************************************************
+ *
+ * Count how often rules fire.
+ * walk() bumps the count of a rule each time it is used.
+ * rule_fired_reset starts the counts over for a new program,
+ * and rule_top prints the n rules that have fired most often,
+ * to show where a program that ran out of steps was spinning.
+ *
+ ************************************************************/
+static void
+fired_reset(rr)
+RULE *rr;
+{
+rr->fired = 0;
+}
+
+void
+rule_fired_reset()
+{
+void op_rules_apply();		/* from ops.c */
+
+op_rules_apply(fired_reset);
+}
+
+static void
+fired_rank(rr)
+RULE *rr;
+{
+register BERT_CTX *ctx = bert_ctx;
+register int i;
+
+if (!rr->fired) return;
+if (ctx->ntop == ctx->maxtop && rr->fired <= ctx->top[ctx->ntop - 1]->fired)
+    return;
+if (ctx->ntop < ctx->maxtop) ctx->ntop++;
+for (i = ctx->ntop - 1; i > 0 && ctx->top[i - 1]->fired < rr->fired; i--)
+    ctx->top[i] = ctx->top[i - 1];
+ctx->top[i] = rr;
+}
+
+void
+rule_top(n)
+int n;		/* how many rules to print */
+{
+void op_rules_apply();		/* from ops.c */
+void expr_print();		/* from expr.c */
+register BERT_CTX *ctx = bert_ctx;
+register int i;
+
+ctx->ntop = 0;
+ctx->maxtop = (n < MAXTOP) ? n : MAXTOP;
+if (ctx->maxtop < 1) return;
+op_rules_apply(fired_rank);
+for (i = 0; i < ctx->ntop; i++) {
+    fprintf(ctx->out, "%8ld  ", ctx->top[i]->fired);
+    expr_print(ctx->top[i]->head);
+    fprintf(ctx->out, " { ");
+    expr_print(ctx->top[i]->body);
+    fprintf(ctx->out, " }\n");
+    }
+}
@@ -9,34 +9,17 @@
 #include "def.h"
 
 /* global values returned by the scanner */
-double token_val;		/* value of numeric token */
-char token_prval[MAXTOKEN + 1];	/* print value of token */
-OP *token_op;			/* operator node for operator token */
 
 /* globals for printing informative error messages */
-int lineno = 1;			/* current line number */
-int charno = 0;			/* position in current line */
 
 /* input file pointers */
-FILE *infile;			/* default to standard input */
-char *infilename;		/* input file name */
 
 /* used for #include file stacks */
-int filespushed = 0;		/* depth of #includes */
-FILE *infiles[MAXFILES];	/* #include file pointers */
-char *infilenames[MAXFILES];	/* #include file names */
-int inlinenos[MAXFILES];	/* line numbers */
-int verboses[MAXFILES];		/* verbose flags */
 
 /* lists of user defined operators, from ops.c */
-extern OP *single_op;		/* list of single-character operators */
-extern OP *double_op;		/* list of two character operators */
-extern OP *name_op;		/* list of alphanumeric operators */
-extern OP *type_op;		/* list of types */
 
 /* handle preprocessor statements */
 extern void preprocess();	/* from prep.c */
-extern void char_free();	/* from util.c */
 
 /*  Character input class translations:	*/
 /*  These definitions are in def.h */
@@ -158,9 +141,9 @@ int
 scan()
 {
 
-/* static variables, initial values used only first time scanner called */
-static int class = C_NL;	/* input char class, initially newline */
-static int c = '\n';		/* last character read */
+/* kept in the context between calls, initially newline */
+register int class = bert_ctx->scan_class;	/* input char class */
+register int c = bert_ctx->scan_c;		/* last character read */
 
 /* these variables are reinitialized every time scanner is called */
 register int state = ST;	/* current state, initially start */
@@ -181,12 +164,12 @@ fflush(stdout);
 #endif
 
    switch(atab[state][class]) {	/* perform action */
-	case AA: L1: token_prval[tlength++] = c;	/* add */
+	case AA: L1: bert_ctx->token_prval[tlength++] = c;	/* add */
 		 if (tlength>MAXTOKEN) tlength = MAXTOKEN;
 		 /* fall through */
-	case AE: c = getc(infile);			/* eat */
-		 if (C_NL==trans[c]) { lineno++; charno = 0; }
-		 else charno++;
+	case AE: c = getc(bert_ctx->infile);			/* eat */
+		 if (C_NL==trans[c]) { bert_ctx->lineno++; bert_ctx->charno = 0; }
+		 else bert_ctx->charno++;
 		 /* fall through */
 	case AU: break;			/* do nothing for unget */
 	case AN: fvalue = (fvalue * 10) + (c-'0');	/* numeric */
@@ -207,44 +190,45 @@ fflush(stdout);
 		 goto L1;	/* add character */
 	case AS:		/* check for special operator */
 	    /* see if *token_prval and c form a double operator */
-	    for (token_op = double_op; token_op; token_op = token_op->next) {
-	    	if (*token_prval == token_op->pname[0] && 
-		  c == token_op->pname[1]) 
+	    for (bert_ctx->token_op = bert_ctx->double_op; bert_ctx->token_op; bert_ctx->token_op = bert_ctx->token_op->next) {
+	    	if (*bert_ctx->token_prval == bert_ctx->token_op->pname[0] && 
+		  c == bert_ctx->token_op->pname[1]) 
 		    goto L1;	/* found, do add action */
 	        }
 	    /* if not double op, *token_prval must be single char oper */
-	    token_prval[1] = '\0';
+	    bert_ctx->token_prval[1] = '\0';
 #	    ifdef DEBUG
 	    printf("\tchange state to %d\n", TO);
 	    fflush(stdout);
 #	    endif
+	    bert_ctx->scan_class = class;
+	    bert_ctx->scan_c = c;
 	    goto L2;		/* exit to terminal state TO */
 	case AP:		/* interpret preprocessor statement */
-	    token_prval[tlength++] = '\n';
-	    token_prval[tlength] = '\0';
+	    bert_ctx->token_prval[tlength++] = '\n';
+	    bert_ctx->token_prval[tlength] = '\0';
 	    preprocess();
 	    /* fall through */
 	case AR:		/* restart, throw away token */
 	    tlength = 0;
 	    break;		/* unget */
 	case AC:		/* end of file */
-	    if (filespushed) {
-		fclose(infile);
-		filespushed--;
-		char_free(infilename);	/* free character string */
-		infile = infiles[filespushed];
-		infilename = infilenames[filespushed];
-		lineno = inlinenos[filespushed];
-		verbose = verboses[filespushed];
+	    if (bert_ctx->filespushed) {
+		fclose(bert_ctx->infile);
+		bert_ctx->filespushed--;
+		bert_ctx->infile = bert_ctx->infiles[bert_ctx->filespushed];
+		bert_ctx->infilename = bert_ctx->infilenames[bert_ctx->filespushed];
+		bert_ctx->lineno = bert_ctx->inlinenos[bert_ctx->filespushed];
+		bert_ctx->verbose = bert_ctx->verboses[bert_ctx->filespushed];
 		c = '\n';
-		charno = 0;
+		bert_ctx->charno = 0;
 #		ifdef DEBUG
-		printf("back to file %s, line %d\n", infilename, lineno);
+		printf("back to file %s, line %d\n", bert_ctx->infilename, bert_ctx->lineno);
 #		endif
 		}
 	    else {
-		class = C_NL;
-		c = '\n';
+		bert_ctx->scan_class = C_NL;
+		bert_ctx->scan_c = '\n';
 		return EOF;
 		}
 
@@ -260,11 +244,13 @@ printf(" next class %d\n", class);
 fflush(stdout);
 #endif
   }	/* if you leave this loop, you have a token */
+bert_ctx->scan_class = class;
+bert_ctx->scan_c = c;
 
-token_prval[tlength] = '\0';	/* null terminate token print name */
+bert_ctx->token_prval[tlength] = '\0';	/* null terminate token print name */
 
 #ifdef DEBUG
-printf("terminal state %d, token is '%s'\n", state, token_prval);
+printf("terminal state %d, token is '%s'\n", state, bert_ctx->token_prval);
 fflush(stdout);
 #endif
 
@@ -277,36 +263,36 @@ if (tlength > MAXTOKEN) switch(state) {
 
 switch(state) {
  case TI:	/* identifier (could be a name operator) */
-	if (*token_prval == '\'') {	/* a type */
-	    for (token_op = type_op; token_op; token_op = token_op->next) {
-		if (strcmp(token_prval+1, token_op->pname) == 0) return TYPE;
+	if (*bert_ctx->token_prval == '\'') {	/* a type */
+	    for (bert_ctx->token_op = bert_ctx->type_op; bert_ctx->token_op; bert_ctx->token_op = bert_ctx->token_op->next) {
+		if (strcmp(bert_ctx->token_prval+1, bert_ctx->token_op->pname) == 0) return TYPE;
 		}
-	    fprintf(stderr, "type name %s not declared\n", token_prval);
+	    fprintf(stderr, "type name %s not declared\n", bert_ctx->token_prval);
 	    error("invalid type");
 	    }
-	for (token_op = name_op; token_op; token_op = token_op->next) {
-	    if (strcmp(token_prval, token_op->pname) == 0) return OPER;
+	for (bert_ctx->token_op = bert_ctx->name_op; bert_ctx->token_op; bert_ctx->token_op = bert_ctx->token_op->next) {
+	    if (strcmp(bert_ctx->token_prval, bert_ctx->token_op->pname) == 0) return OPER;
 	    }
 	/* otherwise */ return IDENT;
 
  case TO:	/* single character operator */
 	L2:	/* came from AS */
-	for (token_op = single_op; token_op; token_op = token_op->next) {
-	   if (*token_prval == token_op->pname[0]) return OPER;
+	for (bert_ctx->token_op = bert_ctx->single_op; bert_ctx->token_op; bert_ctx->token_op = bert_ctx->token_op->next) {
+	   if (*bert_ctx->token_prval == bert_ctx->token_op->pname[0]) return OPER;
 	   }
 	/* error, special char that is not an operator */
-	fprintf(stderr, "character is: '%c'\n", *token_prval);
+	fprintf(stderr, "character is: '%c'\n", *bert_ctx->token_prval);
 	error("invalid character");
  case T2:	/* two character operator */
 	/* token_op was set in AS above */
 	return OPER;
  case TN:	/* number */
-	token_val = fvalue;
+	bert_ctx->token_val = fvalue;
 	return NUMBER;
  case TS:	/* string */
 	return STRING;
  case XR: 	/* reserved character . { } */
-	return (int) *token_prval;
+	return (int) *bert_ctx->token_prval;
  case EC:
 	error("illegal character");
  case EN:
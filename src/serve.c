@@ -0,0 +1,328 @@
+/***********************************************************************
+ *
+ * Solver daemon.
+ *
+ * "bert --serve <socket>" listens on a local (UNIX domain) socket.
+ * The libraries named with --include are loaded once, when the
+ * daemon starts.  Each connection sends the text of one program,
+ * and then closes its end for writing (shutdown).  The program is
+ * loaded on top of the libraries and its subject is rewritten, and
+ * the daemon sends back either
+ *
+ *	ok
+ *	<final expression>
+ *	<global name> = <value>		.. a line for each bound name
+ *
+ * or a single line "error <message>" or "limit <message>".
+ * The connection is then closed, and everything the program added
+ * to the context (nodes, operators, rules, names) is taken back out
+ * before the next request.  The step and time limits given with
+ * --steps and --time apply to each request.
+ *
+ * Requests are handled one at a time.  SIGINT or SIGTERM stops the
+ * daemon and removes the socket.
+ *
+ * With --fork, the daemon is a fork server: it fork()s a child for
+ * each connection, and the child inherits the operator tables and
+ * rules of the libraries (copy on write), parses only the program,
+ * replies and exits.  Nothing has to be taken back out afterwards,
+ * a program that crashes takes only its child with it, and requests
+ * are handled in parallel.
+ *
+ * "bert --send <socket> [file ...]" is a client: it sends each file
+ * (or the standard input) to the daemon as a separate request, and
+ * copies the replies to the standard output.
+ *
+ ***********************************************************************/
+
+#include "def.h"
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <errno.h>
+#include <unistd.h>
+
+#define BACKLOG 16		/* connections waiting to be accepted */
+#define READ_TIMEOUT 30		/* seconds to wait for program text */
+
+static volatile sig_atomic_t stopped;	/* signal that asked the daemon to stop */
+
+static void
+stop(sig)
+int sig;
+{
+stopped = sig;
+}
+
+/***********************************************************************
+ *
+ * Print the bound names in a name space, one per line.
+ *
+ ***********************************************************************/
+static void
+bindings_print(nn)
+NAME_NODE *nn;		/* first name in space */
+{
+void qname_print();		/* from names.c */
+void expr_print();		/* from expr.c */
+
+for (; nn; nn = nn->next) {
+    if (nn->value) {
+	qname_print(nn);
+	fprintf(bert_ctx->out, " = ");
+	expr_print(nn->value);
+	fprintf(bert_ctx->out, "\n");
+	}
+    if (nn->child) bindings_print(nn->child);
+    }
+}
+
+/***********************************************************************
+ *
+ * Send a one line reply, with the message on the same line.
+ *
+ ***********************************************************************/
+static void
+reply(out, status, msg)
+FILE *out;
+char *status;		/* error or limit */
+char *msg;
+{
+while (*msg == '\n' || *msg == ' ') msg++;
+fprintf(out, "%s ", status);
+for (; *msg; msg++) putc(*msg == '\n' ? ' ' : *msg, out);
+putc('\n', out);
+}
+
+/***********************************************************************
+ *
+ * Handle one connection.
+ *
+ ***********************************************************************/
+static void
+serve_request(ctx, fd, n, reset)
+BERT_CTX *ctx;
+int fd;			/* connected socket */
+long n;			/* request number, for messages */
+int reset;		/* take the program back out afterwards? */
+{
+int ctx_load();			/* from ctx.c */
+int ctx_solve();		/* from ctx.c */
+void ctx_reset();		/* from ctx.c */
+void expr_print();		/* from expr.c */
+void stats_print();		/* from stats.c */
+struct timeval tv;
+FILE *in, *out;
+char name[40];
+int rc;
+
+tv.tv_sec = READ_TIMEOUT;
+tv.tv_usec = 0;
+setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, (char *) &tv, sizeof(tv));
+in = fdopen(fd, "r");
+out = fdopen(dup(fd), "w");
+if (!in || !out) {
+    perror("bert: fdopen");
+    if (in) fclose(in);
+    else close(fd);
+    if (out) fclose(out);
+    return;
+    }
+
+sprintf(name, "request %ld", n);
+rc = ctx_load(ctx, in, name);
+if (BERT_OK == rc) rc = ctx_solve(ctx);
+else while (EOF != getc(in)) ;	/* read the rest before replying */
+
+if (BERT_OK == rc) {
+    fprintf(out, "ok\n");
+    ctx->out = out;
+    expr_print(ctx->subject);
+    fprintf(out, "\n");
+    bindings_print(ctx->global_names->child);
+    ctx->out = stderr;
+    }
+else reply(out, (BERT_LIMIT == rc) ? "limit" : "error", ctx->error_msg);
+if (statistics) stats_print(name);
+
+if (reset) ctx_reset(ctx);	/* back to just the libraries */
+fclose(out);
+fclose(in);
+}
+
+/***********************************************************************
+ *
+ * Handle one connection in a child process.
+ * If the fork fails, the request is handled by the daemon itself.
+ *
+ ***********************************************************************/
+static void
+fork_request(ctx, sock, fd, n)
+BERT_CTX *ctx;
+int sock;		/* listening socket, closed in the child */
+int fd;			/* connected socket */
+long n;			/* request number, for messages */
+{
+pid_t pid;
+
+fflush(stdout);		/* or the child would write it again */
+fflush(stderr);
+pid = fork();
+if (0 == pid) {
+    close(sock);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    serve_request(ctx, fd, n, FALSE);
+    fflush(stderr);
+    _exit(0);
+    }
+if (pid < 0) {
+    perror("bert: fork");
+    serve_request(ctx, fd, n, TRUE);
+    return;
+    }
+close(fd);
+}
+
+/***********************************************************************
+ *
+ * Fill in a socket address.
+ *
+ * returns:	FALSE if the path is too long
+ *
+ ***********************************************************************/
+static int
+address(addr, path)
+struct sockaddr_un *addr;
+char *path;		/* socket file name */
+{
+if (strlen(path) >= sizeof(addr->sun_path)) {
+    fprintf(stderr, "socket name too long: %s\n", path);
+    return FALSE;
+    }
+memset((char *) addr, 0, sizeof(*addr));
+addr->sun_family = AF_UNIX;
+strcpy(addr->sun_path, path);
+return TRUE;
+}
+
+/***********************************************************************
+ *
+ * Run the daemon on the socket path, with the libraries already
+ * loaded into ctx.  Returns when stopped by a signal.
+ *
+ * returns:	exit status for main
+ *
+ ***********************************************************************/
+int
+serve(ctx, path, forking)
+BERT_CTX *ctx;
+char *path;		/* socket file name */
+int forking;		/* a child process for each request? */
+{
+struct sockaddr_un addr;
+struct sigaction sa;
+int sock, fd;
+long n = 0;
+
+if (!address(&addr, path)) return 1;
+
+sock = socket(AF_UNIX, SOCK_STREAM, 0);
+if (sock < 0) {
+    perror("bert: socket");
+    return 1;
+    }
+unlink(path);
+if (bind(sock, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+  listen(sock, BACKLOG) < 0) {
+    perror(path);
+    close(sock);
+    return 1;
+    }
+
+/* no SA_RESTART, so that accept returns when stopped */
+memset((char *) &sa, 0, sizeof(sa));
+sa.sa_handler = stop;
+sigemptyset(&sa.sa_mask);
+sigaction(SIGINT, &sa, (struct sigaction *) NULL);
+sigaction(SIGTERM, &sa, (struct sigaction *) NULL);
+signal(SIGPIPE, SIG_IGN);	/* clients may go away early */
+if (forking) {		/* children are not waited for */
+    sa.sa_handler = SIG_IGN;
+    sa.sa_flags = SA_NOCLDWAIT;
+    sigaction(SIGCHLD, &sa, (struct sigaction *) NULL);
+    }
+
+fprintf(stderr, "bert: %s on %s\n",
+    forking ? "fork server" : "serving", path);
+while (!stopped) {
+    fd = accept(sock, (struct sockaddr *) NULL, (socklen_t *) NULL);
+    if (fd < 0) {
+	if (EINTR == errno || ECONNABORTED == errno) continue;
+	perror("bert: accept");
+	break;
+	}
+    if (forking) fork_request(ctx, sock, fd, ++n);
+    else serve_request(ctx, fd, ++n, TRUE);
+    }
+close(sock);
+unlink(path);
+return stopped ? 0 : 1;
+}
+
+/***********************************************************************
+ *
+ * Send one program to a daemon, and copy the reply to stdout.
+ *
+ * returns:	0 if the reply was ok, else 1
+ *
+ ***********************************************************************/
+int
+send_program(path, fp)
+char *path;		/* socket file name */
+FILE *fp;		/* program */
+{
+struct sockaddr_un addr;
+char buf[BUFSIZ];
+FILE *in;
+size_t n;
+int sock, ok;
+
+if (!address(&addr, path)) return 1;
+sock = socket(AF_UNIX, SOCK_STREAM, 0);
+if (sock < 0) {
+    perror("bert: socket");
+    return 1;
+    }
+if (connect(sock, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+    perror(path);
+    close(sock);
+    return 1;
+    }
+signal(SIGPIPE, SIG_IGN);	/* the daemon may reply early */
+
+while (0 < (n = fread(buf, 1, sizeof(buf), fp)))
+    if (write(sock, buf, n) != (ssize_t) n) break;
+shutdown(sock, SHUT_WR);
+
+in = fdopen(sock, "r");
+if (!in) {
+    perror("bert: fdopen");
+    close(sock);
+    return 1;
+    }
+if (NULL == fgets(buf, sizeof(buf), in)) {
+    fprintf(stderr, "%s: no reply\n", path);
+    fclose(in);
+    return 1;
+    }
+ok = (0 == strcmp(buf, "ok\n"));
+do fputs(buf, stdout);
+while (NULL != fgets(buf, sizeof(buf), in));
+fflush(stdout);
+fclose(in);
+return ok ? 0 : 1;
+}
@@ -0,0 +1,136 @@
+/***********************************************************************
+ *
+ * Incremental sessions.
+ *
+ * "bert --session" reads a series of inputs from the standard input,
+ * each ended by a line holding only a period (or by the end of the
+ * input).  An input is parsed on top of the libraries and all of the
+ * inputs before it (see ctx_extend in ctx.c), so operators, types
+ * and rules stay defined, and global names that were bound stay
+ * bound.  An input may define a new main rule; its body is then
+ * rewritten against the global names left by the earlier inputs,
+ * e.g.
+ *
+ *	#include beep
+ *	main { x: aNumber; y: aNumber; x + y = 10 }
+ *	.
+ *	main { x - y = 2; x }
+ *	.
+ *
+ * answers 6 to the second input: the constraints that an input
+ * leaves unsolved are put in front of the next main rule (see
+ * residual in ctx.c), here x + y = 10.
+ * An input that only changes edit variables (see edit.c),
+ *
+ *	#edit width 5
+ *	.
+ *
+ * answers from the solved form of the last main rule.
+ *
+ * For each input, the standard output gets
+ *
+ *	ok
+ *	<final expression>		.. only if the input had a main rule
+ *	.
+ *
+ * or a line "error <message>" or "limit <message>" and then the
+ * period, and the session goes on.  An input that fails to parse is
+ * taken back out, as if it had never been read.  If rewriting fails
+ * or runs out of steps or time, the names bound until then stay
+ * bound, but the constraints left unsolved are dropped (see
+ * ctx_extend).
+ *
+ ***********************************************************************/
+
+#include "def.h"
+
+#define MAXLINE 1024
+
+/***********************************************************************
+ *
+ * Copy the next input to a temporary file.
+ *
+ * returns:	the file, positioned at its start, or NULL at the end
+ *		of the session input
+ *
+ ***********************************************************************/
+static FILE *
+read_input(in)
+FILE *in;
+{
+char line[MAXLINE];
+FILE *tmp;
+int lines = 0;
+
+tmp = tmpfile();
+if (!tmp) {
+    perror("bert: tmpfile");
+    return (FILE *) NULL;
+    }
+while (NULL != fgets(line, MAXLINE, in)) {
+    if (0 == strcmp(line, ".\n") || 0 == strcmp(line, ".")) {
+	lines++;
+	break;
+	}
+    fputs(line, tmp);
+    lines++;
+    }
+if (!lines) {		/* end of session */
+    fclose(tmp);
+    return (FILE *) NULL;
+    }
+rewind(tmp);
+return tmp;
+}
+
+/***********************************************************************
+ *
+ * Run a session on the standard input, with the libraries already
+ * loaded into ctx.
+ *
+ * returns:	exit status for main, 1 if any input failed
+ *
+ ***********************************************************************/
+int
+session(ctx)
+BERT_CTX *ctx;
+{
+int ctx_extend();		/* from ctx.c */
+int ctx_solve();		/* from ctx.c */
+void expr_print();		/* from expr.c */
+void stats_print();		/* from stats.c */
+char name[40];
+FILE *fp;
+char *msg;
+long n = 0;
+int rc, status = 0;
+
+while ((fp = read_input(stdin))) {
+    sprintf(name, "input %ld", ++n);
+    rc = ctx_extend(ctx, fp, name);
+    if (BERT_OK == rc && (ctx->subject || (ctx->solved && ctx->edits_changed)))
+	rc = ctx_solve(ctx);
+    fclose(fp);
+
+    if (BERT_OK == rc) {
+	printf("ok\n");
+	if (ctx->subject) {
+	    ctx->out = stdout;
+	    expr_print(ctx->subject);
+	    printf("\n");
+	    ctx->out = stderr;
+	    }
+	}
+    else {
+	for (msg = ctx->error_msg; *msg == '\n' || *msg == ' '; msg++) ;
+	printf("%s ", (BERT_LIMIT == rc) ? "limit" : "error");
+	for (; *msg; msg++) putchar(*msg == '\n' ? ' ' : *msg);
+	putchar('\n');
+	status = 1;
+	}
+    printf(".\n");
+    fflush(stdout);
+    if (statistics) stats_print(name);
+    }
+return status;
+}
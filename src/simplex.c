@@ -0,0 +1,565 @@
+/***********************************************************************
+ *
+ * Linear inequalities and optimization, by the simplex method.
+ *
+ * The relations of bops only decide a < b and a <= b on constants,
+ * so an inequality over variables just sits in the answer.  Here,
+ * once no rule matches the subject any more, the constraints of its
+ * top level ; chain are taken together as a linear program:
+ *
+ *	a <= b, a < b		inequalities (a >= b and a > b are
+ *				turned around by the rules of bops)
+ *	a = b			equations that are left
+ *	minimize e, maximize e	an objective (the first one found)
+ *
+ * where each side is a number, a numvar, or a linear expression of
+ * beep (see lx.c), so that b - a is a run of (variable, coefficient)
+ * pairs plus a constant.  Constraints with anything else in them are
+ * left to the rules.
+ *
+ *	- If the constraints cannot all hold, false is put at the front
+ *	  of the chain.  Strict inequalities are checked for a point
+ *	  where every one of them holds strictly.
+ *	- Otherwise, if there is an objective, the variables are bound
+ *	  to a point where it is least (or greatest), the constraints
+ *	  and the objective are replaced by true, and rewriting goes
+ *	  on.  If the objective has no least value (it is unbounded,
+ *	  or only approached at the edge of a strict inequality), it
+ *	  is left in the answer.
+ *	- Otherwise the inequalities are left in the answer, as they
+ *	  were, since any point that satisfies them will do.
+ *
+ * This is done only when rewriting has stopped, rather than by a
+ * rule, because a rule that matched an inequality would have to take
+ * it out of the subject for the rules to stop: there would be nothing
+ * to show for one that is still open.  By then, too, each of the
+ * equations that could be solved has been (by linsolve.c), and what
+ * is left of the program is known.
+ *
+ * The tableau is dense, and the variables are free, so each is the
+ * difference of two that are not negative.  Phase one minimizes the
+ * sum of an artificial variable for each row.  Pivots are taken by
+ * the most negative reduced cost, and by Bland's rule once they stop
+ * making progress, so that they cannot cycle.
+ *
+ * While a program with edit variables is first being solved (see
+ * edit.c), they are free, and nothing is done here: the inequalities
+ * are solved once the edit variables have their values.
+ *
+ ***********************************************************************/
+
+#include "def.h"
+#include <math.h>
+
+#define EPSILON	1e-9	/* a value this close to zero is taken as zero */
+
+/* from other modules */
+double lx_run();		/* from lx.c */
+int lx_tidy();			/* from lx.c */
+void lx_put();			/* from lx.c */
+NODE *lx_number();		/* from lx.c */
+NODE *lx_term();		/* from lx.c */
+int lx_order();			/* from lx.c */
+NODE *node_new();		/* from expr.c */
+NODE *expr_update();		/* from expr.c */
+void expr_free();		/* from expr.c */
+double stats_clock();		/* from stats.c */
+void ac_normal();		/* from ac.c */
+void cycle_rehash();		/* from cycle.c */
+OP *op_find();			/* from ops.c */
+void free();
+
+/* a constraint 0 rel t[0] + ... + t[n-1] + k */
+typedef struct con {
+	NODE **at;		/* the conjunct it was made from */
+	LX_TERM *t;		/* terms, sorted by variable */
+	int n;			/* number of terms */
+	double k;		/* constant */
+	int rel;		/* '=', '<' or 'l' (<=) */
+	} CON;
+
+/* the linear program */
+typedef struct lp {
+	int m, w;		/* rows, and columns with the right side */
+	double *tab;		/* (m + 1) by w, the objective last */
+	int *basis;		/* the basic column of each row */
+	int strict;		/* column of the least strict slack, or -1 */
+	int art;		/* first artificial column */
+	} LP;
+
+#define T(lp, i, j)	((lp)->tab[(i) * (lp)->w + (j)])
+#define RHS(lp, i)	T(lp, i, (lp)->w - 1)
+
+#define space(n)	mem_get((size_t) (n), "linear inequalities")
+
+/***********************************************************************
+ *
+ * If a relation is linear, make it into a constraint 0 rel rhs - lhs.
+ *
+ * returns:	TRUE if it is linear
+ *
+ ***********************************************************************/
+static int
+linear(at, c, rel, plus, times, numvar)
+NODE **at;		/* a conjunct of the ; chain */
+CON *c;			/* constraint to fill in */
+int rel;
+OP *plus, *times, *numvar;
+{
+register TERM_NODE *tn = (TERM_NODE *) *at;
+register LX_TERM *t;
+int n1, n2;
+
+bert_ctx->lx_nterms = 0;
+c->k = lx_run(tn->right, 1.0, plus, times, &n1);
+c->k += lx_run(tn->left, -1.0, plus, times, &n2);
+for (t = bert_ctx->lx_terms; t < bert_ctx->lx_terms + n1 + n2; t++)
+    if (t->var->op != numvar) return FALSE;
+c->n = lx_tidy(0);
+if (!c->n) return FALSE;	/* constant, for the rules */
+c->at = at;
+c->rel = rel;
+c->t = (LX_TERM *) space(c->n * sizeof(LX_TERM));
+memcpy((char *) c->t, (char *) bert_ctx->lx_terms, c->n * sizeof(LX_TERM));
+return TRUE;
+}
+
+/***********************************************************************
+ *
+ * The variables of the constraints and the objective, sorted by
+ * lx_order, and the column of a variable among them.
+ *
+ ***********************************************************************/
+static int
+by_order(a, b)
+NODE **a, **b;
+{
+return lx_order((NAME_NODE *) *a, (NAME_NODE *) *b);
+}
+
+static NODE **
+variables(cons, ncons, nv)
+CON *cons;		/* the constraints, and the objective last */
+int ncons;
+int *nv;		/* number of variables */
+{
+void qsort();
+register CON *c;
+register int i, n = 0;
+NODE **vars;
+
+for (c = cons; c < cons + ncons; c++) n += c->n;
+vars = (NODE **) space(n * sizeof(NODE *));
+n = 0;
+for (c = cons; c < cons + ncons; c++)
+    for (i = 0; i < c->n; i++) vars[n++] = c->t[i].var;
+qsort((char *) vars, n, sizeof(NODE *), by_order);
+for (i = *nv = 0; i < n; i++)
+    if (!*nv || vars[i] != vars[*nv - 1]) vars[(*nv)++] = vars[i];
+return vars;
+}
+
+static int
+column(v, vars, nv)
+NODE *v;
+NODE **vars;
+int nv;
+{
+register int lo = 0, hi = nv - 1, mid, c;
+
+while (lo <= hi) {
+    mid = (lo + hi) / 2;
+    if (0 == (c = lx_order((NAME_NODE *) v, (NAME_NODE *) vars[mid])))
+	return mid;
+    if (c < 0) hi = mid - 1;
+    else lo = mid + 1;
+    }
+error("variable of a linear inequality lost");
+return -1;
+}
+
+/***********************************************************************
+ *
+ * Pivot on row r and column s.
+ *
+ ***********************************************************************/
+static void
+pivot(lp, r, s)
+register LP *lp;
+int r, s;
+{
+register double *row, *pr = &T(lp, r, 0);
+register int j;
+double f = pr[s];
+int i;
+
+for (j = 0; j < lp->w; j++) pr[j] /= f;
+for (i = 0; i <= lp->m; i++) {
+    if (i == r || 0.0 == (f = T(lp, i, s))) continue;
+    row = &T(lp, i, 0);
+    for (j = 0; j < lp->w; j++) row[j] -= f * pr[j];
+    row[s] = 0.0;
+    }
+lp->basis[r] = s;
+}
+
+/***********************************************************************
+ *
+ * Minimize cost . x over the columns before ncols.
+ *
+ * returns:	FALSE if it is unbounded
+ *
+ ***********************************************************************/
+static int
+minimize(lp, cost, ncols)
+register LP *lp;
+double *cost;		/* cost of each column */
+int ncols;		/* columns that may enter the basis */
+{
+register int i, j;
+double *z = &T(lp, lp->m, 0), best, ratio;
+int r, s, stalled = 0;
+
+/* reduced costs, and minus the objective in the right side */
+for (j = 0; j < lp->w; j++) z[j] = (j < lp->w - 1) ? cost[j] : 0.0;
+for (i = 0; i < lp->m; i++) {
+    double cb = cost[lp->basis[i]];
+    if (cb != 0.0)
+	for (j = 0; j < lp->w; j++) z[j] -= cb * T(lp, i, j);
+    }
+
+for (;;) {
+    /* the column to enter: most negative, or first (Bland) */
+    for (s = -1, best = -EPSILON, j = 0; j < ncols; j++)
+	if (z[j] < best) {
+	    s = j;
+	    if (stalled > lp->m) break;
+	    best = z[j];
+	    }
+    if (s < 0) return TRUE;
+
+    /* the row to leave, ties to the least basic column */
+    for (r = -1, i = 0; i < lp->m; i++) {
+	if (T(lp, i, s) <= EPSILON) continue;
+	ratio = RHS(lp, i) / T(lp, i, s);
+	if (r < 0 || ratio < best - EPSILON ||
+	  (ratio <= best + EPSILON && lp->basis[i] < lp->basis[r])) {
+	    best = ratio;
+	    r = i;
+	    }
+	}
+    if (r < 0) return FALSE;
+    stalled = (best <= EPSILON) ? stalled + 1 : 0;
+    pivot(lp, r, s);
+    }
+}
+
+/* the value of a column */
+static double
+value(lp, j)
+register LP *lp;
+int j;
+{
+register int i;
+
+for (i = 0; i < lp->m; i++)
+    if (lp->basis[i] == j) return RHS(lp, i);
+return 0.0;
+}
+
+/***********************************************************************
+ *
+ * Build the tableau.  Variable j is column 2j less column 2j+1,
+ * then come a slack column for each inequality, if there are strict
+ * ones a column for the least of their slacks (which is at most 1)
+ * and its own slack, and an artificial column for each row.
+ *
+ ***********************************************************************/
+static void
+build(lp, cons, ncons, vars, nv)
+register LP *lp;
+CON *cons;
+int ncons;
+NODE **vars;
+int nv;
+{
+register CON *c;
+register int i, j;
+int slack = 2 * nv, nslack = 0, strict = FALSE;
+
+for (c = cons; c < cons + ncons; c++) {
+    if (c->rel != '=') nslack++;
+    if (c->rel == '<') strict = TRUE;
+    }
+lp->strict = strict ? slack + nslack : -1;
+lp->m = ncons + strict;
+lp->art = slack + nslack + 2 * strict;
+lp->w = lp->art + lp->m + 1;
+lp->tab = (double *) space((lp->m + 1) * lp->w * sizeof(double));
+lp->basis = (int *) space(lp->m * sizeof(int));
+for (i = 0; i < (lp->m + 1) * lp->w; i++) lp->tab[i] = 0.0;
+
+for (i = 0, c = cons; c < cons + ncons; i++, c++) {
+    /* 0 rel a.x + k is a.x - s = -k, or a.x - s - least = -k */
+    for (j = 0; j < c->n; j++) {
+	int col = column(c->t[j].var, vars, nv);
+	T(lp, i, 2 * col) = c->t[j].coef;
+	T(lp, i, 2 * col + 1) = -c->t[j].coef;
+	}
+    if (c->rel != '=') T(lp, i, slack++) = -1.0;
+    if (c->rel == '<') T(lp, i, lp->strict) = -1.0;
+    RHS(lp, i) = -c->k;
+    }
+if (strict) {		/* least + s = 1 */
+    T(lp, i, lp->strict) = 1.0;
+    T(lp, i, lp->strict + 1) = 1.0;
+    RHS(lp, i) = 1.0;
+    }
+for (i = 0; i < lp->m; i++) {
+    if (RHS(lp, i) < 0.0)
+	for (j = 0; j < lp->w; j++) T(lp, i, j) = -T(lp, i, j);
+    T(lp, i, lp->art + i) = 1.0;
+    lp->basis[i] = lp->art + i;
+    }
+}
+
+/***********************************************************************
+ *
+ * Phase one, and then the least strict slack as large as it can be.
+ *
+ * returns:	TRUE if the constraints can all hold
+ *
+ ***********************************************************************/
+static int
+feasible(lp, cost)
+register LP *lp;
+double *cost;		/* room for a cost for each column */
+{
+register int i, j;
+
+for (j = 0; j < lp->w; j++) cost[j] = (j >= lp->art) ? 1.0 : 0.0;
+minimize(lp, cost, lp->art + lp->m);
+if (-T(lp, lp->m, lp->w - 1) > EPSILON * lp->m) return FALSE;
+
+/* drive the artificial variables out of the basis */
+for (i = 0; i < lp->m; i++) {
+    if (lp->basis[i] < lp->art) continue;
+    for (j = 0; j < lp->art; j++)
+	if (fabs(T(lp, i, j)) > EPSILON) {
+	    pivot(lp, i, j);
+	    break;
+	    }
+    }
+if (lp->strict < 0) return TRUE;
+
+for (j = 0; j < lp->w; j++) cost[j] = (j == lp->strict) ? -1.0 : 0.0;
+minimize(lp, cost, lp->art);
+return value(lp, lp->strict) > EPSILON;
+}
+
+/***********************************************************************
+ *
+ * A number for a value, rounded if it is nearly a whole number.
+ *
+ ***********************************************************************/
+static NODE *
+number(v)
+double v;
+{
+double r = floor(v + 0.5);
+
+if (fabs(v - r) <= EPSILON * (1.0 + fabs(v))) v = r;
+return lx_number(v == 0.0 ? 0.0 : v);
+}
+
+NODE *
+lp_truth(op)
+OP *op;
+{
+register TERM_NODE *c = (TERM_NODE *) node_new();
+
+c->op = op;
+c->label = (NAME_NODE *) NULL;
+c->left = c->right = (NODE *) NULL;
+return (NODE *) c;
+}
+
+/***********************************************************************
+ *
+ * Replace a conjunct that a solution satisfies by true, and bind the
+ * variables to the solution.  The subject is brought up to date, as
+ * walk() does when a rule binds a variable.  Also used by newton.c,
+ * interval.c, fd.c and boolean.c.
+ *
+ ***********************************************************************/
+void
+lp_satisfied(at)
+NODE **at;
+{
+expr_free(*at);
+*at = lp_truth(bert_ctx->true_op);
+}
+
+/* bring the subject up to date with the variables just bound */
+void
+lp_update()
+{
+register BERT_CTX *ctx = bert_ctx;
+
+ctx->stats.updates++;
+ctx->subject = expr_update(ctx->subject);
+if (ctx->ac_ops) ac_normal(ctx->subject);
+ctx->quiet++;		/* conjuncts were replaced in place */
+if (ctx->cycle_window) cycle_rehash(ctx->subject);
+}
+
+void
+lp_bind(vars, x, nv)
+NODE **vars;		/* free variables */
+double *x;		/* and their values */
+int nv;
+{
+register int j;
+
+for (j = 0; j < nv; j++)
+    ((NAME_NODE *) vars[j])->value = number(x[j]);
+lp_update();
+}
+
+/* put false at the front of the chain: the constraints cannot hold */
+void
+lp_false()
+{
+register BERT_CTX *ctx = bert_ctx;
+
+ctx->subject = lx_term(op_find(ctx->single_op, ";", BINARY),
+    lp_truth(ctx->false_op), ctx->subject);
+if (ctx->cycle_window) cycle_rehash(ctx->subject);
+}
+
+/***********************************************************************
+ *
+ * Solve the inequalities of the subject.
+ *
+ * returns:	TRUE if the subject was changed
+ *
+ ***********************************************************************/
+int
+simplex()
+{
+register BERT_CTX *ctx = bert_ctx;
+register CON *c;
+OP *semi, *le, *lt, *equal, *plus, *times, *numvar, *least, *most;
+CON *cons, obj;
+NODE **vars, **at, *x, **goal = NULL;
+LP lp;
+double *cost, start;
+int ncons, size, nv, i, j;
+int inequalities = FALSE, changed = FALSE;
+
+if (!ctx->subject || (ctx->nedits && !ctx->solved)) return FALSE;
+semi = op_find(ctx->single_op, ";", BINARY);
+le = op_find(ctx->double_op, "<=", BINARY);
+lt = op_find(ctx->single_op, "<", BINARY);
+equal = op_find(ctx->single_op, "=", BINARY);
+plus = op_find(ctx->double_op, "++", BINARY);
+times = op_find(ctx->double_op, "**", BINARY);
+numvar = op_find(ctx->type_op, "numvar", 0);
+least = op_find(ctx->name_op, "minimize", PREFIX);
+most = op_find(ctx->name_op, "maximize", PREFIX);
+if (!semi || !le || !lt || !equal || !plus || !times || !numvar) return FALSE;
+
+/* collect the constraints of the chain, and the objective */
+start = stats_clock();
+cons = (CON *) space((size = 16) * sizeof(CON));
+ncons = 0;
+for (at = &ctx->subject; ; at = &((TERM_NODE *) *at)->right) {
+    NODE **conj = ((*at)->op == semi) ? &((TERM_NODE *) *at)->left : at;
+    x = *conj;
+    if (ncons + 1 == size) {	/* room for the objective too */
+	void *realloc();
+	cons = (CON *) realloc((char *) cons, (size *= 2) * sizeof(CON));
+	if (!cons) error("out of memory for linear inequalities");
+	}
+    if (x->op == le || x->op == lt || x->op == equal) {
+	if (linear(conj, &cons[ncons], x->op == le ? 'l' :
+	  x->op == lt ? '<' : '=', plus, times, numvar)) {
+	    if (x->op != equal) inequalities = TRUE;
+	    ncons++;
+	    }
+	}
+    else if (!goal && x->op->arity == PREFIX && (x->op == least || x->op == most)) {
+	c = &obj;
+	bert_ctx->lx_nterms = 0;
+	c->k = lx_run(((TERM_NODE *) x)->right, x->op == most ? -1.0 : 1.0,
+	    plus, times, &c->n);
+	for (i = 0; i < c->n; i++)
+	    if (bert_ctx->lx_terms[i].var->op != numvar) break;
+	if (c->n && i == c->n) {
+	    goal = conj;
+	    c->t = (LX_TERM *) space(c->n * sizeof(LX_TERM));
+	    memcpy((char *) c->t, (char *) bert_ctx->lx_terms,
+		c->n * sizeof(LX_TERM));
+	    }
+	}
+    if (x->op == ctx->false_op || (*at)->op != semi) break;
+    }	/* x->op is false if the chain is already inconsistent */
+if (x->op == ctx->false_op || (!inequalities && !goal)) {
+    for (c = cons; c < cons + ncons; c++) free((char *) c->t);
+    if (goal) free((char *) obj.t);
+    free((char *) cons);
+    return FALSE;
+    }
+if (goal) cons[ncons] = obj;	/* there is room for it */
+
+/* the linear program */
+vars = variables(cons, ncons + (goal != NULL), &nv);
+build(&lp, cons, ncons, vars, nv);
+cost = (double *) space(lp.w * sizeof(double));
+ctx->stats.simplex++;
+
+if (!feasible(&lp, cost)) {
+    lp_false();
+    changed = TRUE;
+    }
+else if (goal) {
+    /* minimize the objective, with the artificial columns left out */
+    c = &cons[ncons];
+    for (j = 0; j < lp.w; j++) cost[j] = 0.0;
+    for (i = 0; i < c->n; i++) {
+	j = column(c->t[i].var, vars, nv);
+	cost[2 * j] = c->t[i].coef;
+	cost[2 * j + 1] = -c->t[i].coef;
+	}
+    if (minimize(&lp, cost, lp.art)) {
+	double *xv = (double *) space((nv ? nv : 1) * sizeof(double));
+	for (j = 0; j < nv; j++)
+	    xv[j] = value(&lp, 2 * j) - value(&lp, 2 * j + 1);
+
+	/* a strict inequality that is tight is not attained */
+	changed = TRUE;
+	for (c = cons; changed && c < cons + ncons; c++) {
+	    double sum = c->k;
+	    if (c->rel != '<') continue;
+	    for (i = 0; i < c->n; i++)
+		sum += c->t[i].coef * xv[column(c->t[i].var, vars, nv)];
+	    if (sum <= EPSILON * (1.0 + fabs(c->k))) changed = FALSE;
+	    }
+	if (changed) {
+	    for (c = cons; c < cons + ncons; c++) lp_satisfied(c->at);
+	    lp_satisfied(goal);
+	    lp_bind(vars, xv, nv);
+	    }
+	free((char *) xv);
+	}
+    }
+
+for (c = cons; c < cons + ncons + (goal != NULL); c++) free((char *) c->t);
+free((char *) cons);
+free((char *) vars);
+free((char *) cost);
+free((char *) lp.tab);
+free((char *) lp.basis);
+ctx->stats.simplex_time += stats_clock() - start;
+return changed;
+}
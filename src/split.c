@@ -0,0 +1,908 @@
+/***********************************************************************
+ *
+ * Splitting the subject into independent parts.
+ *
+ * A big program is often many small problems joined by ; in main.
+ * With --split n, once main has been rewritten into its ; chain, the
+ * conjuncts of the chain (all but the last, which is the answer) are
+ * put into components: two conjuncts are in the same component if
+ * they have a name in common, or names under the same global name
+ * (r.left and r.right are both under r, and the rules for r may make
+ * more names under it).  The components are found by union-find over
+ * the global names, and are shared out among n parts, the biggest
+ * first, each to the part with the fewest nodes so far.
+ *
+ * Each part is solved in a child process forked from here, which
+ * has a copy of the whole context.  (Threads could not share it: a
+ * rule binds its parameters in place, in the rule.)  The child
+ * rewrites the chain of the conjuncts of its part, ended by true,
+ * as rewrite() in ctx.c does, and writes to a temporary file what
+ * came of it: its subject; the names under its global names, with
+ * their types and values, and any names made under them; the
+ * intvars it declared (see fd.c); how often each rule fired; and its
+ * statistics.  A name is written as the global name it is under, by
+ * number, and the path from there down to it, since a node made by
+ * the child may be at an address that is something else here.
+ *
+ * Once the children are done, their results are read back into the
+ * context, and the chain is built again: the conjuncts left by each
+ * part, the parts in the order of their first conjuncts, then the
+ * answer, with false at the front if any part came to false.  Then
+ * rewriting goes on with the whole subject, so that whatever the
+ * parts left (and the answer) is solved together, as it would have
+ * been.  The conjuncts left by a part come out together, rather than
+ * where they were in the chain.
+ *
+ * A part that runs into an error makes the program fail with its
+ * message.  A part that runs into a limit stops the rewriting, with
+ * the subject put together from as far as each part got.  A part
+ * that cannot be forked is left in the chain as it was.  Nothing is
+ * split while tracing, or in a program with edit variables.
+ *
+ ***********************************************************************/
+
+#include "def.h"
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <unistd.h>
+
+#define HASH(p, size)	((int) ((((unsigned long) (p) >> 4) * \
+			    2654435761UL) & ((size) - 1)))
+
+/* from other modules */
+OP *op_find();			/* from ops.c */
+NODE *node_new();		/* from expr.c */
+void node_free();		/* from expr.c */
+void expr_free();		/* from expr.c */
+NODE *expr_update();		/* from expr.c */
+void name_free();		/* from names.c */
+NODE *lx_term();		/* from lx.c */
+NODE *lp_truth();		/* from simplex.c */
+void fd_add();			/* from fd.c */
+void ac_normal();		/* from ac.c */
+void cycle_rehash();		/* from cycle.c */
+char *char_copy();		/* from util.c */
+void op_rules_apply();		/* from ops.c */
+void rule_fired_reset();	/* from rules.c */
+void stats_add();		/* from stats.c */
+double stats_clock();		/* from stats.c */
+int rewrite();			/* from ctx.c */
+void qsort();
+void free();
+
+/* a table of pointers, and a number for each */
+typedef struct ptab {
+	void **keys;
+	int *vals;
+	int size;		/* a power of 2 */
+	int n;
+	} PTAB;
+
+/* a part, and the child solving it */
+typedef struct part {
+	pid_t pid;		/* 0 if it was not forked */
+	FILE *tmp;		/* what it wrote */
+	int first;		/* its first conjunct */
+	long nodes;		/* in its conjuncts */
+	} PART;
+
+/* a component, while they are shared out */
+typedef struct comp {
+	long nodes;
+	int n;
+	} COMP;
+
+/* the chain being split */
+typedef struct split {
+	OP *semi;
+	NODE *chain;
+	NODE **conj;		/* conjuncts of the chain */
+	int nconj;
+	PTAB keys;		/* the global names in them, numbered */
+	NAME_NODE **key;	/* by number */
+	int *up;		/* union-find, for each: another in its */
+	int *comp;		/* component; its part, once known */
+	int nkeys, key_size;
+	int rooted;		/* global_names itself is in a conjunct */
+	int *of;		/* part of each conjunct */
+	PART *parts;
+	int nparts;
+	} SPLIT;
+
+/* while a result is written or read */
+typedef struct stream {
+	FILE *fp;
+	SPLIT *sp;
+	PTAB seen;		/* names made by the child, as numbered */
+	NAME_NODE **made;	/* here */
+	int nmade, made_size;
+	char *buf;		/* the last name read */
+	int buf_size;
+	} STREAM;
+
+static STREAM *fired_to;	/* for fired, in the child */
+
+#define space(n)	mem_get((size_t) (n), "splitting the subject")
+#define more(p, n)	mem_grow((void *) (p), (size_t) (n), "splitting the subject")
+
+/***********************************************************************
+ *
+ * Tables of pointers.
+ *
+ ***********************************************************************/
+static void
+ptab_init(t)
+register PTAB *t;
+{
+register int i;
+
+t->size = 64;
+t->n = 0;
+t->keys = (void **) space(t->size * sizeof(void *));
+t->vals = (int *) space(t->size * sizeof(int));
+for (i = 0; i < t->size; i++) t->keys[i] = NULL;
+}
+
+static int
+ptab_get(t, p)
+register PTAB *t;
+void *p;
+{
+register int i;
+
+for (i = HASH(p, t->size); t->keys[i]; i = (i + 1) & (t->size - 1))
+    if (t->keys[i] == p) return t->vals[i];
+return -1;
+}
+
+static void
+ptab_put(t, p, v)
+register PTAB *t;
+void *p;
+int v;
+{
+register int i;
+
+if (2 * (t->n + 1) > t->size) {	/* twice as big */
+    void **keys = t->keys;
+    int *vals = t->vals;
+    int j, size = t->size;
+    t->size *= 2;
+    t->n = 0;
+    t->keys = (void **) space(t->size * sizeof(void *));
+    t->vals = (int *) space(t->size * sizeof(int));
+    for (i = 0; i < t->size; i++) t->keys[i] = NULL;
+    for (j = 0; j < size; j++) if (keys[j]) ptab_put(t, keys[j], vals[j]);
+    free((char *) keys);
+    free((char *) vals);
+    }
+for (i = HASH(p, t->size); t->keys[i]; i = (i + 1) & (t->size - 1)) ;
+t->keys[i] = p;
+t->vals[i] = v;
+t->n++;
+}
+
+static void
+ptab_free(t)
+PTAB *t;
+{
+free((char *) t->keys);
+free((char *) t->vals);
+}
+
+/***********************************************************************
+ *
+ * Components.
+ *
+ ***********************************************************************/
+
+/* the number of the global name nn is under, -1 for global_names */
+static int
+key(sp, nn)
+register SPLIT *sp;
+register NAME_NODE *nn;
+{
+NAME_NODE *root = bert_ctx->global_names;
+int k;
+
+if (nn == root) return -1;
+while (nn->parent && nn->parent != root) nn = nn->parent;
+if ((k = ptab_get(&sp->keys, (void *) nn)) >= 0) return k;
+if (sp->nkeys == sp->key_size) {
+    sp->key_size *= 2;
+    sp->key = (NAME_NODE **) more((char *) sp->key,
+	sp->key_size * sizeof(NAME_NODE *));
+    sp->up = (int *) more((char *) sp->up, sp->key_size * sizeof(int));
+    }
+k = sp->nkeys++;
+sp->key[k] = nn;
+sp->up[k] = k;
+ptab_put(&sp->keys, (void *) nn, k);
+return k;
+}
+
+static int
+find(sp, k)
+register SPLIT *sp;
+register int k;
+{
+while (sp->up[k] != k) k = sp->up[k] = sp->up[sp->up[k]];
+return k;
+}
+
+/* put the global name nn is under in the component of *first */
+static void
+join(sp, nn, first)
+register SPLIT *sp;
+NAME_NODE *nn;
+int *first;		/* of the conjunct, -1 if none yet */
+{
+int a, b;
+
+if (0 > (b = key(sp, nn))) sp->rooted = TRUE;
+else if (*first < 0) *first = b;
+else if ((a = find(sp, *first)) != (b = find(sp, b))) sp->up[a] = b;
+}
+
+/* join the names of ex; returns its size in nodes */
+static long
+scan(sp, ex, first)
+register SPLIT *sp;
+register NODE *ex;
+int *first;
+{
+register TERM_NODE *tn = (TERM_NODE *) ex;
+long n = 1;
+
+if (ex->op->arity & OP_NAME) {
+    join(sp, (NAME_NODE *) ex, first);
+    if (((NAME_NODE *) ex)->value)	/* not brought up to date yet */
+	n += scan(sp, ((NAME_NODE *) ex)->value, first);
+    }
+else if (ex->op->arity & OP_TERM) {
+    if (tn->label) join(sp, tn->label, first);
+    if (tn->left) n += scan(sp, tn->left, first);
+    if (tn->right) n += scan(sp, tn->right, first);
+    }
+return n;
+}
+
+/* for qsort: the biggest component first */
+static int
+biggest(a, b)
+char *a, *b;
+{
+register COMP *x = (COMP *) a, *y = (COMP *) b;
+
+if (x->nodes != y->nodes) return x->nodes < y->nodes ? 1 : -1;
+return x->n - y->n;
+}
+
+/***********************************************************************
+ *
+ * Writing a result, in the child.
+ *
+ ***********************************************************************/
+static void
+put(s, p, n)
+STREAM *s;
+void *p;
+int n;
+{
+if (n && 1 != fwrite(p, n, 1, s->fp)) _exit(1);
+}
+
+static void
+put_string(s, p)
+STREAM *s;
+char *p;
+{
+int n = p ? (int) strlen(p) : -1;
+
+put(s, &n, sizeof(n));
+if (n > 0) put(s, p, n);
+}
+
+/* a name below the global name it is under */
+static void
+put_step(s, nn)
+STREAM *s;
+NAME_NODE *nn;
+{
+put(s, &nn, sizeof(nn));
+put(s, &nn->op, sizeof(nn->op));
+put_string(s, nn->pval);
+}
+
+static void
+put_path(s, nn, top)
+STREAM *s;
+NAME_NODE *nn, *top;
+{
+if (nn == top) return;
+put_path(s, nn->parent, top);
+put_step(s, nn);
+}
+
+static void
+put_name(s, nn)
+register STREAM *s;
+register NAME_NODE *nn;
+{
+NAME_NODE *root = bert_ctx->global_names;
+register NAME_NODE *top;
+int k, depth = 0;
+
+if (nn == root) {
+    putc('r', s->fp);
+    return;
+    }
+for (top = nn; top->parent && top->parent != root; top = top->parent)
+    depth++;
+if (0 <= (k = ptab_get(&s->sp->keys, (void *) top))) {
+    putc('k', s->fp);
+    put(s, &k, sizeof(k));
+    }
+else {		/* made by this part */
+    putc(top->parent ? 'g' : 'd', s->fp);
+    put_step(s, top);
+    }
+put(s, &depth, sizeof(depth));
+put_path(s, nn, top);
+}
+
+static void
+put_expr(s, ex)
+register STREAM *s;
+register NODE *ex;
+{
+register TERM_NODE *tn = (TERM_NODE *) ex;
+int has;
+
+if (ex->op->arity & OP_TERM) {
+    putc('t', s->fp);
+    put(s, &ex->op, sizeof(ex->op));
+    has = (tn->label ? 1 : 0) | (tn->left ? 2 : 0) | (tn->right ? 4 : 0);
+    putc(has, s->fp);
+    if (tn->label) put_name(s, tn->label);
+    if (tn->left) put_expr(s, tn->left);
+    if (tn->right) put_expr(s, tn->right);
+    }
+else if (ex->op->arity & OP_NAME) {
+    putc('n', s->fp);
+    put_name(s, (NAME_NODE *) ex);
+    }
+else if (ex->op->arity & OP_NUM) {
+    putc('#', s->fp);
+    put(s, &ex->op, sizeof(ex->op));
+    put(s, &((NUM_NODE *) ex)->value, sizeof(double));
+    }
+else {
+    putc('"', s->fp);
+    put(s, &ex->op, sizeof(ex->op));
+    put_string(s, ((STR_NODE *) ex)->value);
+    }
+}
+
+/* a name under a global name of the part, and the names under it */
+static void
+put_names(s, nn)
+register STREAM *s;
+register NAME_NODE *nn;
+{
+register NAME_NODE *ch;
+
+putc('n', s->fp);
+put_name(s, nn);
+put(s, &nn->op, sizeof(nn->op));
+putc(nn->value ? 'v' : '-', s->fp);
+if (nn->value) put_expr(s, nn->value);
+for (ch = nn->child; ch; ch = ch->next) put_names(s, ch);
+}
+
+static void
+fired(rr)
+RULE *rr;
+{
+if (!rr->fired) return;
+put(fired_to, &rr, sizeof(rr));
+put(fired_to, &rr->fired, sizeof(rr->fired));
+}
+
+/***********************************************************************
+ *
+ * Solve part p of the chain, in the child, and write the result:
+ *
+ *	status, message
+ *	statistics
+ *	rules fired: (rule, times) ... 0
+ *	intvars declared: (name, lo, hi) ... 'e'
+ *	subject
+ *	names: ('n' name, type, value) ... 'e'
+ *
+ * where status is BERT_OK, BERT_LIMIT, or BERT_ERROR, which has
+ * only the message.
+ *
+ ***********************************************************************/
+static void
+solve(sp, p)
+register SPLIT *sp;
+int p;
+{
+register BERT_CTX *ctx = bert_ctx;
+register int i;
+STREAM s;
+jmp_buf env;
+RULE *none = (RULE *) NULL;
+int status, nfd = ctx->nfd;
+
+ctx->parts = 0;		/* the part is not split again */
+ctx->subject = lp_truth(ctx->true_op);
+for (i = sp->nconj - 1; i >= 0; i--)
+    if (sp->of[i] == p) ctx->subject = lx_term(sp->semi, sp->conj[i],
+	ctx->subject);
+rule_fired_reset();
+if (setjmp(env)) status = BERT_ERROR;
+else {
+    ctx->catch = &env;
+    status = rewrite(ctx) ? BERT_LIMIT : BERT_OK;
+    }
+ctx->catch = (jmp_buf *) NULL;
+
+s.fp = sp->parts[p].tmp;
+s.sp = sp;
+put(&s, &status, sizeof(status));
+put_string(&s, ctx->error_msg);
+if (status != BERT_ERROR) {
+    put(&s, &ctx->stats, sizeof(STATS));
+    fired_to = &s;
+    op_rules_apply(fired);
+    put(&s, &none, sizeof(none));
+    for (i = nfd; i < ctx->nfd; i++) {
+	putc('n', s.fp);
+	put_name(&s, ctx->fd_vars[i].var);
+	put(&s, &ctx->fd_vars[i].lo, sizeof(int));
+	put(&s, &ctx->fd_vars[i].hi, sizeof(int));
+	}
+    putc('e', s.fp);
+    put_expr(&s, ctx->subject);
+    for (i = 0; i < sp->nkeys; i++)
+	if (sp->comp[i] == p) put_names(&s, sp->key[i]);
+    putc('e', s.fp);
+    }
+if (fflush(s.fp)) _exit(1);
+_exit(0);
+}
+
+/***********************************************************************
+ *
+ * Reading a result back.
+ *
+ ***********************************************************************/
+static void
+get(s, p, n)
+STREAM *s;
+void *p;
+int n;
+{
+if (n && 1 != fread(p, n, 1, s->fp)) error("result of a part cut short");
+}
+
+/* into s->buf; returns FALSE if it was NULL */
+static int
+get_string(s)
+register STREAM *s;
+{
+int n;
+
+get(s, &n, sizeof(n));
+if (n < 0) return FALSE;
+if (n + 1 > s->buf_size)
+    s->buf = (char *) more(s->buf, s->buf_size = n + 1);
+get(s, s->buf, n);
+s->buf[n] = '\0';
+return TRUE;
+}
+
+/* a name made by the child, under parent (NULL for none) */
+static NAME_NODE *
+get_step(s, parent)
+register STREAM *s;
+NAME_NODE *parent;
+{
+register NAME_NODE *nn, *prev = (NAME_NODE *) NULL;
+void *was;
+OP *op;
+int v, named;
+
+get(s, &was, sizeof(was));
+get(s, &op, sizeof(op));
+named = get_string(s);
+if (0 <= (v = ptab_get(&s->seen, was))) return s->made[v];
+nn = (parent && named) ? parent->child : (NAME_NODE *) NULL;
+for (; nn; prev = nn, nn = nn->next) {
+    if (!nn->pval || (v = strcmp(nn->pval, s->buf)) < 0) continue;
+    if (v > 0) nn = (NAME_NODE *) NULL;	/* it goes before this one */
+    break;
+    }
+if (!nn) {	/* a new name, in order */
+    nn = (NAME_NODE *) node_new();
+    nn->op = op;
+    nn->parent = parent;
+    nn->child = (NAME_NODE *) NULL;
+    nn->pval = named ? char_copy(s->buf) : (char *) NULL;
+    nn->value = (NODE *) NULL;
+    nn->refs = 1;		/* its parent's reference */
+    nn->domain = 0;
+    nn->edit = 0;
+    nn->uses = 0;
+    if (!parent) nn->next = (NAME_NODE *) NULL;
+    else if (prev) {
+	nn->next = prev->next;
+	prev->next = nn;
+	}
+    else {
+	nn->next = parent->child;
+	parent->child = nn;
+	}
+    }
+if (s->nmade == s->made_size)
+    s->made = (NAME_NODE **) more((char *) s->made,
+	(s->made_size *= 2) * sizeof(NAME_NODE *));
+s->made[s->nmade] = nn;
+ptab_put(&s->seen, was, s->nmade++);
+return nn;
+}
+
+static NAME_NODE *
+get_name(s)
+register STREAM *s;
+{
+register BERT_CTX *ctx = bert_ctx;
+register NAME_NODE *nn = (NAME_NODE *) NULL;
+int c = getc(s->fp), k, depth;
+
+if (c == 'r') return ctx->global_names;
+if (c == 'k') {
+    get(s, &k, sizeof(k));
+    if (k < 0 || k >= s->sp->nkeys) error("result of a part has a bad name");
+    nn = s->sp->key[k];
+    }
+else if (c == 'g') nn = get_step(s, ctx->global_names);
+else if (c == 'd') nn = get_step(s, (NAME_NODE *) NULL);
+else error("result of a part has a bad name");
+get(s, &depth, sizeof(depth));
+while (depth-- > 0) nn = get_step(s, nn);
+return nn;
+}
+
+static NODE *
+get_expr(s)
+register STREAM *s;
+{
+register NODE *ex;
+register TERM_NODE *tn;
+int c = getc(s->fp), has;
+
+if (c == 'n') {
+    ex = (NODE *) get_name(s);
+    ((NAME_NODE *) ex)->refs++;
+    return ex;
+    }
+ex = node_new();
+get(s, &ex->op, sizeof(ex->op));
+if (c == 't') {
+    tn = (TERM_NODE *) ex;
+    has = getc(s->fp);
+    tn->label = (NAME_NODE *) NULL;
+    tn->left = tn->right = (NODE *) NULL;
+    if (has & 1) {
+	tn->label = get_name(s);
+	tn->label->refs++;
+	}
+    if (has & 2) tn->left = get_expr(s);
+    if (has & 4) tn->right = get_expr(s);
+    }
+else if (c == '#') get(s, &((NUM_NODE *) ex)->value, sizeof(double));
+else if (c == '"')
+    ((STR_NODE *) ex)->value = get_string(s) ? char_copy(s->buf) : "";
+else error("result of a part has a bad expression");
+return ex;
+}
+
+/***********************************************************************
+ *
+ * Read the result of part p back into the context.
+ *
+ * returns:	its subject, or NULL if it ran into an error (the
+ *		message is left in ctx->error_msg)
+ *
+ ***********************************************************************/
+static NODE *
+merge(sp, p, base, limited)
+register SPLIT *sp;
+int p;
+STATS *base;		/* the statistics when the parts were forked */
+int *limited;		/* set if it ran into a limit */
+{
+register BERT_CTX *ctx = bert_ctx;
+register NAME_NODE *nn;
+STREAM s;
+STATS stats;
+RULE *rr;
+NODE *subject, *value;
+long fired;
+int status, lo, hi;
+OP *op;
+
+s.fp = sp->parts[p].tmp;
+s.sp = sp;
+ptab_init(&s.seen);
+s.made_size = 16;
+s.made = (NAME_NODE **) space(s.made_size * sizeof(NAME_NODE *));
+s.nmade = 0;
+s.buf_size = 64;
+s.buf = (char *) space(s.buf_size);
+rewind(s.fp);
+
+get(&s, &status, sizeof(status));
+get_string(&s);
+if (status == BERT_ERROR) {
+    snprintf(ctx->error_msg, MAXERROR, "%s", s.buf);
+    subject = (NODE *) NULL;
+    }
+else {
+    if (status == BERT_LIMIT) {
+	snprintf(ctx->error_msg, MAXERROR, "%s", s.buf);
+	*limited = TRUE;
+	}
+    get(&s, &stats, sizeof(STATS));
+    stats_add(&stats, base);
+    for (get(&s, &rr, sizeof(rr)); rr; get(&s, &rr, sizeof(rr))) {
+	get(&s, &fired, sizeof(fired));
+	rr->fired += fired;
+	}
+    while ('n' == getc(s.fp)) {	/* intvars */
+	nn = get_name(&s);
+	get(&s, &lo, sizeof(lo));
+	get(&s, &hi, sizeof(hi));
+	if (nn->domain <= 0 || nn->domain > ctx->nfd ||
+	  ctx->fd_vars[nn->domain - 1].var != nn)
+	    fd_add(nn, lo, hi);
+	}
+    subject = get_expr(&s);
+    while ('n' == getc(s.fp)) {	/* names */
+	nn = get_name(&s);
+	get(&s, &op, sizeof(op));
+	nn->op = op;
+	if ('v' == getc(s.fp)) {
+	    value = get_expr(&s);
+	    if (nn->value) expr_free(value);
+	    else nn->value = value;
+	    }
+	}
+    }
+
+ptab_free(&s.seen);
+free((char *) s.made);
+free(s.buf);
+return subject;
+}
+
+/***********************************************************************
+ *
+ * Split the subject into its independent parts, and solve them at
+ * once, each in its own child process.
+ *
+ * returns:	FALSE if the subject is not a ; chain yet, else TRUE
+ *		(whether it was split or not), with *limited set if
+ *		a part ran into a limit
+ *
+ ***********************************************************************/
+int
+split(limited)
+int *limited;
+{
+register BERT_CTX *ctx = bert_ctx;
+register SPLIT *sp;
+register int i, p;
+SPLIT s;
+STATS base;
+NODE *x, *answer, **out, *next;
+int *first, *order, ncomp, nout, out_size, wstatus, falsity = FALSE;
+double start;
+char *failed = NULL, msg[MAXERROR];
+
+*limited = FALSE;
+sp = &s;
+sp->semi = op_find(ctx->single_op, ";", BINARY);
+if (!sp->semi || !ctx->subject || ctx->subject->op != sp->semi) return FALSE;
+
+/* the conjuncts, and the global names in them */
+start = stats_clock();
+sp->chain = ctx->subject;
+for (sp->nconj = 0, x = sp->chain; x->op == sp->semi;
+  x = ((TERM_NODE *) x)->right)
+    sp->nconj++;
+answer = x;
+sp->conj = (NODE **) space(sp->nconj * sizeof(NODE *));
+for (i = 0, x = sp->chain; x->op == sp->semi; x = ((TERM_NODE *) x)->right)
+    sp->conj[i++] = ((TERM_NODE *) x)->left;
+ptab_init(&sp->keys);
+sp->key_size = 64;
+sp->key = (NAME_NODE **) space(sp->key_size * sizeof(NAME_NODE *));
+sp->up = (int *) space(sp->key_size * sizeof(int));
+sp->nkeys = 0;
+sp->rooted = FALSE;
+first = (int *) space(sp->nconj * sizeof(int));
+sp->of = (int *) space(sp->nconj * sizeof(int));
+sp->parts = (PART *) NULL;
+sp->nparts = 0;
+for (i = 0; i < sp->nconj; i++) {
+    first[i] = -1;
+    sp->of[i] = scan(sp, sp->conj[i], &first[i]);	/* its size, for now */
+    }
+
+/* the components: of each global name, then of each conjunct */
+sp->comp = (int *) space((sp->nkeys + 1) * sizeof(int));
+for (i = 0; i < sp->nkeys; i++) sp->comp[i] = -1;
+order = (int *) space(sp->nconj * sizeof(int));
+for (ncomp = i = 0; i < sp->nconj; i++) {
+    if (first[i] < 0) order[i] = ncomp++;	/* no names: alone */
+    else {
+	p = find(sp, first[i]);
+	if (sp->comp[p] < 0) sp->comp[p] = ncomp++;
+	order[i] = sp->comp[p];
+	}
+    }
+if (ncomp < 2 || sp->rooted) goto done;
+
+/* each component to the part with the fewest nodes so far, the
+   biggest first */
+sp->nparts = ncomp < ctx->parts ? ncomp : ctx->parts;
+sp->parts = (PART *) space(sp->nparts * sizeof(PART));
+for (p = 0; p < sp->nparts; p++) {
+    sp->parts[p].pid = 0;
+    sp->parts[p].tmp = (FILE *) NULL;
+    sp->parts[p].first = -1;
+    sp->parts[p].nodes = 0;
+    }
+{
+    COMP *comps = (COMP *) space(ncomp * sizeof(COMP));
+    int *part = (int *) space(ncomp * sizeof(int));
+    int c;
+    for (c = 0; c < ncomp; c++) {
+	comps[c].nodes = 0;
+	comps[c].n = c;
+	}
+    for (i = 0; i < sp->nconj; i++) comps[order[i]].nodes += sp->of[i];
+    qsort((char *) comps, ncomp, sizeof(COMP), biggest);
+    for (c = 0; c < ncomp; c++) {
+	for (p = 1, i = 0; p < sp->nparts; p++)
+	    if (sp->parts[p].nodes < sp->parts[i].nodes) i = p;
+	part[comps[c].n] = i;
+	sp->parts[i].nodes += comps[c].nodes;
+	}
+    for (i = 0; i < sp->nconj; i++) {
+	sp->of[i] = part[order[i]];
+	if (sp->parts[sp->of[i]].first < 0) sp->parts[sp->of[i]].first = i;
+	}
+    for (i = 0; i < sp->nkeys; i++)	/* and the part of each name */
+	if (find(sp, i) == i) sp->comp[i] = part[sp->comp[i]];
+    for (i = 0; i < sp->nkeys; i++) sp->comp[i] = sp->comp[find(sp, i)];
+    free((char *) comps);
+    free((char *) part);
+}
+
+/* solve the parts */
+base = ctx->stats;
+fflush(stdout);		/* or the children would write it again */
+fflush(stderr);
+for (p = 0; p < sp->nparts; p++) {
+    if (!(sp->parts[p].tmp = tmpfile())) {
+	perror("bert: tmpfile");
+	continue;
+	}
+    sp->parts[p].pid = fork();
+    if (0 == sp->parts[p].pid) solve(sp, p);
+    if (sp->parts[p].pid < 0) {
+	perror("bert: fork");
+	sp->parts[p].pid = 0;
+	}
+    }
+for (p = 0; p < sp->nparts; p++) {
+    if (!sp->parts[p].pid) continue;
+    while (waitpid(sp->parts[p].pid, &wstatus, 0) < 0)
+	if (EINTR != errno) {
+	    perror("bert: waitpid");
+	    wstatus = 1 << 8;
+	    break;
+	    }
+    if (WIFSIGNALED(wstatus) || WEXITSTATUS(wstatus)) {
+	failed = "part of the subject could not be solved";
+	sp->parts[p].pid = 0;
+	}
+    }
+if (failed) goto done;
+
+/* read them back, in the order of their first conjuncts */
+out = (NODE **) space((out_size = sp->nconj) * sizeof(NODE *));
+nout = 0;
+for (i = 0; i < sp->nconj; i++) {
+    p = sp->of[i];
+    if (!sp->parts[p].pid) {	/* not forked: left as it was */
+	out[nout++] = sp->conj[i];
+	continue;
+	}
+    if (sp->parts[p].first != i) {	/* solved, and merged below */
+	expr_free(sp->conj[i]);
+	continue;
+	}
+    if (!(x = merge(sp, p, &base, limited))) {
+	snprintf(msg, MAXERROR, "%s", ctx->error_msg);
+	failed = msg;
+	break;
+	}
+    while (TRUE) {	/* its conjuncts go into the chain */
+	NODE *c = x;
+	if (x->op == sp->semi) {
+	    c = ((TERM_NODE *) x)->left;
+	    next = ((TERM_NODE *) x)->right;
+	    if (((TERM_NODE *) x)->label) name_free(((TERM_NODE *) x)->label);
+	    node_free(x);
+	    }
+	if (c->op == ctx->false_op) {
+	    falsity = TRUE;
+	    expr_free(c);
+	    }
+	else if (c != x || c->op != ctx->true_op) {
+	    if (nout == out_size)
+		out = (NODE **) more((char *) out,
+		    (out_size *= 2) * sizeof(NODE *));
+	    out[nout++] = c;
+	    }
+	else expr_free(c);
+	if (c == x) break;
+	x = next;
+	}
+    }
+if (failed) {	/* the chain is not put back together */
+    free((char *) out);
+    goto done;
+    }
+
+/* the chain, again */
+for (x = sp->chain; x->op == sp->semi; x = next) {
+    next = ((TERM_NODE *) x)->right;
+    if (((TERM_NODE *) x)->label) name_free(((TERM_NODE *) x)->label);
+    node_free(x);
+    }
+for (x = answer, i = nout - 1; i >= 0; i--) x = lx_term(sp->semi, out[i], x);
+if (falsity) x = lx_term(sp->semi, lp_truth(ctx->false_op), x);
+free((char *) out);
+ctx->subject = expr_update(x);
+if (ctx->ac_ops) ac_normal(ctx->subject);
+ctx->quiet++;		/* names were bound */
+if (ctx->cycle_window) cycle_rehash(ctx->subject);
+ctx->learn = TRUE;
+ctx->stats.split++;
+ctx->stats.split_parts += sp->nparts;
+ctx->stats.split_components += ncomp;
+ctx->stats.split_time += stats_clock() - start;
+
+done:
+for (p = 0; p < sp->nparts; p++)
+    if (sp->parts[p].tmp) fclose(sp->parts[p].tmp);
+if (sp->parts) free((char *) sp->parts);
+free((char *) order);
+free((char *) sp->comp);
+free((char *) sp->of);
+free((char *) first);
+free((char *) sp->up);
+free((char *) sp->key);
+ptab_free(&sp->keys);
+free((char *) sp->conj);
+if (failed) error(failed);
+return TRUE;
+}
@@ -0,0 +1,69 @@
+#!/bin/sh
+# Bertrand startup benchmark.
+#
+# Compares the per-program cost of a cold bert run, which starts a
+# new process and parses all of the #included libraries every time,
+# with a request to a fork server (bert --serve --fork) that parsed
+# the libraries once, and only forks and parses the program itself.
+# Each program is run RUNS times each way; one tab separated line per
+# program is written to standard output:
+#
+#	commit program cold_ms fork_ms speedup
+#
+# where the times are mean wall clock milliseconds per run, including
+# rewriting and printing.  The fork server requests are all sent by
+# one bert --send process, so fork_ms does not include starting a
+# process for the client.
+#
+# usage: sh startup.sh [program ...]	(default: all of ../examples)
+#
+# Environment:
+#	BERT		interpreter to run (default ./bert)
+#	RUNS		runs of each program each way (default 20)
+#	LIBS		libraries preloaded by the fork server (default beep)
+
+BERT=${BERT:-./bert}
+RUNS=${RUNS:-20}
+LIBS=${LIBS:-beep}
+
+here=`cd \`dirname $0\` && pwd`
+BERTRAND=${BERTRAND:-$here/../libraries/}
+export BERTRAND
+commit=`git -C $here rev-parse --short HEAD 2>/dev/null || echo unknown`
+tmp=${TMPDIR:-/tmp}/bertstartup.$$
+mkdir -p $tmp
+sock=$tmp/sock
+trap 'kill $server 2>/dev/null; rm -rf $tmp' 0 1 2 15
+
+# wall clock time in milliseconds (needs GNU date)
+now() {
+date +%s%N | awk '{ printf "%.3f", $1 / 1e6 }'
+}
+
+includes=
+for lib in $LIBS; do includes="$includes --include $lib"; done
+$BERT $includes --serve $sock --fork 2>$tmp/server.log &
+server=$!
+while [ ! -S $sock ]; do
+	kill -0 $server 2>/dev/null || { cat $tmp/server.log >&2; exit 1; }
+	sleep 0.1
+done
+
+printf "commit\tprogram\tcold_ms\tfork_ms\tspeedup\n"
+for prog in ${*:-`ls $here/../examples/* | grep -v read.me`}; do
+	args=
+	i=0
+	while [ $i -lt $RUNS ]; do args="$args $prog"; i=`expr $i + 1`; done
+
+	start=`now`
+	for p in $args; do $BERT $p >/dev/null 2>&1; done
+	cold=`now`
+	$BERT --send $sock $args >/dev/null 2>&1
+	warm=`now`
+
+	awk -v c=$commit -v p=`basename $prog` -v n=$RUNS \
+	    -v s=$start -v m=$cold -v e=$warm 'BEGIN {
+		cold = (m - s) / n; fork = (e - m) / n
+		printf "%s\t%s\t%.2f\t%.2f\t%.1f\n", c, p, cold, fork, cold / fork
+		}'
+done
@@ -0,0 +1,184 @@
+/***********************************************************************
+ *
+ * Run statistics
+ *
+ * Counters are bumped by the routines that own each resource
+ * (expression nodes in expr.c, stack nodes in util.c, operator
+ * memory in ops.c, rewrites in match.c).  Timing of the phases
+ * is done by main.c and parse.c.  Everything is reported by
+ * stats_print when the --stats switch is given.
+ *
+ ***********************************************************************/
+
+#include "def.h"
+#include <sys/time.h>
+
+int statistics;		/* print statistics? set by --stats */
+
+/***********************************************************************
+ *
+ * Return wall clock time, in seconds.
+ *
+ ***********************************************************************/
+double
+stats_clock()
+{
+struct timeval tv;
+
+gettimeofday(&tv, (struct timezone *) NULL);
+return (double) tv.tv_sec + (double) tv.tv_usec / 1e6;
+}
+
+/***********************************************************************
+ *
+ * Reset the per program counters, including how often each
+ * rule has fired.
+ * Nodes that are still live stay counted as live,
+ * and the high water marks restart from there.
+ *
+ ***********************************************************************/
+void
+stats_reset()
+{
+void rule_fired_reset();	/* from rules.c */
+register STATS *s = &bert_ctx->stats;
+
+s->parse_time = s->build_time = 0.0;
+s->rewrite_time = s->print_time = 0.0;
+s->passes = s->rewrites = s->updates = s->skipped = 0;
+s->agenda = 0;
+s->nodes_alloc = s->nodes_freed = 0;
+s->nodes_high = s->nodes_live;
+s->snodes_get = 0;
+s->snodes_high = s->snodes_live;
+s->edits = 0;
+s->edit_time = 0.0;
+s->simplex = 0;
+s->simplex_time = 0.0;
+s->newton = 0;
+s->newton_time = 0.0;
+s->interval = 0;
+s->interval_time = 0.0;
+s->fd = 0;
+s->fd_failures = 0;
+s->fd_time = 0.0;
+s->boolean = 0;
+s->boolean_forced = 0;
+s->boolean_time = 0.0;
+s->split = s->split_components = s->split_parts = 0;
+s->split_time = 0.0;
+s->dedup = s->dedup_dropped = 0;
+s->dedup_time = 0.0;
+rule_fired_reset();
+}
+
+/***********************************************************************
+ *
+ * Add the counts of from, less those of base, to the current
+ * statistics: from is of a child process forked when they were
+ * base, that solved a part of the subject (see split.c).
+ *
+ ***********************************************************************/
+void
+stats_add(from, base)
+register STATS *from, *base;
+{
+register STATS *s = &bert_ctx->stats;
+
+s->passes += from->passes - base->passes;
+s->rewrites += from->rewrites - base->rewrites;
+s->updates += from->updates - base->updates;
+s->skipped += from->skipped - base->skipped;
+s->agenda += from->agenda - base->agenda;
+s->nodes_alloc += from->nodes_alloc - base->nodes_alloc;
+s->nodes_freed += from->nodes_freed - base->nodes_freed;
+if (from->nodes_high > s->nodes_high) s->nodes_high = from->nodes_high;
+s->snodes_get += from->snodes_get - base->snodes_get;
+if (from->snodes_high > s->snodes_high) s->snodes_high = from->snodes_high;
+s->simplex += from->simplex - base->simplex;
+s->simplex_time += from->simplex_time - base->simplex_time;
+s->newton += from->newton - base->newton;
+s->newton_time += from->newton_time - base->newton_time;
+s->interval += from->interval - base->interval;
+s->interval_time += from->interval_time - base->interval_time;
+s->fd += from->fd - base->fd;
+s->fd_failures += from->fd_failures - base->fd_failures;
+s->fd_time += from->fd_time - base->fd_time;
+s->boolean += from->boolean - base->boolean;
+s->boolean_forced += from->boolean_forced - base->boolean_forced;
+s->boolean_time += from->boolean_time - base->boolean_time;
+s->dedup += from->dedup - base->dedup;
+s->dedup_dropped += from->dedup_dropped - base->dedup_dropped;
+s->dedup_time += from->dedup_time - base->dedup_time;
+}
+
+/***********************************************************************
+ *
+ * Print a summary of the statistics for one program.
+ * Each line is "stats: <name> <value>" so that it can be
+ * picked out of the output with grep.
+ *
+ ***********************************************************************/
+void
+stats_print(name)
+char *name;		/* name of program */
+{
+register STATS *s = &bert_ctx->stats;
+
+fprintf(stderr, "stats: program %s\n", name);
+fprintf(stderr, "stats: parse_seconds %.6f\n", s->parse_time);
+fprintf(stderr, "stats: rule_build_seconds %.6f\n", s->build_time);
+fprintf(stderr, "stats: rewrite_seconds %.6f\n", s->rewrite_time);
+fprintf(stderr, "stats: print_seconds %.6f\n", s->print_time);
+fprintf(stderr, "stats: walk_passes %ld\n", s->passes);
+fprintf(stderr, "stats: rewrites %ld\n", s->rewrites);
+fprintf(stderr, "stats: subject_updates %ld\n", s->updates);
+fprintf(stderr, "stats: quiet_skips %ld\n", s->skipped);
+if (s->agenda) fprintf(stderr, "stats: agenda_rewrites %ld\n", s->agenda);
+fprintf(stderr, "stats: nodes_allocated %ld\n", s->nodes_alloc);
+fprintf(stderr, "stats: nodes_freed %ld\n", s->nodes_freed);
+fprintf(stderr, "stats: nodes_live %ld\n", s->nodes_live);
+fprintf(stderr, "stats: nodes_high_water %ld\n", s->nodes_high);
+fprintf(stderr, "stats: node_bytes %ld\n", s->node_bytes);
+fprintf(stderr, "stats: snodes_taken %ld\n", s->snodes_get);
+fprintf(stderr, "stats: snodes_high_water %ld\n", s->snodes_high);
+fprintf(stderr, "stats: snode_bytes %ld\n", s->snode_bytes);
+fprintf(stderr, "stats: operator_bytes_used %ld\n", s->op_used);
+fprintf(stderr, "stats: operator_bytes %ld\n", s->op_bytes);
+if (s->edits) {
+    fprintf(stderr, "stats: edits %ld\n", s->edits);
+    fprintf(stderr, "stats: edit_seconds %.6f\n", s->edit_time);
+    }
+if (s->simplex) {
+    fprintf(stderr, "stats: simplex_solves %ld\n", s->simplex);
+    fprintf(stderr, "stats: simplex_seconds %.6f\n", s->simplex_time);
+    }
+if (s->newton) {
+    fprintf(stderr, "stats: newton_solves %ld\n", s->newton);
+    fprintf(stderr, "stats: newton_seconds %.6f\n", s->newton_time);
+    }
+if (s->interval) {
+    fprintf(stderr, "stats: interval_runs %ld\n", s->interval);
+    fprintf(stderr, "stats: interval_seconds %.6f\n", s->interval_time);
+    }
+if (s->fd) {
+    fprintf(stderr, "stats: fd_searches %ld\n", s->fd);
+    fprintf(stderr, "stats: fd_failures %ld\n", s->fd_failures);
+    fprintf(stderr, "stats: fd_seconds %.6f\n", s->fd_time);
+    }
+if (s->boolean) {
+    fprintf(stderr, "stats: boolean_runs %ld\n", s->boolean);
+    fprintf(stderr, "stats: boolean_forced %ld\n", s->boolean_forced);
+    fprintf(stderr, "stats: boolean_seconds %.6f\n", s->boolean_time);
+    }
+if (s->dedup) {
+    fprintf(stderr, "stats: dedup_sweeps %ld\n", s->dedup);
+    fprintf(stderr, "stats: dedup_dropped %ld\n", s->dedup_dropped);
+    fprintf(stderr, "stats: dedup_seconds %.6f\n", s->dedup_time);
+    }
+if (s->split) {
+    fprintf(stderr, "stats: split_components %ld\n", s->split_components);
+    fprintf(stderr, "stats: split_parts %ld\n", s->split_parts);
+    fprintf(stderr, "stats: split_seconds %.6f\n", s->split_time);
+    }
+}
@@ -0,0 +1,58 @@
+#!/bin/sh
+# Bertrand reduction strategy benchmark.
+#
+# Runs each program with each reduction strategy (bert --strategy)
+# and writes one tab separated line per program and strategy to
+# standard output:
+#
+#	commit program strategy status rewrites passes seconds same
+#
+# where status is ok, error or limit, rewrites and passes come from
+# --stats, seconds is the rewriting time, and same is yes if the
+# output is the same as with the outermost strategy.  Each run is
+# stopped after STEPS rewrites, so a strategy that does not finish
+# shows up as a limit rather than hanging the benchmark.
+#
+# usage: sh strategies.sh [program ...]	(default: all of ../examples)
+#
+# Environment:
+#	BERT		interpreter to run (default ./bert)
+#	STEPS		rewrite limit of each run (default 1000000)
+#	STRATEGIES	strategies to run (default outermost innermost parallel)
+
+BERT=${BERT:-./bert}
+STEPS=${STEPS:-1000000}
+STRATEGIES=${STRATEGIES:-outermost innermost parallel}
+
+here=`cd \`dirname $0\` && pwd`
+BERTRAND=${BERTRAND:-$here/../libraries/}
+export BERTRAND
+commit=`git -C $here rev-parse --short HEAD 2>/dev/null || echo unknown`
+tmp=${TMPDIR:-/tmp}/bertstrategy.$$
+mkdir -p $tmp
+trap 'rm -rf $tmp' 0 1 2 15
+
+printf "commit\tprogram\tstrategy\tstatus\trewrites\tpasses\tseconds\tsame\n"
+for prog in ${*:-`ls $here/../examples/* | grep -v read.me`}; do
+	rm -f $tmp/outermost.out
+	for s in $STRATEGIES; do
+		$BERT --stats --steps $STEPS --strategy $s $prog \
+		    >$tmp/$s.out 2>$tmp/stats
+		case $? in
+		0) status=ok ;;
+		3) status=limit ;;
+		*) status=error ;;
+		esac
+		same=yes
+		if [ -f $tmp/outermost.out ]; then
+			cmp -s $tmp/outermost.out $tmp/$s.out || same=no
+		fi
+		awk -v c=$commit -v p=`basename $prog` -v s=$s -v st=$status \
+		    -v same=$same '
+			$2 == "rewrites" { r = $3 }
+			$2 == "walk_passes" { n = $3 }
+			$2 == "rewrite_seconds" { t = $3 }
+			END { printf "%s\t%s\t%s\t%s\t%d\t%d\t%.6f\t%s\n",
+			    c, p, s, st, r, n, t, same }' $tmp/stats
+	done
+done
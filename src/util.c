@@ -1,4 +1,5 @@
 #include "def.h"
+#include <stdlib.h>
 
 /*************************************************************
  *
@@ -41,13 +42,8 @@ NODE *init()
     /* op_new takes integer argument, which is length of name */
     OP *op_new();			/* from ops.c */
     NODE *node_new();			/* from expr.c */
-    extern OP *name_op;			/* from ops.c */
-    extern OP *undeclared_prim;		/* from primitive.c */
     void primitive_init();		/* from primitive.c */
     void op_mem_free();			/* from ops.c */
-    extern NAME_NODE *global_names;	/* from names.c */
-    extern int lineno, charno;		/* from scan.c */
-    extern int verbose;			/* from main.c */
 
     register TERM_NODE *insex;	/* initial subject expression */
     OP *main_op;		/* operator for initial subject expression */
@@ -56,28 +52,30 @@ NODE *init()
     op_mem_free();		/* make sure operator memory is empty */
     primitive_init();		/* initialize all machine primitives */
 
-    lineno = 1;
-    charno = 0;
-    verbose = FALSE;
+    bert_ctx->lineno = 1;
+    bert_ctx->charno = 0;
+    bert_ctx->verbose = FALSE;
 
     /* initial subject expression operator */
-    main_op = primitive("main", NULLARY, (OP *) NULL, &name_op, 0);
+    main_op = primitive("main", NULLARY, (OP *) NULL, &bert_ctx->name_op, 0);
 
     /* initialize global name space */
-    global_names = (NAME_NODE *) node_new();
-    global_names->op = undeclared_prim;
-    global_names->next = (NAME_NODE *) NULL;
-    global_names->parent = (NAME_NODE *) NULL;
-    global_names->child = (NAME_NODE *) NULL;
-    global_names->pval = noname;	/* no name. */
-    global_names->refs = 1;	/* will never delete */
-    global_names->interest = 0;
+    bert_ctx->global_names = (NAME_NODE *) node_new();
+    bert_ctx->global_names->op = bert_ctx->undeclared_prim;
+    bert_ctx->global_names->next = (NAME_NODE *) NULL;
+    bert_ctx->global_names->parent = (NAME_NODE *) NULL;
+    bert_ctx->global_names->child = (NAME_NODE *) NULL;
+    bert_ctx->global_names->pval = noname;	/* no name. */
+    bert_ctx->global_names->refs = 1;	/* will never delete */
+    bert_ctx->global_names->domain = 0;
+    bert_ctx->global_names->edit = 0;
+    bert_ctx->global_names->uses = 0;
 
     /* create and return initial subject expression */
     insex = (TERM_NODE *) node_new();
     insex->op = main_op;
-    insex->label = global_names;
-    global_names->refs++;	/* since we have a pointer to it */
+    insex->label = bert_ctx->global_names;
+    bert_ctx->global_names->refs++;	/* since we have a pointer to it */
     insex->left = (NODE *) NULL;
     insex->right = (NODE *) NULL;
     return (NODE *) insex;
@@ -91,8 +89,6 @@ NODE *init()
  ***********************************************************************/
 
 #define NUM_ST	   50		/* number of parse stack nodes to allocate */
-static SNODE *st_mem = NULL;		/* free parse stack nodes */
-static SNODE *all_st_mem = NULL;	/* pointer to all stack memory */
  
 /***********************************************************************
  *
@@ -107,28 +103,32 @@ st_get()
 void *malloc();
 SNODE *temp;		/* node to be allocated to stack */ 
 
-if (!st_mem) {
+if (!bert_ctx->st_mem) {
     register int i;
 #   ifdef DEBUG
     printf("allocating stack nodes\n");
 #   endif
-    st_mem = (SNODE *) malloc((sizeof (SNODE *)) + (NUM_ST * sizeof (SNODE)));
-    if (!st_mem) error("out of memory");
+    bert_ctx->st_mem = (SNODE *) malloc((sizeof (SNODE *)) + (NUM_ST * sizeof (SNODE)));
+    if (!bert_ctx->st_mem) error("out of memory");
 
     /* Save pointer to the beginning of this chunk of memory and link
        it to other allocated chunks (to be freed at end of program). */
-    *((SNODE **) st_mem) = all_st_mem;;
-    all_st_mem = st_mem; 
+    *((SNODE **) bert_ctx->st_mem) = bert_ctx->all_st_mem;;
+    bert_ctx->all_st_mem = bert_ctx->st_mem; 
     /* real memory starts after first word */
-    st_mem = (SNODE *) (((char *)st_mem) + sizeof(SNODE *));
+    bert_ctx->st_mem = (SNODE *) (((char *)bert_ctx->st_mem) + sizeof(SNODE *));
 
     for (i = 0; i < NUM_ST-1 ; i++) 	/* link list */
-	st_mem[i].next = &st_mem[i+1];
-    st_mem[NUM_ST-1].next = NULL;
+	bert_ctx->st_mem[i].next = &bert_ctx->st_mem[i+1];
+    bert_ctx->st_mem[NUM_ST-1].next = NULL;
+    bert_ctx->stats.snode_bytes += (sizeof (SNODE *)) + (NUM_ST * sizeof (SNODE));
     }
 
-temp = st_mem;
-st_mem = st_mem->next;
+temp = bert_ctx->st_mem;
+bert_ctx->st_mem = bert_ctx->st_mem->next;
+bert_ctx->stats.snodes_get++;
+if (++bert_ctx->stats.snodes_live > bert_ctx->stats.snodes_high)
+    bert_ctx->stats.snodes_high = bert_ctx->stats.snodes_live;
 return temp;
 }
 
@@ -145,8 +145,9 @@ void
 st_free(p)
 SNODE *p;
 {
-p->next = st_mem;
-st_mem = p;
+p->next = bert_ctx->st_mem;
+bert_ctx->st_mem = p;
+bert_ctx->stats.snodes_live--;
 }
 
 
@@ -161,19 +162,61 @@ st_mem_free()
 register SNODE *t;
 void free();
 
-while(all_st_mem) {
-    t = *((SNODE **) all_st_mem);
-    free(all_st_mem);
-    all_st_mem = t;
+while(bert_ctx->all_st_mem) {
+    t = *((SNODE **) bert_ctx->all_st_mem);
+    free(bert_ctx->all_st_mem);
+    bert_ctx->all_st_mem = t;
     }
-st_mem = (SNODE *) NULL;
+bert_ctx->st_mem = (SNODE *) NULL;
+bert_ctx->stats.snodes_live = 0;
+bert_ctx->stats.snode_bytes = 0;
 }
 
+/*********************************************************************
+ *
+ * Memory for the tables of the solvers (linsolve.c, simplex.c and
+ * the rest).  Out of memory is an error, "out of memory for" what
+ * the memory is for.
+ *
+ *********************************************************************/
+static void
+mem_error(what)
+char *what;
+{
+char msg[MAXERROR];
+
+snprintf(msg, MAXERROR, "out of memory for %s", what);
+error(msg);
+}
+
+void *
+mem_get(n, what)
+size_t n;		/* bytes */
+char *what;		/* what it is for */
+{
+void *p = malloc(n ? n : 1);
+
+if (!p) mem_error(what);
+return p;
+}
+
+void *
+mem_grow(p, n, what)
+void *p;
+size_t n;		/* bytes */
+char *what;		/* what it is for */
+{
+if (!(p = realloc(p, n ? n : 1))) mem_error(what);
+return p;
+}
+
 /*********************************************************************
  *
  * Routines to manage character string memory.
- * For the time being, these are very simple.
- * TO DO: make these more efficient.
+ * Strings belong to the context, and are freed all at once
+ * (or back to a region mark, see ctx.c).
+ * Each string is preceded by a pointer to the string allocated
+ * before it.
  *
  *********************************************************************/
 
@@ -191,54 +234,70 @@ char *s;
 {
 char *t;	/* new character string */
 int ss;		/* size of argument string s */
-void *calloc();
+void *malloc();
 
 ss = strlen(s) + 1;	/* one extra for null terminator */
-t = (char *) calloc(ss, sizeof(char));
+t = (char *) malloc(sizeof(char *) + ss);
 if (!t) error("out of character string memory");
+*((char **) t) = bert_ctx->all_strings;
+bert_ctx->all_strings = t;
+t += sizeof(char *);
 strcpy(t, s);
 return(t);
 }
 
-
-
 /***********************************************************************
  *
- * Free a character string.
- * String must have been allocated by char_copy (or calloc).
+ * Free character strings, back to (but not including) the
+ * string memory "to".  NULL frees all of them.
  *
  ***********************************************************************/
 void
-char_free(s)
-char *s;
+char_mem_free(to)
+char *to;
 {
-    void free();
+char *t;
+void free();
 
-    free(s);
+while (bert_ctx->all_strings != to) {
+    t = *((char **) bert_ctx->all_strings);
+    free(bert_ctx->all_strings);
+    bert_ctx->all_strings = t;
+    }
 }
-
+
 /***********************************************************************
  *
  * Error routine
  *
- * exit:	abort program
+ * The message (with the current file and line) is saved in the
+ * context.  If an entry point in ctx.c is catching errors, return
+ * there, otherwise print the message and abort the program.
  *
  ***********************************************************************/
 void
 error(s)
 char *s;
 {
-extern int lineno, charno;	/* from scanner.c */
-extern char *infilename;
 void exit(int);		/* UNIX system routine */
+register char *msg = bert_ctx->error_msg;
+int n = 0;
 
 fflush(stdout);
-if (lineno) {
-    if (charno == 0) fprintf(stderr, "file %s, line %d: ", infilename, lineno-1);
-    else fprintf(stderr, "file %s, line %d, before position %d: ",
-	infilename, lineno, charno);
+if (bert_ctx->lineno) {
+    if (bert_ctx->charno == 0) n = snprintf(msg, MAXERROR, "file %s, line %d: ",
+	bert_ctx->infilename, bert_ctx->lineno-1);
+    else n = snprintf(msg, MAXERROR, "file %s, line %d, before position %d: ",
+	bert_ctx->infilename, bert_ctx->lineno, bert_ctx->charno);
+    if (n >= MAXERROR) n = MAXERROR - 1;
+    }
+snprintf(msg + n, MAXERROR - n, "%s", s);
+fflush(stderr);
+if (bert_ctx->catch) {
+    bert_ctx->error_code = BERT_ERROR;
+    longjmp(*bert_ctx->catch, 1);
     }
-fprintf(stderr, "%s\n", s);
+fprintf(stderr, "%s\n", msg);
 fflush(stderr);
 exit(1);
 }